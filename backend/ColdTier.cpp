@@ -0,0 +1,486 @@
+#include "ColdTier.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#include "../helpers/DateTime.hpp"
+
+namespace {
+
+using ColdBlock = HealthBackend::ColdBlock;
+
+// 有 double 欄位（XOR 編碼）的 record；ActivityRecord 是 minutes（int）
+template <typename Record>
+constexpr bool kHasValue = !std::is_same_v<Record, ActivityRecord>;
+// 有字典編碼的字串欄位：category item 的 note
+template <typename Record>
+constexpr bool kHasLabel = std::is_same_v<Record, CategoryItem>;
+// activity 的 intensity 本來就是 interned 的 id，直接存 id（reference 留在 UserData::intensities，cold 的也算）
+template <typename Record>
+constexpr bool kHasSymbol = std::is_same_v<Record, ActivityRecord>;
+
+double &valueOf(WaterRecord &r) { return r.amountMl; }
+double &valueOf(SleepRecord &r) { return r.hours; }
+double &valueOf(CategoryItem &r) { return r.value; }
+double  valueOf(const WaterRecord &r) { return r.amountMl; }
+double  valueOf(const SleepRecord &r) { return r.hours; }
+double  valueOf(const CategoryItem &r) { return r.value; }
+
+std::string       &labelOf(CategoryItem &r) { return r.note; }
+const std::string &labelOf(const CategoryItem &r) { return r.note; }
+
+std::uint64_t zigzag(std::int64_t v) { return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63); }
+std::int64_t  unzigzag(std::uint64_t v) { return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1); }
+
+void putVarint(std::string &out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+// XOR 之後只留中間非 0 的 bytes：控制 byte = 尾端 0 byte 數 << 4 | 留下幾個 byte；XOR 是 0 就只有一個 0
+void putXor(std::string &out, std::uint64_t x) {
+    if (x == 0) {
+        out.push_back(0);
+        return;
+    }
+    int trail = 0;
+    while ((x >> (trail * 8) & 0xff) == 0) ++trail;
+    int top = 7;
+    while ((x >> (top * 8) & 0xff) == 0) --top;
+    const int n = top - trail + 1;
+    out.push_back(static_cast<char>(trail << 4 | n));
+    for (int i = trail; i <= top; ++i) out.push_back(static_cast<char>(x >> (i * 8) & 0xff));
+}
+
+std::uint64_t bitsOf(double v) {
+    std::uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+double fromBits(std::uint64_t b) {
+    double v;
+    std::memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+// block 是這個行程自己編出來的，不會壞；讀過頭只是保險（回傳 0）
+class Reader {
+public:
+    explicit Reader(const std::string &s)
+        : p_(reinterpret_cast<const unsigned char *>(s.data())), end_(p_ + s.size()) {}
+
+    std::uint8_t byte() { return p_ < end_ ? *p_++ : 0; }
+
+    std::uint64_t varint() {
+        std::uint64_t v = 0;
+        for (int shift = 0; p_ < end_ && shift < 64; shift += 7) {
+            const unsigned char c = *p_++;
+            v |= static_cast<std::uint64_t>(c & 0x7f) << shift;
+            if (!(c & 0x80)) break;
+        }
+        return v;
+    }
+
+    std::uint64_t xorBits() {
+        const std::uint8_t c = byte();
+        if (c == 0) return 0;
+        const int     trail = c >> 4;
+        const int     n     = c & 0x0f;
+        std::uint64_t x     = 0;
+        for (int i = 0; i < n; ++i) x |= static_cast<std::uint64_t>(byte()) << ((trail + i) * 8);
+        return x;
+    }
+
+    std::string_view bytes(std::size_t n) {
+        n = std::min<std::size_t>(n, static_cast<std::size_t>(end_ - p_));
+        std::string_view s(reinterpret_cast<const char *>(p_), n);
+        p_ += n;
+        return s;
+    }
+
+private:
+    const unsigned char *p_;
+    const unsigned char *end_;
+};
+
+// [format][offset（有 ±HH:MM 的寫法才有）][字典][datetime 欄][value 欄 / minutes 欄][字典 index 欄 / symbol id 欄]
+template <typename Record>
+ColdBlock encodeBlock(const Record *recs, const std::int64_t *ms, std::size_t n, util::DateTimeFormat format,
+                      int offsetMinutes) {
+    ColdBlock b;
+    b.count = static_cast<std::uint32_t>(n);
+    b.minMs = *std::min_element(ms, ms + n);
+    b.maxMs = *std::max_element(ms, ms + n);
+    std::string &out = b.bytes;
+    out.push_back(static_cast<char>(format));
+    if (util::hasOffset(format)) putVarint(out, zigzag(offsetMinutes));
+
+    std::vector<std::uint32_t> labels;
+    if constexpr (kHasLabel<Record>) {
+        std::unordered_map<std::string_view, std::uint32_t> index;
+        std::vector<std::string_view>                       dict;
+        labels.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::string &label = labelOf(recs[i]);
+            auto [it, fresh]         = index.emplace(label, static_cast<std::uint32_t>(dict.size()));
+            if (fresh) dict.push_back(label);
+            labels.push_back(it->second);
+        }
+        putVarint(out, dict.size());
+        for (const auto &s : dict) {
+            putVarint(out, s.size());
+            out.append(s.data(), s.size());
+        }
+    }
+
+    // 第一筆原值、第二筆差值，之後是「差值的差」
+    std::int64_t prevDelta = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i == 0) {
+            putVarint(out, zigzag(ms[0]));
+            continue;
+        }
+        const std::int64_t delta = ms[i] - ms[i - 1];
+        putVarint(out, zigzag(i == 1 ? delta : delta - prevDelta));
+        prevDelta = delta;
+    }
+
+    if constexpr (kHasValue<Record>) {
+        std::uint64_t prev = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::uint64_t bits = bitsOf(valueOf(recs[i]));
+            putXor(out, bits ^ prev);
+            prev = bits;
+        }
+    } else {
+        std::int64_t prev = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            putVarint(out, zigzag(static_cast<std::int64_t>(recs[i].minutes) - prev));
+            prev = recs[i].minutes;
+        }
+    }
+
+    if constexpr (kHasLabel<Record>) {
+        for (std::uint32_t l : labels) putVarint(out, l);
+    }
+    if constexpr (kHasSymbol<Record>) {
+        for (std::size_t i = 0; i < n; ++i) putVarint(out, recs[i].intensity.id());
+    }
+    out.shrink_to_fit();
+    return b;
+}
+
+// 解開的 block：欄位都還是數字（字串還沒複製），
+// 只查幾筆的時候只把用到的那幾筆做成 record
+struct Columns {
+    util::DateTimeFormat          format = util::DateTimeFormat::IsoZ;
+    int                           offset = 0; // 分鐘，見 util::parseDateTime
+    std::vector<std::int64_t>     ms;
+    std::vector<std::int64_t>     values; // double 的 IEEE bits，或 minutes
+    std::vector<std::string_view> dict;   // 指向 block.bytes
+    std::vector<std::uint32_t>    labels; // 字典 index，或 symbol id
+};
+
+template <typename Record>
+void decodeColumns(const ColdBlock &b, Columns &cols) {
+    Reader in(b.bytes);
+    cols.format = static_cast<util::DateTimeFormat>(in.byte());
+    cols.offset = util::hasOffset(cols.format) ? static_cast<int>(unzigzag(in.varint())) : 0;
+    cols.ms.resize(b.count);
+    cols.values.resize(b.count);
+
+    if constexpr (kHasLabel<Record>) {
+        cols.dict.resize(in.varint());
+        for (auto &s : cols.dict) s = in.bytes(in.varint());
+    }
+
+    std::int64_t prev = 0, prevDelta = 0;
+    for (std::uint32_t i = 0; i < b.count; ++i) {
+        const std::int64_t v = unzigzag(in.varint());
+        std::int64_t       t;
+        if (i == 0) {
+            t = v;
+        } else {
+            const std::int64_t delta = i == 1 ? v : prevDelta + v;
+            t                        = prev + delta;
+            prevDelta                = delta;
+        }
+        prev       = t;
+        cols.ms[i] = t;
+    }
+
+    if constexpr (kHasValue<Record>) {
+        std::uint64_t bits = 0;
+        for (std::uint32_t i = 0; i < b.count; ++i) {
+            bits ^= in.xorBits();
+            cols.values[i] = static_cast<std::int64_t>(bits);
+        }
+    } else {
+        std::int64_t minutes = 0;
+        for (std::uint32_t i = 0; i < b.count; ++i) {
+            minutes += unzigzag(in.varint());
+            cols.values[i] = minutes;
+        }
+    }
+
+    if constexpr (kHasLabel<Record> || kHasSymbol<Record>) {
+        cols.labels.resize(b.count);
+        for (auto &l : cols.labels) l = static_cast<std::uint32_t>(in.varint());
+    }
+}
+
+template <typename Record>
+void recordAt(const Columns &cols, std::size_t i, Record &r) {
+    r.datetime = util::PackedDateTime::fromMillis(cols.ms[i], cols.format, cols.offset);
+    if constexpr (kHasValue<Record>) {
+        valueOf(r) = fromBits(static_cast<std::uint64_t>(cols.values[i]));
+    } else {
+        r.minutes = static_cast<int>(cols.values[i]);
+    }
+    if constexpr (kHasLabel<Record>) {
+        const std::uint32_t l = cols.labels[i];
+        if (l < cols.dict.size()) labelOf(r).assign(cols.dict[l].data(), cols.dict[l].size());
+    }
+    if constexpr (kHasSymbol<Record>) r.intensity = util::SymbolRef::fromId(cols.labels[i]);
+}
+
+// 整個 block 解成 records
+template <typename Record>
+void decodeRecords(const ColdBlock &b, std::vector<Record> &out) {
+    Columns cols;
+    decodeColumns<Record>(b, cols);
+    out.resize(b.count);
+    for (std::size_t i = 0; i < b.count; ++i) recordAt(cols, i, out[i]);
+}
+
+// records 重新編成一個 block；datetime 寫法 / offset 不一樣（或認不得）就回傳 false
+template <typename Record>
+bool encodeRecords(const std::vector<Record> &recs, ColdBlock &out) {
+    std::vector<std::int64_t> times(recs.size());
+    util::DateTimeFormat      format = util::DateTimeFormat::IsoZ;
+    int                       offset = 0;
+    for (std::size_t i = 0; i < recs.size(); ++i) {
+        util::DateTimeFormat f;
+        int                  o;
+        if (!recs[i].datetime.millis(times[i], f, o)) return false;
+        if (i == 0) {
+            format = f;
+            offset = o;
+        } else if (f != format || o != offset) {
+            return false;
+        }
+    }
+    out = encodeBlock(recs.data(), times.data(), recs.size(), format, offset);
+    return true;
+}
+
+// 第 index 筆在哪個 block；index 變成 block 裡的位置。超出範圍回傳 blocks.size()
+std::size_t blockOf(const HealthBackend::ColdSeries &cold, std::size_t &index) {
+    for (std::size_t b = 0; b < cold.blocks.size(); ++b) {
+        if (index < cold.blocks[b].count) return b;
+        index -= cold.blocks[b].count;
+    }
+    return cold.blocks.size();
+}
+
+} // namespace
+
+template <typename Record>
+std::size_t ColdTier::seal(ColdSeries& cold, std::vector<Record>& hot, std::int64_t cutoffMs) {
+    // 每次修改都會呼叫：先只看開頭夠不夠舊，大部分情況第一筆就停
+    std::size_t          n = 0;
+    std::int64_t ms;
+    while (n < hot.size() && hot[n].datetime.millis(ms) && ms < cutoffMs) ++n;
+    if (n < kMinSeal) return 0;
+
+    std::vector<std::int64_t>         times(n);
+    std::vector<util::DateTimeFormat> formats(n);
+    std::vector<int>                  offsets(n);
+    for (std::size_t i = 0; i < n; ++i) hot[i].datetime.millis(times[i], formats[i], offsets[i]);
+
+    // 一個 block 的 datetime 寫法（和 offset）要一樣
+    for (std::size_t first = 0; first < n;) {
+        std::size_t last = first + 1;
+        while (last < n && last - first < kBlockRecords && formats[last] == formats[first] &&
+               offsets[last] == offsets[first]) {
+            ++last;
+        }
+        cold.blocks.push_back(encodeBlock(hot.data() + first, times.data() + first, last - first, formats[first],
+                                          offsets[first]));
+        cold.count += last - first;
+        first = last;
+    }
+    hot.erase(hot.begin(), hot.begin() + static_cast<std::ptrdiff_t>(n));
+    hot.shrink_to_fit();
+    return n;
+}
+
+template <typename Record>
+void ColdTier::thaw(ColdSeries& cold, std::vector<Record>& hot) {
+    if (cold.count == 0) return;
+    std::vector<Record> all;
+    all.reserve(cold.count + hot.size());
+    append(cold, all);
+    std::move(hot.begin(), hot.end(), std::back_inserter(all));
+    hot.swap(all);
+    cold = ColdSeries{};
+}
+
+template <typename Record>
+void ColdTier::thawFrom(ColdSeries& cold, std::vector<Record>& hot, std::size_t index) {
+    const std::size_t first = blockOf(cold, index);
+    if (first == cold.blocks.size()) return;
+    ColdSeries tail;
+    for (std::size_t b = first; b < cold.blocks.size(); ++b) {
+        tail.count += cold.blocks[b].count;
+        tail.blocks.push_back(std::move(cold.blocks[b]));
+    }
+    cold.blocks.erase(cold.blocks.begin() + static_cast<std::ptrdiff_t>(first), cold.blocks.end());
+    cold.count -= tail.count;
+    thaw(tail, hot);
+}
+
+template <typename Record>
+bool ColdTier::replace(ColdSeries& cold, std::size_t index, const Record& r) {
+    const std::size_t b = blockOf(cold, index);
+    if (b == cold.blocks.size()) return false;
+    std::vector<Record> recs;
+    decodeRecords(cold.blocks[b], recs);
+    recs[index] = r;
+    ColdBlock fresh;
+    if (!encodeRecords(recs, fresh)) return false;
+    cold.blocks[b] = std::move(fresh);
+    return true;
+}
+
+template <typename Record>
+void ColdTier::erase(ColdSeries& cold, std::size_t index) {
+    const std::size_t b = blockOf(cold, index);
+    if (b == cold.blocks.size()) return;
+    --cold.count;
+    if (cold.blocks[b].count == 1) {
+        cold.blocks.erase(cold.blocks.begin() + static_cast<std::ptrdiff_t>(b));
+        return;
+    }
+    std::vector<Record> recs;
+    decodeRecords(cold.blocks[b], recs);
+    recs.erase(recs.begin() + static_cast<std::ptrdiff_t>(index));
+    encodeRecords(recs, cold.blocks[b]); // 剩下的本來就在同一個 block，寫法一定一樣
+}
+
+template <typename Record>
+void ColdTier::append(const ColdSeries& cold, std::vector<Record>& out) {
+    out.reserve(out.size() + cold.count);
+    Columns cols;
+    for (const auto& b : cold.blocks) {
+        decodeColumns<Record>(b, cols);
+        const std::size_t base = out.size();
+        out.resize(base + b.count);
+        for (std::size_t i = 0; i < b.count; ++i) recordAt(cols, i, out[base + i]);
+    }
+}
+
+template <typename Record>
+bool ColdTier::at(const ColdSeries& cold, std::size_t index, Record& out) {
+    for (const auto& b : cold.blocks) {
+        if (index < b.count) {
+            Columns cols;
+            decodeColumns<Record>(b, cols);
+            recordAt(cols, index, out);
+            return true;
+        }
+        index -= b.count;
+    }
+    return false;
+}
+
+template <typename Record>
+void ColdTier::gather(const ColdSeries& cold, const std::vector<std::size_t>& indices, std::vector<Record>& out) {
+    std::vector<std::size_t> order(indices.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return indices[a] < indices[b]; });
+
+    Columns     cols;
+    std::size_t base = 0;
+    auto        next = order.begin();
+    for (const auto& b : cold.blocks) {
+        if (next == order.end()) break;
+        if (indices[*next] < base + b.count) {
+            decodeColumns<Record>(b, cols);
+            for (; next != order.end() && indices[*next] < base + b.count; ++next) {
+                recordAt(cols, indices[*next] - base, out[*next]);
+            }
+        }
+        base += b.count;
+    }
+}
+
+template <typename Record>
+void ColdTier::appendBetween(const ColdSeries& cold, std::int64_t fromMs, std::int64_t toMs,
+                             std::vector<std::pair<std::size_t, Record>>& out) {
+    Columns     cols;
+    std::size_t base = 0;
+    for (const auto& b : cold.blocks) {
+        if (b.maxMs >= fromMs && b.minMs < toMs) {
+            decodeColumns<Record>(b, cols);
+            for (std::size_t i = 0; i < b.count; ++i) {
+                if (cols.ms[i] < fromMs || cols.ms[i] >= toMs) continue;
+                out.emplace_back(base + i, Record{});
+                recordAt(cols, i, out.back().second);
+            }
+        }
+        base += b.count;
+    }
+}
+
+HealthBackend::UserData ColdTier::expand(const HealthBackend::UserData& user) {
+    HealthBackend::UserData full;
+    full.profile  = user.profile;
+    full.password = user.password;
+
+    append(user.cold.waters, full.waters);
+    full.waters.insert(full.waters.end(), user.waters.begin(), user.waters.end());
+    append(user.cold.sleeps, full.sleeps);
+    full.sleeps.insert(full.sleeps.end(), user.sleeps.begin(), user.sleeps.end());
+    append(user.cold.activities, full.activities);
+    full.activities.insert(full.activities.end(), user.activities.begin(), user.activities.end());
+    for (const auto& [name, items] : user.categories) {
+        auto& dst = full.categories[name];
+        auto  it  = user.cold.categories.find(name);
+        if (it != user.cold.categories.end()) append(it->second, dst);
+        dst.insert(dst.end(), items.begin(), items.end());
+    }
+    return full;
+}
+
+std::size_t ColdTier::bytes(const ColdSeries& cold) {
+    std::size_t total = cold.blocks.capacity() * sizeof(ColdBlock);
+    for (const auto& b : cold.blocks) total += b.bytes.capacity();
+    return total;
+}
+
+#define HB_COLD_TIER_INSTANTIATE(Record)                                                                  \
+    template std::size_t ColdTier::seal<Record>(ColdSeries&, std::vector<Record>&, std::int64_t);       \
+    template void        ColdTier::thaw<Record>(ColdSeries&, std::vector<Record>&);                      \
+    template void        ColdTier::thawFrom<Record>(ColdSeries&, std::vector<Record>&, std::size_t);     \
+    template bool        ColdTier::replace<Record>(ColdSeries&, std::size_t, const Record&);             \
+    template void        ColdTier::erase<Record>(ColdSeries&, std::size_t);                              \
+    template void        ColdTier::append<Record>(const ColdSeries&, std::vector<Record>&);              \
+    template bool        ColdTier::at<Record>(const ColdSeries&, std::size_t, Record&);                  \
+    template void        ColdTier::gather<Record>(const ColdSeries&, const std::vector<std::size_t>&,    \
+                                                  std::vector<Record>&);                                 \
+    template void        ColdTier::appendBetween<Record>(const ColdSeries&, std::int64_t, std::int64_t, \
+                                                         std::vector<std::pair<std::size_t, Record>>&);
+
+HB_COLD_TIER_INSTANTIATE(WaterRecord)
+HB_COLD_TIER_INSTANTIATE(SleepRecord)
+HB_COLD_TIER_INSTANTIATE(ActivityRecord)
+HB_COLD_TIER_INSTANTIATE(CategoryItem)
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "HealthBackend.hpp"
+
+// 舊 records 的 cold tier：幾乎不會再改的歷史封存成唯讀的壓縮 block，
+// UserData 的 vectors 只留最近的（hot tier）。
+//
+// 一個 block 是同一個 series 裡連續的一段 records（最多 kBlockRecords 筆、datetime 寫法相同），
+// 欄位分開存（column），每一欄用適合的編法：
+//   datetime          → PackedDateTime 的毫秒，存 delta-of-delta（zigzag varint）；
+//                       規律記錄的時間差不多固定，大部分一筆 1 byte。寫法（DateTimeFormat）和 offset 整個 block 一個
+//   amountMl / hours / value → 跟前一筆的 IEEE bits 做 XOR，只存中間非 0 的 bytes（Gorilla 的 byte 版本）；
+//                       重複的值 1 byte
+//   minutes           → 跟前一筆的差（zigzag varint）
+//   note              → block 內的字典，每筆存字典 index
+//   intensity         → interned 的 symbol id（varint）
+//
+// 只有 datetime 認得的 records 可以封存；cold 永遠是 series 開頭連續的一段，
+// index 才不會因為封存而改變（見 HealthBackend::UserData）。
+class ColdTier {
+public:
+    static constexpr std::size_t kBlockRecords = 256;
+    // 夠舊的 records 少於這個數量就先不封存，免得每次修改都切出很小的 block
+    static constexpr std::size_t kMinSeal = 32;
+
+    using ColdSeries = HealthBackend::ColdSeries;
+
+    // hot 開頭 datetime 早於 cutoffMs 的 records 搬進 cold；回傳搬了幾筆
+    template <typename Record>
+    static std::size_t seal(ColdSeries& cold, std::vector<Record>& hot, std::int64_t cutoffMs);
+
+    // cold 全部解回 hot 前面，cold 變成空的
+    template <typename Record>
+    static void thaw(ColdSeries& cold, std::vector<Record>& hot);
+
+    // 第 index 筆所在的 block 開始、到最後的 block 都解回 hot 前面；前面的 block 不動
+    template <typename Record>
+    static void thawFrom(ColdSeries& cold, std::vector<Record>& hot, std::size_t index);
+
+    // 改舊 record：第 index 筆換成 r，只重編它所在的 block。
+    // r 的 datetime 寫法 / offset 跟 block 裡其他筆不一樣（一個 block 要一樣）就回傳 false，什麼都不動
+    template <typename Record>
+    static bool replace(ColdSeries& cold, std::size_t index, const Record& r);
+
+    // 刪掉第 index 筆，只重編它所在的 block（刪到空就拿掉那個 block），後面的 index 往前移一格
+    template <typename Record>
+    static void erase(ColdSeries& cold, std::size_t index);
+
+    // cold 的 records 依序接到 out 後面
+    template <typename Record>
+    static void append(const ColdSeries& cold, std::vector<Record>& out);
+
+    // 第 index 筆（只解它所在的 block）；超出範圍回傳 false
+    template <typename Record>
+    static bool at(const ColdSeries& cold, std::size_t index, Record& out);
+
+    // indices[i]（cold 裡的 index，順序不拘）那筆放到 out[i]；out 要先 resize 成 indices.size()。
+    // 先照 index 排，同一個 block 的一起處理，每個用到的 block 只解一次
+    template <typename Record>
+    static void gather(const ColdSeries& cold, const std::vector<std::size_t>& indices, std::vector<Record>& out);
+
+    // datetime 在 [fromMs, toMs) 的 cold records 和它們的 index 接到 out 後面；範圍外的 block 不解
+    template <typename Record>
+    static void appendBetween(const ColdSeries& cold, std::int64_t fromMs, std::int64_t toMs,
+                              std::vector<std::pair<std::size_t, Record>>& out);
+
+    // 整個 user 都解回 hot 的複本（存檔用；存檔格式沒有 cold tier）
+    static HealthBackend::UserData expand(const HealthBackend::UserData& user);
+
+    // block 佔的 heap
+    static std::size_t bytes(const ColdSeries& cold);
+};
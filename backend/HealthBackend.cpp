@@ -9,10 +9,19 @@
 #include <sys/stat.h>   // stat, mkdir
 #include <sys/types.h>
 
-#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>     // rename
 #include <random>
 #include <iostream>
+#include "ColdTier.hpp"
+#include "Snapshot.hpp"
+#include "StorageLoader.hpp"
+#include "../helpers/AtomicFile.hpp"
+#include "../helpers/DateTime.hpp"
 #include "../helpers/Logger.hpp"
+#include "../helpers/MappedFile.hpp"
+#include "../helpers/Trace.hpp"
 
 // 使用 nlohmann::json 方便寫成 json
 using nlohmann::json;
@@ -24,6 +33,238 @@ static bool dirExists(const std::string &path) {
     return S_ISDIR(st.st_mode);
 }
 
+// storage.json 的一個 user；per-user 格式的檔案內容也是這個
+static json userToJson(const HealthBackend::UserData& data) {
+    // 存檔格式沒有 cold tier，封存的 records 解開寫在 hot 前面
+    if (!data.cold.empty()) return userToJson(ColdTier::expand(data));
+
+    json ju;
+    ju["id"]       = data.profile.id;
+    ju["name"]     = data.profile.name;
+    ju["age"]      = data.profile.age;
+    ju["weightKg"] = data.profile.weightKg;
+    ju["heightM"]  = data.profile.heightM;
+    ju["gender"]   = data.profile.gender;
+
+    ju["password"] = data.password;
+
+    // Waters
+    ju["waters"] = json::array();
+    for (const auto& w : data.waters) {
+        json jw;
+        jw["datetime"] = w.datetime.str();
+        jw["amountMl"] = w.amountMl;
+        ju["waters"].push_back(jw);
+    }
+
+    // Sleeps
+    ju["sleeps"] = json::array();
+    for (const auto& s : data.sleeps) {
+        json js;
+        js["datetime"] = s.datetime.str();
+        js["hours"]    = s.hours;
+        ju["sleeps"].push_back(js);
+    }
+
+    // Activities
+    ju["activities"] = json::array();
+    for (const auto& a : data.activities) {
+        json ja;
+        ja["datetime"]  = a.datetime.str();
+        ja["minutes"]   = a.minutes;
+        ja["intensity"] = a.intensity.str();
+        ju["activities"].push_back(ja);
+    }
+
+    // Categories
+    ju["categories"] = json::object();
+    for (const auto& [catName, items] : data.categories) {
+        json arr = json::array();
+        for (const auto& item : items) {
+            json ji;
+            ji["datetime"] = item.datetime.str();
+            ji["note"]     = item.note;
+            ji["value"]    = item.value;
+            arr.push_back(ji);
+        }
+        ju["categories"][catName.str()] = arr;
+    }
+
+    return ju;
+}
+
+// per-user 格式一個 user 檔的內容
+static std::string userFileDoc(const HealthBackend::UserData& data) {
+    std::string doc = userToJson(data).dump(2);
+    StorageLoader::appendChecksum(doc);
+    return doc;
+}
+
+// doc 整份寫進 path（util::AtomicFile：暫存檔 + fsync + rename，舊檔留 keep 份）
+static bool commitFile(const std::string& path, const std::string& doc, unsigned keep, bool sync) {
+    util::AtomicFile out;
+    if (!out.open(path) || !out.write(doc.data(), doc.size()) || !out.commit(keep, sync)) {
+        HB_LOG_ERROR("Failed to write {} ({}).", path, out.error());
+        return false;
+    }
+    return true;
+}
+
+// per-user 檔所在的 bucket 目錄，第一次寫進這個 bucket 時建
+static void ensureBucket(const std::string& path) {
+    const std::string bucket = path.substr(0, path.find_last_of('/'));
+    if (!dirExists(bucket)) mkdir(bucket.c_str(), 0755);
+}
+
+// records 大概佔多少 heap：vector 的 capacity、放不進 SSO 的 note、map node（datetime 是 inline 的）。
+// 只拿來跟 memory budget 比，不用很準，但要便宜（每次修改都會算一次）
+static std::size_t recordBytes(const HealthBackend::UserData& data) {
+    static const std::size_t sso = std::string().capacity();
+    auto str = [](const std::string& s) { return s.capacity() > sso ? s.capacity() + 1 : 0; };
+
+    std::size_t bytes = data.waters.capacity() * sizeof(WaterRecord) +
+                        data.sleeps.capacity() * sizeof(SleepRecord) +
+                        data.activities.capacity() * sizeof(ActivityRecord);
+    for (const auto& [catName, items] : data.categories) {
+        // map node：key + value + 紅黑樹的 4 個 word（名字是 interned，不算在 user 身上）
+        bytes += sizeof(catName) + sizeof(items) + 4 * sizeof(void*);
+        bytes += items.capacity() * sizeof(CategoryItem);
+        for (const auto& item : items) bytes += str(item.note);
+    }
+    bytes += data.intensities.size() * (sizeof(util::Symbol) + sizeof(std::uint32_t) + 4 * sizeof(void*));
+    bytes += data.byDuration.capacity() * sizeof(util::RankedIndex::Entry);
+    bytes += ColdTier::bytes(data.cold.waters) + ColdTier::bytes(data.cold.sleeps) +
+             ColdTier::bytes(data.cold.activities);
+    for (const auto& [catName, series] : data.cold.categories) bytes += ColdTier::bytes(series);
+    return bytes;
+}
+
+// ----------------------
+// Hot / cold tier：每個 series 的 index 是 cold 在前、hot 在後
+// ----------------------
+
+static HealthBackend::ColdSeries* coldItems(HealthBackend::UserData& user, const util::Symbol& category) {
+    auto it = user.cold.categories.find(category);
+    return it == user.cold.categories.end() ? nullptr : &it->second;
+}
+
+static const HealthBackend::ColdSeries* coldItems(const HealthBackend::UserData& user, const util::Symbol& category) {
+    auto it = user.cold.categories.find(category);
+    return it == user.cold.categories.end() ? nullptr : &it->second;
+}
+
+// 用名字找 category：沒 intern 過的名字一定不存在，只查不加，不為它佔一個 symbol
+template <typename Categories>
+static auto findCategory(Categories& categories, const std::string& name) -> decltype(categories.end()) {
+    util::Symbol key;
+    return util::Symbol::find(name, key) ? categories.find(key) : categories.end();
+}
+
+// 修改用：第 index 筆交給 edit 改。落在 cold 的只重編它所在的 block（ColdTier::replace），
+// 改過的 datetime 寫法跟 block 不合才從那個 block 開始解回 hot（persist 時會再封存）。false = 超出範圍
+template <typename Record, typename Fn>
+static bool editRecord(HealthBackend::ColdSeries* cold, std::vector<Record>& hot, std::size_t index, Fn&& edit) {
+    const std::size_t coldCount = cold ? cold->count : 0;
+    if (index >= coldCount) {
+        index -= coldCount;
+        if (index >= hot.size()) return false;
+        edit(hot[index]);
+        return true;
+    }
+    Record r;
+    if (!ColdTier::at(*cold, index, r)) return false;
+    edit(r);
+    if (ColdTier::replace(*cold, index, r)) return true;
+    ColdTier::thawFrom(*cold, hot, index);
+    hot[index - cold->count] = std::move(r);
+    return true;
+}
+
+// 刪除用：落在 cold 的只重編它所在的 block（ColdTier::erase）。false = 超出範圍
+template <typename Record>
+static bool eraseRecord(HealthBackend::ColdSeries* cold, std::vector<Record>& hot, std::size_t index) {
+    const std::size_t coldCount = cold ? cold->count : 0;
+    if (index < coldCount) {
+        ColdTier::erase<Record>(*cold, index);
+        return true;
+    }
+    index -= coldCount;
+    if (index >= hot.size()) return false;
+    hot.erase(hot.begin() + static_cast<std::ptrdiff_t>(index));
+    return true;
+}
+
+template <typename Record>
+static bool recordAt(const HealthBackend::ColdSeries* cold, const std::vector<Record>& hot, std::size_t index,
+                     Record& out) {
+    const std::size_t coldCount = cold ? cold->count : 0;
+    if (index < coldCount) return ColdTier::at(*cold, index, out);
+    index -= coldCount;
+    if (index >= hot.size()) return false;
+    out = hot[index];
+    return true;
+}
+
+// 新寫入的 datetime 不能進 util::Symbol 的表（見 util::PackedDateTime::storable）；
+// 舊資料裡本來就是那種長字串的 record，datetime 沒改的話照舊留著
+template <typename Record>
+static bool datetimeAccepted(const HealthBackend::ColdSeries* cold, const std::vector<Record>& hot, std::size_t index,
+                             const std::string& datetime) {
+    if (util::PackedDateTime::storable(datetime)) return true;
+    Record current;
+    return recordAt(cold, hot, index, current) && current.datetime.str() == datetime;
+}
+
+template <typename Record>
+static std::vector<Record> allRecords(const HealthBackend::ColdSeries* cold, const std::vector<Record>& hot) {
+    if (!cold || cold->count == 0) return hot;
+    std::vector<Record> out;
+    out.reserve(cold->count + hot.size());
+    ColdTier::append(*cold, out);
+    out.insert(out.end(), hot.begin(), hot.end());
+    return out;
+}
+
+template <typename Record>
+static std::vector<std::pair<std::size_t, Record>> recordsBetween(const HealthBackend::ColdSeries* cold,
+                                                                  const std::vector<Record>&       hot,
+                                                                  std::int64_t fromMs, std::int64_t toMs) {
+    std::vector<std::pair<std::size_t, Record>> out;
+    const std::size_t coldCount = cold ? cold->count : 0;
+    if (cold) ColdTier::appendBetween(*cold, fromMs, toMs, out);
+    for (std::size_t i = 0; i < hot.size(); ++i) {
+        std::int64_t ms;
+        if (hot[i].datetime.millis(ms) && ms >= fromMs && ms < toMs) {
+            out.emplace_back(coldCount + i, hot[i]);
+        }
+    }
+    return out;
+}
+
+// cold 解開的 + hot，依序
+template <typename Record, typename Fn>
+static void forEachRecord(const HealthBackend::ColdSeries& cold, const std::vector<Record>& hot, Fn&& fn) {
+    if (cold.count > 0) {
+        std::vector<Record> old;
+        ColdTier::append(cold, old);
+        for (const auto& r : old) fn(r);
+    }
+    for (const auto& r : hot) fn(r);
+}
+
+// 排行榜跟著 records 改；datetime 不是 ISO 8601 的 record 不算
+static void boardAdd(Leaderboard& board, const std::string& user, const util::PackedDateTime& datetime,
+                     std::int64_t amount) {
+    std::int64_t ms;
+    if (datetime.millis(ms)) board.add(user, ms, amount);
+}
+
+static void boardRemove(Leaderboard& board, const std::string& user, const util::PackedDateTime& datetime,
+                        std::int64_t amount) {
+    std::int64_t ms;
+    if (datetime.millis(ms)) board.remove(user, ms, amount);
+}
+
 // ----------------------
 // 初始化：決定 storagePath
 // ----------------------
@@ -81,15 +322,67 @@ void HealthBackend::ensureStorageDirExists() const {
 // 建構 / 解構：處理載入 / 儲存
 // ----------------------
 
-HealthBackend::HealthBackend() {
-    initStoragePath();        // ⭐ 依照執行檔位置決定 data/storage.json
+// 準備好、還沒寫的內容。users 照寫進檔案的順序（Binary 格式裡的位置就是新的 snapshotIndex）
+struct HealthBackend::Checkpoint {
+    std::vector<WrittenUser> users;
+    std::string              doc;   // Json：整份 storage.json
+    std::vector<std::string> files; // PerUser：跟 users 對齊的檔案內容
+    // Binary：已經寫進暫存檔、還沒 close()；抄的來源在寫完之前不能被放掉
+    std::unique_ptr<SnapshotWriter>     writer;
+    std::shared_ptr<const SnapshotFile> source;
+    std::shared_ptr<const SnapshotFile> fresh;
+
+    // vector 的 capacity 留著；整份檔案那麼大的 doc、snapshot 的 mapping 都放掉
+    void clear() {
+        users.clear();
+        files.clear();
+        std::string().swap(doc);
+        writer.reset();
+        source.reset();
+        fresh.reset();
+    }
+};
+
+HealthBackend::HealthBackend() : HealthBackend(Options{}) {}
+
+HealthBackend::HealthBackend(const Options& opts)
+    : autoSave(opts.autoSave), loadThreads(opts.loadThreads), storageFormat(opts.format), backups(opts.backups),
+      memoryBudget(opts.memoryBudget), coldAfterMs(static_cast<std::int64_t>(opts.coldAfterDays) * 86400000),
+      flushIntervalMs(opts.flushIntervalMs) {
+    if (opts.storagePath.empty()) {
+        initStoragePath();    // ⭐ 依照執行檔位置決定 data/storage.json
+        if (storageFormat == StorageFormat::Binary) storagePath = "data/storage.snap";
+        if (storageFormat == StorageFormat::PerUser) storagePath = "data/users";
+    } else {
+        storagePath = opts.storagePath;
+    }
     ensureStorageDirExists(); // ⭐ 確保 data/ 存在
-    loadFromFile();           // ⭐ 嘗試載入舊有資料
+    readStorage();            // ⭐ 嘗試載入舊有資料
+
+    if (memoryBudget > 0 && storageFormat == StorageFormat::Json) {
+        HB_LOG_WARN("Memory budget ignored: JSON storage cannot reload a single user, use binary or per-user.");
+        memoryBudget = 0;
+    }
+    enforceBudget(nullptr);
+    if (autoSave) {
+        flusher = std::thread([this] { flushLoop(); });
+        if (!dirtyUsers.empty()) requestFlush(); // 從備份救回來的 user
+    }
 }
 
 HealthBackend::~HealthBackend() {
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(flushMtx);
+            flushStop = true;
+        }
+        flushCv.notify_one();
+        flusher.join();
+    }
     try {
-        saveToFile();
+        // 背景 thread 還沒寫的（間隔內的修改、寫失敗的）在這裡補寫
+        std::lock_guard<std::mutex> serial(checkpointMtx);
+        if (autoSave) writeStorage(false);
     } catch (...) {
         // 不讓 destructor 拋例外
     }
@@ -122,177 +415,683 @@ std::string HealthBackend::generateToken() const {
 // 檔案 I/O：load / save
 // ----------------------
 
-void HealthBackend::loadFromFile() {
-    std::ifstream in(storagePath);
-    if (!in) {
-        // 檔案不存在 → 視為空資料庫
-        return;
+void HealthBackend::readStorage() {
+    // 排行榜是所有 user 的 records 算出來的，下次查詢再重建
+    activityBoard.clear();
+    waterBoard.clear();
+    leaderboardsBuilt = false;
+
+    // 檔案不存在 → 視為空資料庫（刪掉 storage 檔 = 重設資料，不會去翻備份）
+    if (readStorageFrom(storagePath) != LoadStatus::Failed) return;
+
+    // 壞掉（寫到一半的舊版本 / 磁碟損壞）：依序試 .1 .2 …，用最新一份好的
+    for (unsigned i = 1; i <= backups; ++i) {
+        const std::string path = util::AtomicFile::backupPath(storagePath, i);
+        if (readStorageFrom(path) == LoadStatus::Loaded) {
+            HB_LOG_WARN("Recovered data from backup {} because {} is unreadable.", path, storagePath);
+            quarantine(storagePath);
+            return;
+        }
     }
+    HB_LOG_ERROR("No readable copy of {} (checked {} backups), starting empty.", storagePath, backups);
+    quarantine(storagePath);
+}
 
-    json j;
-    try {
-        in >> j;
-    } catch (...) {
-        util::Logger::error(std::string("Failed to parse ") + storagePath + ", starting empty.");
-        return;
+HealthBackend::LoadStatus HealthBackend::readStorageFrom(const std::string& path) {
+    if (dirExists(path)) return readUserDir(path);
+    if (SnapshotFile::isSnapshot(path)) return readSnapshot(path);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    StorageLoader::Result result;
+    switch (StorageLoader::load(path, loadThreads, result)) {
+    case StorageLoader::Status::Missing:
+        return LoadStatus::Missing;
+    case StorageLoader::Status::Error:
+        HB_LOG_ERROR("Failed to load {} ({}).", path, result.error);
+        return LoadStatus::Failed;
+    case StorageLoader::Status::Ok:
+        break;
     }
 
-    if (!j.contains("users") || !j["users"].is_array()) {
-        return;
+    usersByName.reserve(usersByName.size() + result.users.size());
+    for (auto& data : result.users) {
+        std::string name = data.profile.name;
+        const UserData& user = usersByName.insert_or_assign(std::move(name), std::move(data)).first->second;
+        seal(user);
+        account(user);
     }
 
-    for (const auto& ju : j["users"]) {
-        if (!ju.contains("name")) continue;
-        std::string name = ju.value("name", "");
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+    HB_LOG_INFO("Loaded {} users from {} ({} bytes, {} threads, {} ms, {})",
+                result.users.size(), path, result.bytes, result.threads, ms,
+                result.verified ? "checksum ok" : "no checksum");
+    return LoadStatus::Loaded;
+}
+
+// binary snapshot：只讀 directory，每個 user 的 records 等第一次用到才解（materialize）
+HealthBackend::LoadStatus HealthBackend::readSnapshot(const std::string& path) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::string error;
+    auto snap = SnapshotFile::open(path, error);
+    if (!snap) {
+        HB_LOG_ERROR("Failed to open snapshot {} ({}).", path, error);
+        return LoadStatus::Failed;
+    }
 
+    // 換掉舊的 snapshot 之前，records 還在舊檔裡的 user 要先讀回來
+    materializeAll();
+
+    usersByName.reserve(usersByName.size() + snap->userCount());
+    for (std::size_t i = 0; i < snap->userCount(); ++i) {
         UserData data;
-        data.profile.id       = ju.value("id", name);
-        data.profile.name     = name;
-        data.profile.age      = ju.value("age", 0);
-        data.profile.weightKg = ju.value("weightKg", 0.0);
-        data.profile.heightM  = ju.value("heightM", 0.0);
-        data.profile.gender   = ju.value("gender", std::string("other"));
-
-        data.password         = ju.value("password", std::string(""));
-
-        // Waters
-        if (ju.contains("waters") && ju["waters"].is_array()) {
-            for (const auto& jw : ju["waters"]) {
-                WaterRecord w;
-                w.datetime = jw.value("datetime", std::string(""));
-                w.amountMl = jw.value("amountMl", 0.0);
-                data.waters.push_back(w);
+        snap->readProfile(i, data);
+        data.resident      = false;
+        data.counts        = snap->counts(i);
+        data.snapshotIndex = static_cast<std::uint32_t>(i);
+        std::string name   = data.profile.name;
+        usersByName.insert_or_assign(std::move(name), std::move(data));
+    }
+    snapshot = std::move(snap);
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+    HB_LOG_INFO("Loaded {} users from snapshot {} ({} bytes, {} ms, {}, records on demand)",
+                snapshot->userCount(), path, snapshot->bytes(), ms,
+                snapshot->verified() ? "checksum ok" : "no checksum");
+    return LoadStatus::Loaded;
+}
+
+// per-user 目錄：每個檔案各自驗證，壞掉的檔案各自退回自己的備份，不影響其他 user
+HealthBackend::LoadStatus HealthBackend::readUserDir(const std::string& dir) {
+    const auto start = std::chrono::steady_clock::now();
+
+    // 有 memory budget 時讀完就只留 profile 和數量，records 等用到再讀，啟動時不會先把記憶體吃滿
+    StorageLoader::Result result;
+    switch (StorageLoader::loadDirectory(dir, loadThreads, result, memoryBudget == 0)) {
+    case StorageLoader::Status::Missing:
+        return LoadStatus::Missing;
+    case StorageLoader::Status::Error:
+        HB_LOG_ERROR("Failed to read {} ({}).", dir, result.error);
+        return LoadStatus::Failed;
+    case StorageLoader::Status::Ok:
+        break;
+    }
+
+    std::vector<std::string> recovered;
+    for (const auto& failure : result.failed) {
+        HB_LOG_ERROR("Failed to load {} ({}).", failure.path, failure.error);
+        for (unsigned i = 1; i <= backups; ++i) {
+            const std::string path = util::AtomicFile::backupPath(failure.path, i);
+            UserData          data;
+            std::string       error;
+            if (StorageLoader::loadUserFile(path, data, error) == StorageLoader::Status::Ok) {
+                HB_LOG_WARN("Recovered user {} from backup {}.", data.profile.name, path);
+                recovered.push_back(data.profile.name);
+                result.users.push_back(std::move(data));
+                break;
             }
         }
+        quarantine(failure.path);
+    }
 
-        // Sleeps
-        if (ju.contains("sleeps") && ju["sleeps"].is_array()) {
-            for (const auto& js : ju["sleeps"]) {
-                SleepRecord s;
-                s.datetime = js.value("datetime", std::string(""));
-                s.hours    = js.value("hours", 0.0);
-                data.sleeps.push_back(s);
-            }
+    usersByName.reserve(usersByName.size() + result.users.size());
+    for (auto& data : result.users) {
+        std::string name = data.profile.name;
+        const UserData& user = usersByName.insert_or_assign(std::move(name), std::move(data)).first->second;
+        seal(user);
+        account(user);
+    }
+    // 從備份救回來的 user 主檔已經移走了，下次存檔要重寫
+    for (const auto& name : recovered) markDirty(usersByName.at(name));
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+    HB_LOG_INFO("Loaded {} users from {} ({} bytes, {} threads, {} ms, {} unreadable files, {} recovered)",
+                result.users.size(), dir, result.bytes, result.threads, ms, result.failed.size(),
+                recovered.size());
+    return LoadStatus::Loaded;
+}
+
+void HealthBackend::quarantine(const std::string& path) const {
+    // 轉檔工具之類不存檔的情況不要動使用者的檔案；整個目錄壞掉（列不出來）也不要動
+    if (!autoSave || dirExists(path)) return;
+    const std::string target = path + ".corrupt";
+    if (std::rename(path.c_str(), target.c_str()) == 0) {
+        HB_LOG_WARN("Moved unreadable {} to {}.", path, target);
+    }
+}
+
+void HealthBackend::markDirty(const UserData& user) const {
+    // 上次存檔的那份已經不是最新的，不能再照抄
+    auto& data         = const_cast<UserData&>(user);
+    data.snapshotIndex = UserData::kNoIndex;
+    data.jsonLength    = 0;
+    ++data.version;
+    if (user.dirty) return;
+    data.dirty = true;
+    dirtyUsers.push_back(user.profile.name);
+}
+
+void HealthBackend::clearDirty() const {
+    for (const auto& name : dirtyUsers) {
+        auto it = usersByName.find(name);
+        if (it != usersByName.end()) const_cast<UserData&>(it->second).dirty = false;
+    }
+    dirtyUsers.clear();
+}
+
+void HealthBackend::writeStorage(bool force) const {
+    if (!force && dirtyUsers.empty()) return;
+    HB_TRACE_SPAN(Persist);
+    ensureStorageDirExists();  // ⭐ 存檔前再確認一次資料夾存在
+    if (storageFormat == StorageFormat::PerUser) {
+        writeUserDir(storagePath, !force); // 自己處理 dirty（寫失敗的 user 留著下次再寫）
+    } else if (writeStorageTo(storagePath, storageFormat)) {
+        clearDirty();
+    }
+}
+
+bool HealthBackend::writeStorageTo(const std::string& path, StorageFormat format) const {
+    switch (format) {
+    case StorageFormat::Binary:
+        return writeSnapshot(path);
+    case StorageFormat::PerUser:
+        return writeUserDir(path, false);
+    case StorageFormat::Json:
+        break;
+    }
+    return writeJson(path);
+}
+
+bool HealthBackend::writeUserDir(const std::string& dir, bool dirtyOnly) const {
+    if (!dirExists(dir) && mkdir(dir.c_str(), 0755) != 0) {
+        HB_LOG_ERROR("Failed to create {}.", dir);
+        return false;
+    }
+    const bool     own  = dir == storagePath;
+    const unsigned keep = own ? backups : 0;
+
+    // 平常只有幾個 user 要寫，每個檔案都 fsync；整個目錄重寫時逐檔 fsync 太慢，最後 sync() 一次
+    std::vector<std::string> failed;
+    auto write = [&](const UserData& user, bool sync) {
+        // 自己的目錄：沒改過的 user 檔就是最新的（含不在記憶體裡的），不用重寫，也不用多輪替一份一樣的備份
+        if (own && !user.dirty) return;
+        const bool ok = withRecords(user, [&] {
+            return writeUserFile(StorageLoader::userFilePath(dir, user.profile.name), user, keep, sync);
+        });
+        if (!ok) {
+            failed.push_back(user.profile.name);
+        } else if (own) {
+            const_cast<UserData&>(user).dirty = false;
+        }
+    };
+    if (dirtyOnly) {
+        for (const auto& name : dirtyUsers) {
+            auto it = usersByName.find(name);
+            if (it != usersByName.end()) write(it->second, true);
         }
+    } else {
+        for (const auto& [name, data] : usersByName) write(data, false);
+        ::sync();
+    }
 
-        // Activities
-        if (ju.contains("activities") && ju["activities"].is_array()) {
-            for (const auto& ja : ju["activities"]) {
-                ActivityRecord a;
-                a.datetime  = ja.value("datetime", std::string(""));
-                a.minutes   = ja.value("minutes", 0);
-                a.intensity = ja.value("intensity", std::string(""));
-                data.activities.push_back(a);
-            }
+    if (own) {
+        dirtyUsers.clear();
+        for (const auto& name : failed) markDirty(usersByName.at(name));
+    }
+    return failed.empty();
+}
+
+bool HealthBackend::writeUserFile(const std::string& path, const UserData& user, unsigned keep, bool sync) const {
+    ensureBucket(path);
+    return commitFile(path, userFileDoc(user), keep, sync);
+}
+
+bool HealthBackend::writeSnapshot(const std::string& path) const {
+    SnapshotWriter writer;
+    bool ok = writer.open(path);
+    // 上次存檔之後沒改過的 user（records 還沒解開的也一樣）整塊從 snapshot 照抄，不用解開 cold blocks
+    for (auto it = usersByName.begin(); ok && it != usersByName.end(); ++it) {
+        const UserData& data = it->second;
+        if (snapshot && data.snapshotIndex != UserData::kNoIndex) {
+            ok = writer.copyUser(*snapshot, data.snapshotIndex);
+        } else {
+            ok = withRecords(data, [&] { return writer.writeUser(data); });
         }
+    }
+    if (!ok || !writer.close(path == storagePath ? backups : 0)) {
+        HB_LOG_ERROR("Failed to write snapshot {} ({}).", path, writer.error());
+        return false;
+    }
+    if (path != storagePath) return true;
+
+    // 換成剛寫好的檔案：每個 user 改指向新檔裡的位置（之後都可以被趕出去），舊檔的 mapping 就可以放掉
+    std::string error;
+    auto fresh = SnapshotFile::open(path, error);
+    if (!fresh) {
+        HB_LOG_WARN("Reopening snapshot {} failed ({}), keeping the previous mapping.", path, error);
+        return true;
+    }
+    std::uint32_t index = 0;
+    for (auto& [name, data] : usersByName) const_cast<UserData&>(data).snapshotIndex = index++;
+    snapshot = std::move(fresh);
+    return true;
+}
 
-        // Categories
-        if (ju.contains("categories") && ju["categories"].is_object()) {
-            for (auto it = ju["categories"].begin();
-                 it != ju["categories"].end(); ++it) {
-                const std::string catName = it.key();
-                const auto& arr = it.value();
-                if (!arr.is_array()) continue;
-
-                std::vector<CategoryItem> items;
-                for (const auto& ji : arr) {
-                    CategoryItem item;
-                    item.datetime = ji.value("datetime", std::string(""));
-                    item.note     = ji.value("note", std::string(""));
-                    item.value    = ji.value("value", 0.0);
-                    items.push_back(item);
+bool HealthBackend::openPreviousJson(util::MappedFile& previous) const {
+    return jsonWrittenSize > 0 && previous.open(storagePath) && previous.size() == jsonWrittenSize;
+}
+
+bool HealthBackend::buildJson(const util::MappedFile* previous, bool materialize, std::string& doc,
+                              std::vector<WrittenUser>& users) const {
+    // 跟 json::dump(2) 排出來的一樣：{"users": [...]}，每個 user 縮排 4 格
+    doc = "{\n  \"users\": [";
+    users.clear();
+    users.reserve(usersByName.size());
+    for (const auto& [name, data] : usersByName) {
+        const std::size_t mark = doc.size();
+        doc += users.empty() ? "\n    " : ",\n    ";
+        const std::size_t begin = doc.size();
+        // 上次寫完之後沒改過的 user 從舊檔整段照抄（UserData::jsonOffset）
+        const char* from = previous && data.jsonLength > 0 && data.jsonOffset + data.jsonLength <= previous->size()
+                               ? previous->data() + data.jsonOffset : nullptr;
+        if (from && from[0] == '{' && from[data.jsonLength - 1] == '}') {
+            doc.append(from, data.jsonLength);
+        } else if (!data.resident && !materialize) {
+            return false;
+        } else {
+            withRecords(data, [&] {
+                const std::string user = userToJson(data).dump(2);
+                for (char c : user) {
+                    doc += c;
+                    if (c == '\n') doc += "    ";
                 }
-                data.categories[catName] = std::move(items);
-            }
+                return true;
+            });
+        }
+        if (doc.size() == begin) {
+            doc.resize(mark); // records 讀不回來：跟以前一樣整個 user 跳過
+            continue;
         }
+        users.push_back(WrittenUser{name, data.version, begin, doc.size()});
+    }
+    doc += users.empty() ? "]\n}" : "\n  ]\n}";
+    StorageLoader::appendChecksum(doc);
+    return true;
+}
 
-        usersByName[name] = std::move(data);
+bool HealthBackend::writeJson(const std::string& path) const {
+    const bool               own = path == storagePath;
+    util::MappedFile         previous;
+    std::string              doc;
+    std::vector<WrittenUser> users;
+    buildJson(own && openPreviousJson(previous) ? &previous : nullptr, true, doc, users);
+    if (!commitFile(path, doc, own ? backups : 0, true)) return false;
+    if (!own) return true;
+
+    for (const auto& w : users) {
+        auto& data      = const_cast<UserData&>(usersByName.at(w.name));
+        data.jsonOffset = w.begin;
+        data.jsonLength = w.end - w.begin;
     }
+    jsonWrittenSize = doc.size();
+    return true;
+}
+
+void HealthBackend::loadFromFile() {
+    std::lock_guard<std::mutex>         serial(checkpointMtx);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    readStorage();
 }
 
 void HealthBackend::saveToFile() const {
-    ensureStorageDirExists();  // ⭐ 存檔前再確認一次資料夾存在
+    std::lock_guard<std::mutex>         serial(checkpointMtx);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    writeStorage(true);
+}
 
-    json j;
-    j["users"] = json::array();
+bool HealthBackend::exportTo(const std::string& path, StorageFormat format) const {
+    std::lock_guard<std::mutex>         serial(checkpointMtx);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    return writeStorageTo(path, format);
+}
 
-    for (const auto& [name, data] : usersByName) {
-        json ju;
-        ju["id"]       = data.profile.id;
-        ju["name"]     = data.profile.name;
-        ju["age"]      = data.profile.age;
-        ju["weightKg"] = data.profile.weightKg;
-        ju["heightM"]  = data.profile.heightM;
-        ju["gender"]   = data.profile.gender;
-
-        ju["password"] = data.password;
-
-        // Waters
-        ju["waters"] = json::array();
-        for (const auto& w : data.waters) {
-            json jw;
-            jw["datetime"] = w.datetime;
-            jw["amountMl"] = w.amountMl;
-            ju["waters"].push_back(jw);
+void HealthBackend::flush() const {
+    checkpoint();
+}
+
+// ----------------------
+// 背景存檔（autoSave）
+// ----------------------
+
+void HealthBackend::requestFlush() const {
+    std::lock_guard<std::mutex> lk(flushMtx);
+    if (flushPending) return;
+    flushPending = true;
+    flushCv.notify_one();
+}
+
+void HealthBackend::flushLoop() {
+    std::unique_lock<std::mutex> lk(flushMtx);
+    while (true) {
+        flushCv.wait(lk, [&] { return flushPending || flushStop; });
+        // 等一下，把這段時間的修改湊成一次存檔；要關了就交給 destructor 寫
+        flushCv.wait_for(lk, std::chrono::milliseconds(flushIntervalMs), [&] { return flushStop; });
+        if (flushStop) return;
+        flushPending = false;
+        lk.unlock();
+        try {
+            checkpoint();
+        } catch (const std::exception& e) {
+            HB_LOG_ERROR("Background save failed: {}.", e.what());
         }
+        lk.lock();
+    }
+}
+
+void HealthBackend::checkpoint() const {
+    std::lock_guard<std::mutex> serial(checkpointMtx);
+    HB_TRACE_SPAN(Persist);
+    if (!scratch) scratch = std::make_unique<Checkpoint>();
+    Checkpoint& cp = *scratch;
+    cp.clear();
+    bool prepared;
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        if (dirtyUsers.empty()) return;
+        prepared = prepareCheckpoint(cp);
+    }
+    if (!prepared) {
+        // 有 user 要先把 records 讀回來才寫得出去（要改 UserData）：這次照舊拿 unique lock 存
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        writeStorage(false);
+        return;
+    }
 
-        // Sleeps
-        ju["sleeps"] = json::array();
-        for (const auto& s : data.sleeps) {
-            json js;
-            js["datetime"] = s.datetime;
-            js["hours"]    = s.hours;
-            ju["sleeps"].push_back(js);
+    const bool ok = writeCheckpoint(cp);
+
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    finishCheckpoint(cp);
+    cp.clear();
+    enforceBudget(nullptr); // 剛寫好的 user 可以趕出去了
+    if (!ok) requestFlush(); // 寫失敗的下一輪再試
+}
+
+bool HealthBackend::prepareCheckpoint(Checkpoint& cp) const {
+    ensureStorageDirExists();
+    switch (storageFormat) {
+    case StorageFormat::PerUser:
+        if (!dirExists(storagePath) && mkdir(storagePath.c_str(), 0755) != 0) return false;
+        for (const auto& name : dirtyUsers) {
+            auto it = usersByName.find(name);
+            if (it == usersByName.end()) continue;
+            if (!it->second.resident) return false;
+            cp.users.push_back(WrittenUser{name, it->second.version});
+            cp.files.push_back(userFileDoc(it->second));
+        }
+        return true;
+    case StorageFormat::Binary:
+        cp.writer = std::make_unique<SnapshotWriter>();
+        cp.source = snapshot;
+        if (!cp.writer->open(storagePath)) return false;
+        for (const auto& [name, data] : usersByName) {
+            bool ok;
+            if (cp.source && data.snapshotIndex != UserData::kNoIndex) {
+                ok = cp.writer->copyUser(*cp.source, data.snapshotIndex);
+            } else if (data.resident) {
+                ok = cp.writer->writeUser(data);
+            } else {
+                return false;
+            }
+            if (!ok) return false;
+            cp.users.push_back(WrittenUser{name, data.version});
         }
+        return true;
+    case StorageFormat::Json:
+        break;
+    }
+    util::MappedFile previous;
+    return buildJson(openPreviousJson(previous) ? &previous : nullptr, false, cp.doc, cp.users);
+}
 
-        // Activities
-        ju["activities"] = json::array();
-        for (const auto& a : data.activities) {
-            json ja;
-            ja["datetime"]  = a.datetime;
-            ja["minutes"]   = a.minutes;
-            ja["intensity"] = a.intensity;
-            ju["activities"].push_back(ja);
+bool HealthBackend::writeCheckpoint(Checkpoint& cp) const {
+    switch (storageFormat) {
+    case StorageFormat::PerUser: {
+        bool ok = true;
+        for (std::size_t i = 0; i < cp.users.size(); ++i) {
+            const std::string path = StorageLoader::userFilePath(storagePath, cp.users[i].name);
+            ensureBucket(path);
+            cp.users[i].ok = commitFile(path, cp.files[i], backups, true);
+            ok             = ok && cp.users[i].ok;
+        }
+        return ok;
+    }
+    case StorageFormat::Binary: {
+        if (!cp.writer->close(backups)) {
+            HB_LOG_ERROR("Failed to write snapshot {} ({}).", storagePath, cp.writer->error());
+            for (auto& w : cp.users) w.ok = false;
+            return false;
         }
+        std::string error;
+        cp.fresh = SnapshotFile::open(storagePath, error);
+        if (!cp.fresh) HB_LOG_WARN("Reopening snapshot {} failed ({}), keeping the previous mapping.", storagePath, error);
+        return true;
+    }
+    case StorageFormat::Json:
+        break;
+    }
+    const bool ok = commitFile(storagePath, cp.doc, backups, true);
+    for (auto& w : cp.users) w.ok = ok;
+    return ok;
+}
 
-        // Categories
-        ju["categories"] = json::object();
-        for (const auto& [catName, items] : data.categories) {
-            json arr = json::array();
-            for (const auto& item : items) {
-                json ji;
-                ji["datetime"] = item.datetime;
-                ji["note"]     = item.note;
-                ji["value"]    = item.value;
-                arr.push_back(ji);
-            }
-            ju["categories"][catName] = arr;
+void HealthBackend::finishCheckpoint(const Checkpoint& cp) const {
+    for (std::size_t i = 0; i < cp.users.size(); ++i) {
+        const WrittenUser& w  = cp.users[i];
+        auto               it = usersByName.find(w.name);
+        // 寫出去之後又改過：還是 dirty，位置也不能用（markDirty 已經清掉了），下次再寫
+        if (!w.ok || it == usersByName.end() || it->second.version != w.version) continue;
+        auto& data = const_cast<UserData&>(it->second);
+        data.dirty = false;
+        if (storageFormat == StorageFormat::Json) {
+            data.jsonOffset = w.begin;
+            data.jsonLength = w.end - w.begin;
+        } else if (storageFormat == StorageFormat::Binary && cp.fresh) {
+            data.snapshotIndex = static_cast<std::uint32_t>(i);
         }
+    }
+    if (storageFormat == StorageFormat::Json && !cp.users.empty() && cp.users.front().ok) {
+        jsonWrittenSize = cp.doc.size();
+    }
+    if (cp.fresh) snapshot = cp.fresh;
+
+    dirtyUsers.erase(std::remove_if(dirtyUsers.begin(), dirtyUsers.end(),
+                                    [&](const std::string& name) {
+                                        auto it = usersByName.find(name);
+                                        return it == usersByName.end() || !it->second.dirty;
+                                    }),
+                     dirtyUsers.end());
+}
 
-        j["users"].push_back(ju);
+// ----------------------
+// Records 快取：snapshot / per-user 檔 ⇄ 記憶體
+// ----------------------
+
+bool HealthBackend::materialize(const UserData& user) const {
+    if (user.resident) return true;
+    // 呼叫端拿著 unique lock，沒有別人在讀這個 user
+    auto& data = const_cast<UserData&>(user);
+    if (snapshot && data.snapshotIndex != UserData::kNoIndex) {
+        if (!snapshot->readRecords(data.snapshotIndex, data)) {
+            HB_LOG_ERROR("Snapshot {}: corrupted records for user {}, kept what could be read.",
+                         storagePath, data.profile.name);
+        }
+    } else {
+        // per-user 格式：只要 records，profile 以記憶體裡的為準
+        const std::string path = StorageLoader::userFilePath(storagePath, data.profile.name);
+        UserData          fromDisk;
+        std::string       error;
+        if (StorageLoader::loadUserFile(path, fromDisk, error) != StorageLoader::Status::Ok) {
+            HB_LOG_ERROR("Failed to reload records of user {} from {} ({}).", data.profile.name, path,
+                         error.empty() ? "missing" : error);
+            return false;
+        }
+        data.waters     = std::move(fromDisk.waters);
+        data.sleeps     = std::move(fromDisk.sleeps);
+        data.activities  = std::move(fromDisk.activities);
+        data.intensities = std::move(fromDisk.intensities);
+        data.categories  = std::move(fromDisk.categories);
     }
+    data.resident = true;
+    seal(data);
+    account(data);
+    return true;
+}
 
-    std::ofstream out(storagePath);
-    if (!out) {
-        util::Logger::error(std::string("Failed to open ") + storagePath + " for writing.");
-        return;
+void HealthBackend::materializeAll() const {
+    for (const auto& [name, data] : usersByName) materialize(data);
+}
+
+template <typename Fn>
+bool HealthBackend::withRecords(const UserData& user, Fn&& fn) const {
+    const bool wasResident = user.resident;
+    if (!materialize(user)) return false;
+    const bool ok = fn();
+    if (!wasResident && canEvict(user)) evict(user);
+    return ok;
+}
+
+void HealthBackend::touch(const UserData& user) const {
+    (user.resident ? recordHits : recordMisses).fetch_add(1, std::memory_order_relaxed);
+    if (memoryBudget == 0) return;
+    user.lastUsed.value.store(accessClock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void HealthBackend::account(const UserData& user) const {
+    if (memoryBudget == 0 || !user.resident) return;
+    auto&             data  = const_cast<UserData&>(user);
+    const std::size_t bytes = recordBytes(data);
+    residentBytes           = residentBytes - data.residentBytes + bytes;
+    data.residentBytes      = bytes;
+}
+
+// 趕出去之後要讀得回來：磁碟上那份是最新的（不 dirty），而且找得到（snapshot 裡有位置 / per-user 檔）
+bool HealthBackend::canEvict(const UserData& user) const {
+    if (!user.resident || user.dirty) return false;
+    if (snapshot && user.snapshotIndex != UserData::kNoIndex) return true;
+    return storageFormat == StorageFormat::PerUser && dirExists(storagePath);
+}
+
+void HealthBackend::evict(const UserData& user) const {
+    auto& data  = const_cast<UserData&>(user);
+    data.counts = data.recordCounts();
+    // swap 才會真的把 capacity 還回去，clear() 不會
+    std::vector<WaterRecord>().swap(data.waters);
+    std::vector<SleepRecord>().swap(data.sleeps);
+    std::vector<ActivityRecord>().swap(data.activities);
+    data.intensities.clear();
+    data.categories.clear();
+    data.cold     = ColdHistory{};
+    data.byDuration.clear();
+    data.byDurationBuilt = false;
+    data.resident = false;
+    residentBytes -= data.residentBytes;
+    data.residentBytes = 0;
+    evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HealthBackend::indexDurations(const UserData& user) const {
+    auto&            data = const_cast<UserData&>(user);
+    std::vector<int> minutes;
+    minutes.reserve(data.cold.activities.count + data.activities.size());
+    if (data.cold.activities.count > 0) {
+        std::vector<ActivityRecord> cold;
+        ColdTier::append(data.cold.activities, cold);
+        for (const auto& a : cold) minutes.push_back(a.minutes);
+    }
+    for (const auto& a : data.activities) minutes.push_back(a.minutes);
+    data.byDuration.build(minutes);
+    data.byDurationBuilt = true;
+    account(data);
+}
+
+void HealthBackend::buildLeaderboards() const {
+    activityBoard.clear();
+    waterBoard.clear();
+    for (const auto& [name, data] : usersByName) {
+        // records 不在記憶體裡的 user 暫時讀回來，掃完再丟掉
+        withRecords(data, [&, &name = name, &data = data] {
+            forEachRecord(data.cold.activities, data.activities,
+                          [&](const ActivityRecord& a) { boardAdd(activityBoard, name, a.datetime, a.minutes); });
+            forEachRecord(data.cold.waters, data.waters,
+                          [&](const WaterRecord& w) { boardAdd(waterBoard, name, w.datetime, 1); });
+            return true;
+        });
     }
-    out << j.dump(2);
+    leaderboardsBuilt = true;
+}
+
+void HealthBackend::seal(const UserData& user) const {
+    if (coldAfterMs == 0 || !user.resident) return;
+    auto&              data   = const_cast<UserData&>(user);
+    const std::int64_t cutoff = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    std::chrono::system_clock::now().time_since_epoch()).count() - coldAfterMs;
+    ColdTier::seal(data.cold.waters, data.waters, cutoff);
+    ColdTier::seal(data.cold.sleeps, data.sleeps, cutoff);
+    ColdTier::seal(data.cold.activities, data.activities, cutoff);
+    for (auto& [name, items] : data.categories) {
+        if (ColdSeries* cold = coldItems(data, name)) {
+            ColdTier::seal(*cold, items, cutoff);
+            continue;
+        }
+        // 真的有封存才建 cold 的 entry
+        ColdSeries fresh;
+        if (ColdTier::seal(fresh, items, cutoff) > 0) data.cold.categories.emplace(name, std::move(fresh));
+    }
+}
+
+void HealthBackend::enforceBudget(const UserData* keep) const {
+    if (memoryBudget == 0 || residentBytes <= std::max(memoryBudget, enforceAbove)) return;
+
+    // 近似 LRU：照最後使用時間排序，從最舊的開始趕到 budget 的 90%，不用每次只超一點就掃一次
+    std::vector<std::pair<std::uint64_t, const UserData*>> cold;
+    for (const auto& [name, data] : usersByName) {
+        if (&data != keep && canEvict(data)) {
+            cold.emplace_back(data.lastUsed.value.load(std::memory_order_relaxed), &data);
+        }
+    }
+    std::sort(cold.begin(), cold.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    const std::size_t target = memoryBudget / 10 * 9;
+    for (const auto& [stamp, data] : cold) {
+        if (residentBytes <= target) break;
+        evict(*data);
+    }
+    // 剩下的都是還沒存檔的 user（autoSave 關掉 / 寫檔失敗）：先不要每次修改都重掃，多長 10% 再試
+    enforceAbove = residentBytes > memoryBudget ? residentBytes + memoryBudget / 10 : 0;
 }
 
 // ----------------------
 // Token → UserData
 // ----------------------
 
-HealthBackend::UserData* HealthBackend::getUserByToken(const std::string& token) {
+HealthBackend::UserData* HealthBackend::getUserByToken(std::string_view token) {
+    HB_TRACE_SPAN(Auth);
     auto itTok = tokenToName.find(token);
     if (itTok == tokenToName.end()) return nullptr;
     auto itUser = usersByName.find(itTok->second);
     if (itUser == usersByName.end()) return nullptr;
+    touch(itUser->second);
+    if (!materialize(itUser->second)) return nullptr;
     return &itUser->second;
 }
 
-const HealthBackend::UserData* HealthBackend::getUserByToken(const std::string& token) const {
+const HealthBackend::UserData* HealthBackend::getUserByToken(std::string_view token) const {
+    HB_TRACE_SPAN(Auth);
     auto itTok = tokenToName.find(token);
     if (itTok == tokenToName.end()) return nullptr;
     auto itUser = usersByName.find(itTok->second);
@@ -300,7 +1099,31 @@ const HealthBackend::UserData* HealthBackend::getUserByToken(const std::string&
     return &itUser->second;
 }
 
-bool HealthBackend::hasUserForToken(const std::string& token) const {
+const HealthBackend::UserData* HealthBackend::getUserRecordsByToken(
+    std::string_view token, std::shared_lock<std::shared_mutex>& lock) const {
+    const UserData* user = getUserByToken(token);
+    if (!user) return nullptr;
+    touch(*user);
+    while (user && !user->resident) {
+        lock.unlock();
+        bool loaded = true;
+        {
+            std::unique_lock<std::shared_mutex> writeLock(mtx);
+            if (const UserData* u = getUserByToken(token)) {
+                loaded = materialize(*u);
+                enforceBudget(u);
+            }
+        }
+        lock.lock();
+        if (!loaded) return nullptr;
+        // 換鎖的空檔裡資料可能被換掉（或又被趕出去），重新找一次
+        user = getUserByToken(token);
+    }
+    return user;
+}
+
+bool HealthBackend::hasUserForToken(std::string_view token) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
     return getUserByToken(token) != nullptr;
 }
 
@@ -314,6 +1137,8 @@ bool HealthBackend::registerUser(const std::string& name,
                                  double             heightM,
                                  const std::string& password,
                                  const std::string& gender) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     if (name.empty() || password.empty()) return false;
     if (age <= 0 || weightKg <= 0.0 || heightM <= 0.0) return false;
 
@@ -331,40 +1156,43 @@ bool HealthBackend::registerUser(const std::string& name,
     data.profile.gender   = gender;
     data.password         = password;
 
-    usersByName[name] = std::move(data);
-    saveToFile();
-    util::Logger::info(std::string("registerUser: created user: ") + name);
+    persist(usersByName.emplace(name, std::move(data)).first->second);
+    HB_LOG_INFO("registerUser: created user: {}", name);
     return true;
 }
 
 std::string HealthBackend::login(const std::string& name,
                                  const std::string& password) {
+    HB_TRACE_SPAN(Auth);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     auto it = usersByName.find(name);
     if (it == usersByName.end()) {
-        util::Logger::warn(std::string("login: user not found: ") + name);
+        HB_LOG_WARN("login: user not found: {}", name);
         return "INVALID";
     }
     if (it->second.password != password) {
-        util::Logger::warn(std::string("login: bad password for user: ") + name);
+        HB_LOG_WARN("login: bad password for user: {}", name);
         return "INVALID";
     }
 
     // 產生新的 token
     std::string token = generateToken();
-    tokenToName[token] = name;
-    util::Logger::info(std::string("login: user= ") + name + " token=" + token);
+    tokenToName.insert_or_assign(token, name);
+    HB_LOG_INFO("login: user= {} token={}", name, token);
     return token;
 }
 
-bool HealthBackend::getUserProfile(const std::string& token,
+bool HealthBackend::getUserProfile(std::string_view   token,
                                    UserProfile&       outProfile) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
     const UserData* user = getUserByToken(token);
     if (!user) return false;
     outProfile = user->profile;
     return true;
 }
 
-double HealthBackend::getBMI(const std::string& token) const {
+double HealthBackend::getBMI(std::string_view token) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
     const UserData* user = getUserByToken(token);
     if (!user) return 0.0;
     if (user->profile.heightM <= 0.0) return 0.0;
@@ -377,10 +1205,14 @@ double HealthBackend::getBMI(const std::string& token) const {
 // Waters
 // ----------------------
 
-bool HealthBackend::addWater(const std::string& token,
+bool HealthBackend::addWater(std::string_view   token,
                              const std::string& datetime,
-                             double             amountMl) {
+                             double             amountMl,
+                             std::size_t*       index) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     if (amountMl <= 0.0) return false;
+    if (!util::PackedDateTime::storable(datetime)) return false;
     UserData* user = getUserByToken(token);
     if (!user) return false;
 
@@ -388,39 +1220,68 @@ bool HealthBackend::addWater(const std::string& token,
     w.datetime = datetime;
     w.amountMl = amountMl;
     user->waters.push_back(w);
-    saveToFile();
+    if (leaderboardsBuilt) boardAdd(waterBoard, user->profile.name, w.datetime, 1);
+    if (index) *index = user->cold.waters.count + user->waters.size() - 1;
+    persist(*user);
     return true;
 }
 
-std::vector<WaterRecord> HealthBackend::getAllWater(const std::string& token) const {
-    const UserData* user = getUserByToken(token);
+bool HealthBackend::getWater(std::string_view token, std::size_t index, WaterRecord& out) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return false;
+    return recordAt(&user->cold.waters, user->waters, index, out);
+}
+
+std::vector<WaterRecord> HealthBackend::getAllWater(std::string_view token) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
     if (!user) return {};
-    return user->waters;
+    return allRecords(&user->cold.waters, user->waters);
 }
 
-bool HealthBackend::updateWater(const std::string& token,
+std::vector<std::pair<std::size_t, WaterRecord>> HealthBackend::getWaterBetween(std::string_view   token,
+                                                                                std::int64_t       fromMs,
+                                                                                std::int64_t       toMs) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return {};
+    return recordsBetween(&user->cold.waters, user->waters, fromMs, toMs);
+}
+
+bool HealthBackend::updateWater(std::string_view   token,
                                 std::size_t       index,
                                 const std::string& newDatetime,
                                 double             newAmountMl) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     if (newAmountMl <= 0.0) return false;
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    if (index >= user->waters.size()) return false;
-
-    user->waters[index].datetime = newDatetime;
-    user->waters[index].amountMl = newAmountMl;
-    saveToFile();
+    if (!datetimeAccepted(&user->cold.waters, user->waters, index, newDatetime)) return false;
+    const bool found = editRecord(&user->cold.waters, user->waters, index, [&](WaterRecord& w) {
+        if (leaderboardsBuilt) boardRemove(waterBoard, user->profile.name, w.datetime, 1);
+        w.datetime = newDatetime;
+        w.amountMl = newAmountMl;
+        if (leaderboardsBuilt) boardAdd(waterBoard, user->profile.name, w.datetime, 1);
+    });
+    if (!found) return false;
+    persist(*user);
     return true;
 }
 
-bool HealthBackend::deleteWater(const std::string& token,
+bool HealthBackend::deleteWater(std::string_view   token,
                                 std::size_t       index) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    if (index >= user->waters.size()) return false;
+    WaterRecord w;
+    if (!recordAt(&user->cold.waters, user->waters, index, w)) return false;
 
-    user->waters.erase(user->waters.begin() + static_cast<long>(index));
-    saveToFile();
+    if (leaderboardsBuilt) boardRemove(waterBoard, user->profile.name, w.datetime, 1);
+    eraseRecord(&user->cold.waters, user->waters, index);
+    persist(*user);
     return true;
 }
 
@@ -428,13 +1289,17 @@ bool HealthBackend::deleteWater(const std::string& token,
 // Sleeps
 // ----------------------
 
-bool HealthBackend::addSleep(const std::string& token,
+bool HealthBackend::addSleep(std::string_view   token,
                              const std::string& datetime,
-                             double             hours) {
+                             double             hours,
+                             std::size_t*       index) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     if (hours < 0.0) {
-        util::Logger::warn(std::string("addSleep: invalid hours: ") + std::to_string(hours));
+        HB_LOG_WARN("addSleep: invalid hours: {}", hours);
         return false;
     }
+    if (!util::PackedDateTime::storable(datetime)) return false;
     UserData* user = getUserByToken(token);
     if (!user) return false;
 
@@ -442,40 +1307,62 @@ bool HealthBackend::addSleep(const std::string& token,
     s.datetime = datetime;
     s.hours    = hours;
     user->sleeps.push_back(s);
-    saveToFile();
-    util::Logger::info(std::string("addSleep: user token found, added sleep for token: ") + token);
+    if (index) *index = user->cold.sleeps.count + user->sleeps.size() - 1;
+    persist(*user);
+    HB_LOG_INFO("addSleep: user token found, added sleep for token: {}", token);
     return true;
 }
 
-std::vector<SleepRecord> HealthBackend::getAllSleep(const std::string& token) const {
-    const UserData* user = getUserByToken(token);
+bool HealthBackend::getSleep(std::string_view token, std::size_t index, SleepRecord& out) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return false;
+    return recordAt(&user->cold.sleeps, user->sleeps, index, out);
+}
+
+std::vector<SleepRecord> HealthBackend::getAllSleep(std::string_view token) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
     if (!user) return {};
-    return user->sleeps;
+    return allRecords(&user->cold.sleeps, user->sleeps);
 }
 
-bool HealthBackend::updateSleep(const std::string& token,
+std::vector<std::pair<std::size_t, SleepRecord>> HealthBackend::getSleepBetween(std::string_view   token,
+                                                                                std::int64_t       fromMs,
+                                                                                std::int64_t       toMs) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return {};
+    return recordsBetween(&user->cold.sleeps, user->sleeps, fromMs, toMs);
+}
+
+bool HealthBackend::updateSleep(std::string_view   token,
                                 std::size_t       index,
                                 const std::string& newDatetime,
                                 double             newHours) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     if (newHours < 0.0) return false;
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    if (index >= user->sleeps.size()) return false;
-
-    user->sleeps[index].datetime = newDatetime;
-    user->sleeps[index].hours    = newHours;
-    saveToFile();
+    if (!datetimeAccepted(&user->cold.sleeps, user->sleeps, index, newDatetime)) return false;
+    const bool found = editRecord(&user->cold.sleeps, user->sleeps, index, [&](SleepRecord& s) {
+        s.datetime = newDatetime;
+        s.hours    = newHours;
+    });
+    if (!found) return false;
+    persist(*user);
     return true;
 }
 
-bool HealthBackend::deleteSleep(const std::string& token,
+bool HealthBackend::deleteSleep(std::string_view   token,
                                 std::size_t       index) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    if (index >= user->sleeps.size()) return false;
-
-    user->sleeps.erase(user->sleeps.begin() + static_cast<long>(index));
-    saveToFile();
+    if (!eraseRecord(&user->cold.sleeps, user->sleeps, index)) return false;
+    persist(*user);
     return true;
 }
 
@@ -483,54 +1370,166 @@ bool HealthBackend::deleteSleep(const std::string& token,
 // Activities
 // ----------------------
 
-bool HealthBackend::addActivity(const std::string& token,
+// 常見的 intensity 固定住（util::Symbol::permanent）：這幾個值不用記在 UserData::intensities，getter 也不用替它們留 reference。
+// 載入前就要 intern 好，載入的 records 才會直接拿到固定的那份
+static const util::Symbol kCommonIntensities[] = {util::Symbol::permanent("low"), util::Symbol::permanent("moderate"),
+                                                  util::Symbol::permanent("high")};
+
+// 其他 intensity 照樣 intern，最後一筆用到它的 record 刪掉就釋放。false = symbol 表滿了
+static bool intensitySymbol(std::string_view name, util::Symbol& out) {
+    for (const util::Symbol& level : kCommonIntensities) {
+        if (level.str() == name) {
+            out = level;
+            return true;
+        }
+    }
+    return util::Symbol::tryIntern(name, out);
+}
+
+bool HealthBackend::addActivity(std::string_view   token,
                                 const std::string& datetime,
                                 int                minutes,
-                                const std::string& intensity) {
+                                const std::string& intensity,
+                                std::size_t*       index) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     if (minutes <= 0) return false;
+    if (!util::PackedDateTime::storable(datetime)) return false;
+    util::Symbol level;
+    if (!intensitySymbol(intensity, level)) return false;
     UserData* user = getUserByToken(token);
     if (!user) return false;
 
     ActivityRecord a;
     a.datetime  = datetime;
     a.minutes   = minutes;
-    a.intensity = intensity;
+    a.intensity = level;
     user->activities.push_back(a);
-    saveToFile();
+    user->holdIntensity(level);
+    const std::size_t id = user->cold.activities.count + user->activities.size() - 1;
+    if (user->byDurationBuilt) user->byDuration.insert(id, minutes);
+    if (leaderboardsBuilt) boardAdd(activityBoard, user->profile.name, a.datetime, minutes);
+    if (index) *index = id;
+    persist(*user);
     return true;
 }
 
-std::vector<ActivityRecord> HealthBackend::getAllActivity(const std::string& token) const {
-    const UserData* user = getUserByToken(token);
+// 交到 lock 外面的 activities 要留的 reference：這個 user 所有不是 permanent 的 intensity（通常沒有，不配置）
+static std::vector<util::Symbol> pinIntensities(const HealthBackend::UserData& user) {
+    std::vector<util::Symbol> symbols;
+    symbols.reserve(user.intensities.size());
+    for (const auto& [symbol, uses] : user.intensities) symbols.push_back(symbol);
+    return symbols;
+}
+
+bool HealthBackend::getActivity(std::string_view token, std::size_t index, Pinned<ActivityRecord>& out) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return false;
+    if (!recordAt(&user->cold.activities, user->activities, index, out.value)) return false;
+    out.symbols = pinIntensities(*user);
+    return true;
+}
+
+Pinned<std::vector<ActivityRecord>> HealthBackend::getAllActivity(std::string_view token) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return {};
+    return {allRecords(&user->cold.activities, user->activities), pinIntensities(*user)};
+}
+
+Pinned<std::vector<std::pair<std::size_t, ActivityRecord>>> HealthBackend::getActivityBetween(
+    std::string_view token, std::int64_t fromMs, std::int64_t toMs) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return {};
+    return {recordsBetween(&user->cold.activities, user->activities, fromMs, toMs), pinIntensities(*user)};
+}
+
+Pinned<std::vector<std::pair<std::size_t, ActivityRecord>>> HealthBackend::getActivitiesByDuration(
+    std::string_view token, std::size_t limit) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    // index 還沒建：跟 getUserRecordsByToken 一樣暫時換成 unique lock
+    while (user && !user->byDurationBuilt) {
+        lock.unlock();
+        {
+            std::unique_lock<std::shared_mutex> writeLock(mtx);
+            const UserData* u = getUserByToken(token);
+            if (u && u->resident && !u->byDurationBuilt) indexDurations(*u);
+        }
+        lock.lock();
+        user = getUserRecordsByToken(token, lock);
+    }
     if (!user) return {};
-    return user->activities;
+
+    const auto&       entries   = user->byDuration.entries();
+    const std::size_t k         = std::min(limit, entries.size());
+    const std::size_t coldCount = user->cold.activities.count;
+    std::vector<std::pair<std::size_t, ActivityRecord>> out;
+    out.reserve(k);
+    // 落在 cold 的那幾筆最後一起解（ColdTier::gather：每個 block 只解一次），不要一筆解一個 block
+    std::vector<std::size_t> coldIndices, coldSlots;
+    for (std::size_t i = 0; i < k; ++i) {
+        const std::size_t pos = entries[i].pos;
+        if (pos < coldCount) {
+            coldSlots.push_back(out.size());
+            coldIndices.push_back(pos);
+            out.emplace_back(pos, ActivityRecord{});
+        } else if (pos - coldCount < user->activities.size()) {
+            out.emplace_back(pos, user->activities[pos - coldCount]);
+        }
+    }
+    if (!coldIndices.empty()) {
+        std::vector<ActivityRecord> cold(coldIndices.size());
+        ColdTier::gather(user->cold.activities, coldIndices, cold);
+        for (std::size_t j = 0; j < coldSlots.size(); ++j) out[coldSlots[j]].second = std::move(cold[j]);
+    }
+    return {std::move(out), pinIntensities(*user)};
 }
 
-bool HealthBackend::updateActivity(const std::string& token,
+bool HealthBackend::updateActivity(std::string_view   token,
                                    std::size_t       index,
                                    const std::string& newDatetime,
                                    int                newMinutes,
                                    const std::string& newIntensity) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     if (newMinutes <= 0) return false;
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    if (index >= user->activities.size()) return false;
-
-    user->activities[index].datetime  = newDatetime;
-    user->activities[index].minutes   = newMinutes;
-    user->activities[index].intensity = newIntensity;
-    saveToFile();
+    util::Symbol level;
+    if (!intensitySymbol(newIntensity, level)) return false;
+    if (!datetimeAccepted(&user->cold.activities, user->activities, index, newDatetime)) return false;
+    const bool found = editRecord(&user->cold.activities, user->activities, index, [&](ActivityRecord& a) {
+        if (user->byDurationBuilt) user->byDuration.update(index, a.minutes, newMinutes);
+        if (leaderboardsBuilt) boardRemove(activityBoard, user->profile.name, a.datetime, a.minutes);
+        user->holdIntensity(level);
+        user->dropIntensity(a.intensity);
+        a.datetime  = newDatetime;
+        a.minutes   = newMinutes;
+        a.intensity = level;
+        if (leaderboardsBuilt) boardAdd(activityBoard, user->profile.name, a.datetime, a.minutes);
+    });
+    if (!found) return false;
+    persist(*user);
     return true;
 }
 
-bool HealthBackend::deleteActivity(const std::string& token,
+bool HealthBackend::deleteActivity(std::string_view   token,
                                    std::size_t       index) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    if (index >= user->activities.size()) return false;
+    ActivityRecord a;
+    if (!recordAt(&user->cold.activities, user->activities, index, a)) return false;
 
-    user->activities.erase(user->activities.begin() + static_cast<long>(index));
-    saveToFile();
+    if (user->byDurationBuilt) user->byDuration.erase(index, a.minutes);
+    if (leaderboardsBuilt) boardRemove(activityBoard, user->profile.name, a.datetime, a.minutes);
+    eraseRecord(&user->cold.activities, user->activities, index);
+    user->dropIntensity(a.intensity);
+    persist(*user);
     return true;
 }
 
@@ -538,45 +1537,56 @@ bool HealthBackend::deleteActivity(const std::string& token,
 // Custom Categories
 // ----------------------
 
-std::vector<std::string> HealthBackend::getOtherCategories(const std::string& token) const {
-    const UserData* user = getUserByToken(token);
+std::vector<std::string> HealthBackend::getOtherCategories(std::string_view token) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
     if (!user) return {};
 
     std::vector<std::string> cats;
     for (const auto& [name, _vec] : user->categories) {
-        cats.push_back(name);
+        cats.push_back(name.str());
     }
+    // map 是照 symbol id，列表照名字排
+    std::sort(cats.begin(), cats.end());
     return cats;
 }
 
-bool HealthBackend::createCategory(const std::string& token,
+bool HealthBackend::createCategory(std::string_view   token,
                                    const std::string& name)
 {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     if (name.empty()) return false;
     UserData* user = getUserByToken(token);
     if (!user) return false;
 
-    if (user->categories.find(name) != user->categories.end())
+    util::Symbol key;
+    if (findCategory(user->categories, name) != user->categories.end())
         return false; // 已存在
+    if (!util::Symbol::tryIntern(name, key)) return false;
 
-    user->categories[name] = {};  // 建立空 category
-    saveToFile();
+    user->categories[key] = {};  // 建立空 category（刪掉時名字的 reference 跟著還回去）
+    persist(*user);
     return true;
 }
 
 // ⚠️ 不再自動建立 category
-bool HealthBackend::addOtherRecord(const std::string& token,
+bool HealthBackend::addOtherRecord(std::string_view   token,
                                    const std::string& categoryName,
                                    const std::string& datetime,
                                    double             value,
-                                   const std::string& note)
+                                   const std::string& note,
+                                   std::size_t*       index)
 {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     UserData* user = getUserByToken(token);
     if (!user) return false;
 
-    auto it = user->categories.find(categoryName);
+    auto it = findCategory(user->categories, categoryName);
     if (it == user->categories.end())
         return false;              // ❌ category 不存在 → 回傳 false
+    if (!util::PackedDateTime::storable(datetime)) return false;
 
     CategoryItem item;
     item.datetime = datetime;
@@ -584,64 +1594,174 @@ bool HealthBackend::addOtherRecord(const std::string& token,
     item.value    = value;
 
     it->second.push_back(item);
-    saveToFile();
+    if (index) {
+        const ColdSeries* cold = coldItems(*user, it->first);
+        *index = (cold ? cold->count : 0) + it->second.size() - 1;
+    }
+    persist(*user);
     return true;
 }
 
-std::vector<CategoryItem> HealthBackend::getOtherRecords(const std::string& token,
+bool HealthBackend::getOtherRecord(std::string_view   token,
+                                   const std::string& categoryName,
+                                   std::size_t       index,
+                                   CategoryItem&      out) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return false;
+    auto it = findCategory(user->categories, categoryName);
+    if (it == user->categories.end()) return false;
+    return recordAt(coldItems(*user, it->first), it->second, index, out);
+}
+
+std::vector<CategoryItem> HealthBackend::getOtherRecords(std::string_view   token,
                                                          const std::string& categoryName) const {
-    const UserData* user = getUserByToken(token);
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
+    if (!user) return {};
+    auto it = findCategory(user->categories, categoryName);
+    if (it == user->categories.end()) return {};
+    return allRecords(coldItems(*user, it->first), it->second);
+}
+
+std::vector<std::pair<std::size_t, CategoryItem>> HealthBackend::getOtherRecordsBetween(std::string_view   token,
+                                                                                        const std::string& categoryName,
+                                                                                        std::int64_t       fromMs,
+                                                                                        std::int64_t       toMs) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const UserData* user = getUserRecordsByToken(token, lock);
     if (!user) return {};
-    auto it = user->categories.find(categoryName);
+    auto it = findCategory(user->categories, categoryName);
     if (it == user->categories.end()) return {};
-    return it->second;
+    return recordsBetween(coldItems(*user, it->first), it->second, fromMs, toMs);
 }
 
-bool HealthBackend::updateOtherRecord(const std::string& token,
+bool HealthBackend::updateOtherRecord(std::string_view   token,
                                       const std::string& categoryName,
                                       std::size_t       index,
                                       const std::string& newDatetime,
                                       double             newValue,
                                       const std::string& newNote) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    auto it = user->categories.find(categoryName);
+    auto it = findCategory(user->categories, categoryName);
     if (it == user->categories.end()) return false;
     auto& vec = it->second;
-    if (index >= vec.size()) return false;
-
-    vec[index].datetime = newDatetime;
-    vec[index].note     = newNote;
-    vec[index].value    = newValue;
-    saveToFile();
+    if (!datetimeAccepted(coldItems(*user, it->first), vec, index, newDatetime)) return false;
+    const bool found = editRecord(coldItems(*user, it->first), vec, index, [&](CategoryItem& item) {
+        item.datetime = newDatetime;
+        item.note     = newNote;
+        item.value    = newValue;
+    });
+    if (!found) return false;
+    persist(*user);
     return true;
 }
 
-bool HealthBackend::deleteOtherRecord(const std::string& token,
+bool HealthBackend::deleteOtherRecord(std::string_view   token,
                                       const std::string& categoryName,
                                       std::size_t       index) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    auto it = user->categories.find(categoryName);
+    auto it = findCategory(user->categories, categoryName);
     if (it == user->categories.end()) return false;
 
     auto& vec = it->second;
-    if (index >= vec.size()) return false;
-
-    vec.erase(vec.begin() + static_cast<long>(index));
-    saveToFile();
+    if (!eraseRecord(coldItems(*user, it->first), vec, index)) return false;
+    persist(*user);
     return true;
 }
 
 // 刪掉整個 category，不管裡面有沒有 item
-bool HealthBackend::deleteCategory(const std::string& token,
+bool HealthBackend::deleteCategory(std::string_view   token,
                                    const std::string& categoryName) {
+    HB_TRACE_SPAN(Mutation);
+    std::unique_lock<std::shared_mutex> lock(mtx);
     UserData* user = getUserByToken(token);
     if (!user) return false;
-    auto it = user->categories.find(categoryName);
+    auto it = findCategory(user->categories, categoryName);
     if (it == user->categories.end()) return false;
 
+    user->cold.categories.erase(it->first);
     user->categories.erase(it);   // 直接整個刪掉這個 category
-    saveToFile();
+    persist(*user);
     return true;
-}
\ No newline at end of file
+}
+// ----------------------
+// Leaderboards
+// ----------------------
+
+bool HealthBackend::getLeaderboard(std::string_view token,
+                                   Board            board,
+                                   std::int64_t     atMs,
+                                   std::size_t      limit,
+                                   Ranking&         out) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    if (!getUserByToken(token)) return false;
+    // 還沒建：跟 getUserRecordsByToken 一樣暫時換成 unique lock
+    while (!leaderboardsBuilt) {
+        lock.unlock();
+        {
+            std::unique_lock<std::shared_mutex> writeLock(mtx);
+            if (!leaderboardsBuilt) {
+                buildLeaderboards();
+                enforceBudget(nullptr);
+            }
+        }
+        lock.lock();
+    }
+    const UserData* user = getUserByToken(token);
+    if (!user) return false;
+
+    const Leaderboard& lb = board == Board::ActivityMinutes ? activityBoard : waterBoard;
+    out.week   = Leaderboard::weekOf(atMs);
+    out.top    = lb.top(out.week, limit);
+    out.ranked = lb.size(out.week);
+    out.myRank = lb.rankOf(user->profile.name, out.week, out.myScore);
+    return true;
+}
+
+// ----------------------
+// Stats（給 /metrics）
+// ----------------------
+
+HealthBackend::Stats HealthBackend::getStats() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    Stats s;
+    s.users      = usersByName.size();
+    s.liveTokens = tokenToName.size();
+    for (const auto& [name, data] : usersByName) {
+        // records 不在記憶體裡的 user 用載入 / 趕出去時記下的數量
+        const RecordCounts c = data.resident ? data.recordCounts() : data.counts;
+        s.waters        += c.waters;
+        s.sleeps        += c.sleeps;
+        s.activities    += c.activities;
+        s.categories    += c.categories;
+        s.categoryItems += c.items;
+        if (!data.resident) continue;
+
+        ++s.residentUsers;
+        const auto& cold = data.cold;
+        s.coldRecords += cold.waters.count + cold.sleeps.count + cold.activities.count;
+        s.coldBytes   += ColdTier::bytes(cold.waters) + ColdTier::bytes(cold.sleeps) + ColdTier::bytes(cold.activities);
+        for (const auto& [catName, series] : cold.categories) {
+            s.coldRecords += series.count;
+            s.coldBytes   += ColdTier::bytes(series);
+        }
+    }
+    s.residentBytes = residentBytes;
+    s.memoryBudget  = memoryBudget;
+    s.recordHits    = recordHits.load(std::memory_order_relaxed);
+    s.recordMisses  = recordMisses.load(std::memory_order_relaxed);
+    s.evictions     = evictions.load(std::memory_order_relaxed);
+
+    struct stat st;
+    if (stat(storagePath.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        s.storageBytes = static_cast<long long>(st.st_size);
+    }
+    return s;
+}
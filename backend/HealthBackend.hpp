@@ -1,8 +1,29 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include <map>
+#include <shared_mutex>
+
+#include "../helpers/DateTime.hpp"
+#include "../helpers/FlatHashMap.hpp"
+#include "../helpers/RankedIndex.hpp"
+#include "../helpers/Symbol.hpp"
+#include "Leaderboard.hpp"
+
+class SnapshotFile;
+class SnapshotWriter;
+namespace util {
+class MappedFile;
+}
 
 // ----------------------
 // 基本資料結構
@@ -17,43 +38,228 @@ struct UserProfile {
     std::string gender;
 };
 
+// datetime 是 util::PackedDateTime（inline、不用 heap），WaterRecord / SleepRecord / ActivityRecord
+// 都是 trivially copyable，vector 變大、複製都是 memcpy
 struct WaterRecord {
-    std::string datetime;
-    double      amountMl = 0.0;
+    util::PackedDateTime datetime;
+    double               amountMl = 0.0;
 };
 
 struct SleepRecord {
-    std::string datetime;
-    double      hours = 0.0;
+    util::PackedDateTime datetime;
+    double               hours = 0.0;
 };
 
 struct ActivityRecord {
-    std::string datetime;
-    int         minutes = 0;
-    std::string intensity;
+    util::PackedDateTime datetime;
+    int                  minutes = 0;
+    util::SymbolRef      intensity; // "low" / "moderate" / "high" …，interned；reference 留在 UserData::intensities
 };
 
 struct CategoryItem {
-    std::string datetime;
-    std::string note;
-    double      value = 0.0;
+    util::PackedDateTime datetime;
+    std::string          note;
+    double               value = 0.0;
+};
+
+static_assert(std::is_trivially_copyable_v<WaterRecord> && std::is_trivially_copyable_v<SleepRecord> &&
+                  std::is_trivially_copyable_v<ActivityRecord>,
+              "records should stay trivially copyable");
+
+// 交到 HealthBackend lock 外面的 activities。ActivityRecord::intensity 不擁有字串，
+// symbols 替這個 user 不是 permanent 的 intensity 各留一個 reference：這個物件還在，intensity.str() 就有效。
+// 常見的 intensity 都是 permanent，symbols 通常是空的。T 是 vector 的時候可以直接當 vector 用
+template <typename T>
+struct Pinned {
+    T                         value;
+    std::vector<util::Symbol> symbols;
+
+    auto        begin() { return value.begin(); }
+    auto        end() { return value.end(); }
+    auto        begin() const { return value.begin(); }
+    auto        end() const { return value.end(); }
+    std::size_t size() const { return value.size(); }
+    bool        empty() const { return value.empty(); }
+    const auto& operator[](std::size_t i) const { return value[i]; }
 };
 
 class HealthBackend {
 public:
+    // 一個 user 各種 records 的數量；records 不在記憶體裡的時候 /metrics 用這個
+    struct RecordCounts {
+        std::uint32_t waters     = 0;
+        std::uint32_t sleeps     = 0;
+        std::uint32_t activities = 0;
+        std::uint32_t categories = 0;
+        std::uint32_t items      = 0; // 所有 category 的 item 加總
+    };
+
+    // LRU 用的最後使用時間。shared lock 底下的查詢也會更新，所以是 atomic；
+    // 包一層讓 UserData 還是可以複製 / 搬移
+    struct AccessStamp {
+        mutable std::atomic<std::uint64_t> value{0};
+
+        AccessStamp() = default;
+        AccessStamp(const AccessStamp& o) : value(o.value.load(std::memory_order_relaxed)) {}
+        AccessStamp& operator=(const AccessStamp& o) {
+            value.store(o.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
+    // 封存的舊 records（cold tier，見 backend/ColdTier.hpp）：唯讀的壓縮 block，要用才解
+    struct ColdBlock {
+        std::uint32_t count = 0;
+        std::int64_t  minMs = 0; // block 裡 datetime 的範圍（UTC epoch 毫秒），範圍查詢整塊跳過用
+        std::int64_t  maxMs = 0;
+        std::string   bytes;
+    };
+    struct ColdSeries {
+        std::vector<ColdBlock> blocks;
+        std::size_t            count = 0; // 所有 block 的 records 數
+    };
+    struct ColdHistory {
+        ColdSeries waters;
+        ColdSeries sleeps;
+        ColdSeries activities;
+        std::map<util::Symbol, ColdSeries> categories; // key 一定也在 UserData::categories 裡（解凍後可能是空的）
+
+        bool empty() const {
+            if (waters.count > 0 || sleeps.count > 0 || activities.count > 0) return false;
+            for (const auto& [name, series] : categories) {
+                if (series.count > 0) return false;
+            }
+            return true;
+        }
+    };
+
     struct UserData {
         UserProfile profile;
         std::string password;
 
+        // hot tier：最近的 records。比 Options::coldAfterDays 舊的會封存到 cold，
+        // 每個 series 的 index 是 cold 在前、hot 接在後面（cold.waters.count + hot 的位置）
         std::vector<WaterRecord>    waters;
         std::vector<SleepRecord>    sleeps;
         std::vector<ActivityRecord> activities;
 
-        // categoryName → items
-        std::map<std::string, std::vector<CategoryItem>> categories;
+        // categoryName（interned，刪掉 category 就還回去）→ items；順序是 symbol id，不是名字
+        std::map<util::Symbol, std::vector<CategoryItem>> categories;
+
+        // 不是 permanent 的 intensity → 幾筆 activity（hot + cold）用到它。ActivityRecord 只存 SymbolRef，
+        // reference 留在這裡：最後一筆改掉 / 刪掉就拿掉，字串跟著釋放
+        std::map<util::Symbol, std::uint32_t, std::less<>> intensities;
+
+        void holdIntensity(const util::Symbol& s) {
+            if (!s.permanent()) ++intensities[s];
+        }
+        void dropIntensity(util::SymbolRef r) {
+            if (r.permanent()) return;
+            auto it = intensities.find(r);
+            if (it != intensities.end() && --it->second == 0) intensities.erase(it);
+        }
+
+        ColdHistory cold;
+
+        // activities 照 minutes 由大到小的 index（位置是 activity 的 index，cold 也算在內）。
+        // 第一次照時間長短查詢時才建（byDurationBuilt），之後 add / update / delete 跟著改，被趕出去時丟掉
+        util::RankedIndex byDuration;
+        bool              byDurationBuilt = false;
+
+        // resident = false：上面四種 records 不在記憶體裡（binary snapshot 載入後還沒用到，
+        // 或是超過 memory budget 被趕出去），counts 是實際數量。
+        // 要用的時候從 snapshot / user 檔讀回來（見 HealthBackend::materialize）
+        bool         resident = true;
+        RecordCounts counts;
+
+        // 在目前這份 binary snapshot 裡是第幾個 user（沒有 snapshot / 還沒存進去 / 改過是 kNoIndex）
+        static constexpr std::uint32_t kNoIndex = UINT32_MAX;
+        std::uint32_t snapshotIndex = kNoIndex;
+        // 每次修改 +1（繞回去也沒關係，只比相不相等）。背景存檔寫完時拿來比：寫出去之後又改過的 user 還是 dirty
+        std::uint32_t version = 0;
+
+        // 上次寫 storage.json 時這個 user 在檔案裡的哪一段（jsonLength = 0：沒有 / 改過）。
+        // 沒改過的 user 下次存檔整段照抄，不用再轉一次（有 cold tier 的話就不用把 blocks 全部解開）
+        std::uint64_t jsonOffset = 0;
+        std::uint64_t jsonLength = 0;
+
+        // 改過、還沒存檔（見 HealthBackend::persist）；per-user 格式存檔時只重寫這些 user
+        bool dirty = false;
+
+        // 有設 memory budget 才會更新：records 估計佔多少 heap、最後一次被用到是什麼時候
+        std::size_t residentBytes = 0;
+        AccessStamp lastUsed;
+
+        // hot + cold
+        RecordCounts recordCounts() const {
+            RecordCounts c;
+            c.waters     = static_cast<std::uint32_t>(cold.waters.count + waters.size());
+            c.sleeps     = static_cast<std::uint32_t>(cold.sleeps.count + sleeps.size());
+            c.activities = static_cast<std::uint32_t>(cold.activities.count + activities.size());
+            c.categories = static_cast<std::uint32_t>(categories.size());
+            for (const auto& [name, items] : categories) c.items += static_cast<std::uint32_t>(items.size());
+            for (const auto& [name, series] : cold.categories) c.items += static_cast<std::uint32_t>(series.count);
+            return c;
+        }
+    };
+
+    // 存檔格式；載入時看檔案開頭自動判斷，這個設定只決定存成哪一種
+    enum class StorageFormat {
+        Json,    // data/storage.json
+        Binary,  // data/storage.snap（見 backend/Snapshot.hpp）
+        PerUser, // data/users/<bucket>/<name>.json，一個 user 一個檔（見 StorageLoader::userFilePath）
+    };
+
+    // GET /metrics 用的 backend 統計
+    struct Stats {
+        std::size_t users         = 0;
+        std::size_t liveTokens    = 0;
+        std::size_t waters        = 0;
+        std::size_t sleeps        = 0;
+        std::size_t activities    = 0;
+        std::size_t categories    = 0;
+        std::size_t categoryItems = 0;
+        long long   storageBytes  = -1; // storage.json 大小（不存在 / per-user 目錄是 -1）
+
+        // records 快取（見 Options::memoryBudget）
+        std::size_t   residentUsers = 0; // records 在記憶體裡的 user
+        std::size_t   residentBytes = 0; // 估計值；沒設 memory budget 時不計算，是 0
+        std::size_t   memoryBudget  = 0;
+        std::uint64_t recordHits    = 0; // 要讀 / 改 records 時已經在記憶體裡
+        std::uint64_t recordMisses  = 0; // 要從 snapshot / user 檔讀回來
+        std::uint64_t evictions     = 0;
+
+        // cold tier（見 Options::coldAfterDays）；records 不在記憶體裡的 user 不算
+        std::size_t coldRecords = 0;
+        std::size_t coldBytes   = 0;
+    };
+
+    // storagePath 空字串 → data/storage.json（format 是 Binary 時 data/storage.snap，PerUser 時 data/users）
+    // autoSave = false → 修改後不自動存檔（benchmark / 批次匯入用），要自己呼叫 saveToFile()
+    // flushIntervalMs = autoSave 時修改後最多等多久才寫檔：背景 thread 把這段時間改過的 user 一起寫
+    //           （一次 checkpoint，備份也是這時候才輪替）。0 = 有修改就寫，但還是在背景
+    // loadThreads = 0 → 載入時用所有 core 解析
+    // backups = 存檔時留幾份舊版本（<storagePath>.1 … .N，1 最新）；
+    //           載入時 storagePath 壞掉（parse 失敗 / checksum 不符）就退回最新一份好的。
+    //           PerUser 格式是每個 user 檔各自留備份、各自退回
+    // memoryBudget = records 最多佔多少 bytes（估計值），0 = 不限制。超過就把最久沒用到、
+    //           已經存檔的 user 的 records 丟掉，下次用到再從磁碟讀回來。
+    //           只有 Binary / PerUser 格式讀得回單一 user，JSON 格式會忽略這個設定
+    // coldAfterDays = datetime 比現在早這麼多天的 records 封存成壓縮的 cold block，0 = 不封存。
+    //           只影響記憶體裡的樣子，存檔格式不變
+    struct Options {
+        std::string   storagePath;
+        bool          autoSave     = true;
+        unsigned      loadThreads  = 0;
+        StorageFormat format       = StorageFormat::Json;
+        unsigned      backups      = 2;
+        std::size_t   memoryBudget = 0;
+        unsigned      coldAfterDays = 0;
+        unsigned      flushIntervalMs = 1000;
     };
 
     HealthBackend();
+    explicit HealthBackend(const Options& opts);
     ~HealthBackend();
 
     // -------- User / Auth --------
@@ -66,95 +272,280 @@ public:
     std::string login(const std::string& name,
                       const std::string& password);
 
-    bool   getUserProfile(const std::string& token,
+    bool   getUserProfile(std::string_view   token,
                           UserProfile&       outProfile) const;
-    double getBMI(const std::string& token) const;
+    double getBMI(std::string_view token) const;
+
+    bool   hasUserForToken(std::string_view token) const;
+
+    Stats  getStats() const;
+
+    // JSON I/O（建構時會自動 load；autoSave 時修改過的 user 由背景 thread 寫檔，見 Options::flushIntervalMs）
+    // saveToFile 整份重寫（per-user 格式只重寫改過的 user 檔，其他的已經是最新的）；server 關掉前用它存最後一次
+    void loadFromFile();
+    void saveToFile() const;
+    // 背景存檔現在就做一次（只寫改過的 user），寫完才回傳
+    void flush() const;
+    const std::string& getStoragePath() const { return storagePath; }
 
-    bool   hasUserForToken(const std::string& token) const;
+    // 另存到別的路徑 / 格式（不影響 storagePath 與之後的自動存檔），轉檔工具用
+    bool exportTo(const std::string& path, StorageFormat format) const;
+
+    // add*：index 不是 nullptr 的話填入新 record 的 index
+    // get*(token, index, out)：只拿一筆（封存的 records 只解那一個 block）
 
     // -------- Water --------
-    bool addWater(const std::string& token,
+    bool addWater(std::string_view   token,
                   const std::string& datetime,
-                  double             amountMl);
-    std::vector<WaterRecord> getAllWater(const std::string& token) const;
-    bool updateWater(const std::string& token,
+                  double             amountMl,
+                  std::size_t*       index = nullptr);
+    bool getWater(std::string_view token, std::size_t index, WaterRecord& out) const;
+    std::vector<WaterRecord> getAllWater(std::string_view token) const;
+    // datetime 在 [fromMs, toMs) 的 records（UTC epoch 毫秒，見 util::parseDateTime）和它們的 index；
+    // datetime 認不得的 record 不會出現。封存的 records 只解時間範圍有重疊的 block
+    std::vector<std::pair<std::size_t, WaterRecord>> getWaterBetween(std::string_view   token,
+                                                                     std::int64_t       fromMs,
+                                                                     std::int64_t       toMs) const;
+    bool updateWater(std::string_view   token,
                      std::size_t       index,
                      const std::string& newDatetime,
                      double             newAmountMl);
-    bool deleteWater(const std::string& token,
+    bool deleteWater(std::string_view   token,
                      std::size_t       index);
 
     // -------- Sleep --------
-    bool addSleep(const std::string& token,
+    bool addSleep(std::string_view   token,
                   const std::string& datetime,
-                  double             hours);
-    std::vector<SleepRecord> getAllSleep(const std::string& token) const;
-    bool updateSleep(const std::string& token,
+                  double             hours,
+                  std::size_t*       index = nullptr);
+    bool getSleep(std::string_view token, std::size_t index, SleepRecord& out) const;
+    std::vector<SleepRecord> getAllSleep(std::string_view token) const;
+    std::vector<std::pair<std::size_t, SleepRecord>> getSleepBetween(std::string_view   token,
+                                                                     std::int64_t       fromMs,
+                                                                     std::int64_t       toMs) const;
+    bool updateSleep(std::string_view   token,
                      std::size_t       index,
                      const std::string& newDatetime,
                      double             newHours);
-    bool deleteSleep(const std::string& token,
+    bool deleteSleep(std::string_view   token,
                      std::size_t       index);
 
     // -------- Activity --------
-    bool addActivity(const std::string& token,
+    bool addActivity(std::string_view   token,
                      const std::string& datetime,
                      int                minutes,
-                     const std::string& intensity);
-    std::vector<ActivityRecord> getAllActivity(const std::string& token) const;
-    bool updateActivity(const std::string& token,
+                     const std::string& intensity,
+                     std::size_t*       index = nullptr);
+    // 回傳的 records 放在 Pinned 裡：lock 外面 intensity.str() 要用到它留的 reference
+    bool getActivity(std::string_view token, std::size_t index, Pinned<ActivityRecord>& out) const;
+    Pinned<std::vector<ActivityRecord>> getAllActivity(std::string_view token) const;
+    Pinned<std::vector<std::pair<std::size_t, ActivityRecord>>> getActivityBetween(std::string_view   token,
+                                                                                   std::int64_t       fromMs,
+                                                                                   std::int64_t       toMs) const;
+    // minutes 最長的前 limit 筆和它們的 index（由大到小，一樣長的照 index）；
+    // 這個 user 第一次查的時候建 index，之後是 O(limit)
+    Pinned<std::vector<std::pair<std::size_t, ActivityRecord>>> getActivitiesByDuration(std::string_view token,
+                                                                                        std::size_t      limit) const;
+    bool updateActivity(std::string_view   token,
                         std::size_t       index,
                         const std::string& newDatetime,
                         int                newMinutes,
                         const std::string& newIntensity);
-    bool deleteActivity(const std::string& token,
+    bool deleteActivity(std::string_view   token,
                         std::size_t       index);
 
     // -------- Custom Categories --------
-    std::vector<std::string> getOtherCategories(const std::string& token) const;
+    std::vector<std::string> getOtherCategories(std::string_view token) const;
 
-    bool createCategory(const std::string& token,
+    bool createCategory(std::string_view   token,
                         const std::string& name);
 
-    bool addOtherRecord(const std::string& token,
+    bool addOtherRecord(std::string_view   token,
                         const std::string& categoryName,
                         const std::string& datetime,
                         double             value,
-                        const std::string& note);
+                        const std::string& note,
+                        std::size_t*       index = nullptr);
+    bool getOtherRecord(std::string_view   token,
+                        const std::string& categoryName,
+                        std::size_t       index,
+                        CategoryItem&      out) const;
 
-    std::vector<CategoryItem> getOtherRecords(const std::string& token,
+    std::vector<CategoryItem> getOtherRecords(std::string_view   token,
                                               const std::string& categoryName) const;
+    std::vector<std::pair<std::size_t, CategoryItem>> getOtherRecordsBetween(std::string_view   token,
+                                                                             const std::string& categoryName,
+                                                                             std::int64_t       fromMs,
+                                                                             std::int64_t       toMs) const;
 
-    bool updateOtherRecord(const std::string& token,
+    bool updateOtherRecord(std::string_view   token,
                            const std::string& categoryName,
                            std::size_t       index,
                            const std::string& newDatetime,
                            double             newValue,
                            const std::string& newNote);
 
-    bool deleteOtherRecord(const std::string& token,
+    bool deleteOtherRecord(std::string_view   token,
                            const std::string& categoryName,
                            std::size_t       index);
 
-    bool deleteCategory(const std::string& token,
+    bool deleteCategory(std::string_view   token,
                         const std::string& categoryName);
 
+    // -------- Leaderboards --------
+    // 跨 user 的每週排行榜（見 backend/Leaderboard.hpp）；datetime 不是 ISO 8601 的 records 不算
+    enum class Board {
+        ActivityMinutes, // 這週 activity minutes 加總
+        WaterDays,       // 這週有記錄喝水的天數
+    };
+    struct Ranking {
+        std::int32_t                    week    = 0; // 那一週週一的 epoch 天數（UTC）
+        std::vector<Leaderboard::Entry> top;         // 前 limit 名
+        std::size_t                     ranked  = 0; // 這週榜上有幾個 user
+        std::size_t                     myRank  = 0; // token 的 user 是第幾名（1 起算），0 = 不在榜上
+        std::int64_t                    myScore = 0;
+    };
+    // atMs（UTC epoch 毫秒）所在那一週。第一次查詢時掃過所有 user 建排行榜，
+    // 之後 water / activity 的新增、修改、刪除跟著更新，查詢是 O(log n + limit)。false = token 不對
+    bool getLeaderboard(std::string_view token,
+                        Board            board,
+                        std::int64_t     atMs,
+                        std::size_t      limit,
+                        Ranking&         out) const;
+
 private:
-    std::map<std::string, UserData>    usersByName;
-    std::map<std::string, std::string> tokenToName;
+    util::FlatHashMap<UserData>    usersByName; // 走訪順序 = 插入順序（存檔也照這個順序）
+    util::FlatHashMap<std::string> tokenToName;
+
+    std::string   storagePath;
+    bool          autoSave      = true;
+    unsigned      loadThreads   = 0;
+    StorageFormat storageFormat = StorageFormat::Json;
+    unsigned      backups       = 2;
+    std::size_t   memoryBudget  = 0;
+    std::int64_t  coldAfterMs   = 0; // 0 = 不封存
+    unsigned      flushIntervalMs = 1000;
+
+    // records 快取的統計；residentBytes 只在 memoryBudget > 0 時維護（都在 unique lock 下改）
+    mutable std::size_t                residentBytes = 0;
+    mutable std::size_t                enforceAbove  = 0; // 趕不動的時候，長到這麼大才再掃一次
+    mutable std::atomic<std::uint64_t> accessClock{0};
+    mutable std::atomic<std::uint64_t> recordHits{0};
+    mutable std::atomic<std::uint64_t> recordMisses{0};
+    mutable std::atomic<std::uint64_t> evictions{0};
 
-    std::string storagePath;
+    // 排行榜：第一次查詢時才建（leaderboardsBuilt），之後在 unique lock 底下跟著 records 修改；
+    // 重新載入檔案時丟掉重建
+    mutable Leaderboard activityBoard{Leaderboard::Score::Total};
+    mutable Leaderboard waterBoard{Leaderboard::Score::Days};
+    mutable bool        leaderboardsBuilt = false;
+
+    // 改過還沒存的 user（name）；跟 UserData::dirty 同步，dirty 的 user 只會出現一次
+    mutable std::vector<std::string> dirtyUsers;
+
+    // 上次寫的 storage.json 多大；檔案大小對不上（被別人換掉了）就不照抄 UserData::jsonOffset 那段
+    mutable std::uint64_t jsonWrittenSize = 0;
+
+    // 背景存檔（autoSave）：persist() 只記 dirty、叫醒 flusher，flusher 等 flushIntervalMs 把這段時間的修改一起寫。
+    // 要寫的內容在 shared lock 底下準備好，寫檔 / fsync 時不拿 mtx，最後短暫拿 unique lock 清 dirty（見 checkpoint）
+    mutable std::mutex              flushMtx; // 保護 flushPending / flushStop
+    mutable std::condition_variable flushCv;
+    mutable bool                    flushPending = false;
+    bool                            flushStop    = false;
+    std::thread                     flusher;
+    // 同一時間只有一個存檔 / 載入在動 storagePath（背景存檔、saveToFile、exportTo、loadFromFile）；要比 mtx 先拿
+    mutable std::mutex checkpointMtx;
+
+    // 最近載入 / 存檔的 snapshot；還有 records 不在記憶體裡的 user 時要一直 map 著。
+    // 存檔後會換成新檔（const 的 writeStorage 也會動到，所以是 mutable）
+    mutable std::shared_ptr<const SnapshotFile> snapshot;
+    // 查詢拿 shared lock，修改（含 login 發 token、存檔）拿 unique lock
+    mutable std::shared_mutex mtx;
 
     // 檔案 / 路徑相關
     void initStoragePath();             // 設定 storagePath
     void ensureStorageDirExists() const; // 確保資料夾存在
 
-    // JSON I/O
-    void loadFromFile();
-    void saveToFile() const;
+    enum class LoadStatus { Loaded, Missing, Failed };
+
+    // 以下都假設呼叫端已經拿到 mtx
+    void       readStorage();                        // storagePath，壞掉就退回備份
+    LoadStatus readStorageFrom(const std::string& path);
+    LoadStatus readSnapshot(const std::string& path);
+    LoadStatus readUserDir(const std::string& dir);
+    void       quarantine(const std::string& path) const; // 壞檔改名成 .corrupt 留著，不讓之後的存檔把它輪進備份
+    // force = false：沒有 dirty 的 user 就不寫，per-user 格式只寫 dirty 的 user
+    void writeStorage(bool force) const;
+    bool writeStorageTo(const std::string& path, StorageFormat format) const;
+    bool writeJson(const std::string& path) const;
+    bool writeSnapshot(const std::string& path) const;
+    bool writeUserDir(const std::string& dir, bool dirtyOnly) const;
+    bool writeUserFile(const std::string& path, const UserData& user, unsigned keep, bool sync) const;
+    void markDirty(const UserData& user) const;
+    void clearDirty() const;
+
+    // 存檔寫出去的一個 user：寫的時候是哪個 version，Json 格式還有在檔案裡的哪一段 [begin, end)
+    struct WrittenUser {
+        std::string   name;
+        std::uint32_t version = 0;
+        std::uint64_t begin   = 0;
+        std::uint64_t end     = 0;
+        bool          ok      = true;
+    };
+    // storage.json 的內容；previous = 上次寫的檔案（沒改過的 user 從這裡照抄），可以是 nullptr。
+    // materialize = false（只拿 shared lock）時遇到要讀回 records 才寫得出來的 user 就回傳 false
+    bool buildJson(const util::MappedFile* previous, bool materialize, std::string& doc,
+                   std::vector<WrittenUser>& users) const;
+    bool openPreviousJson(util::MappedFile& previous) const;
+
+    // 背景存檔：準備（shared lock）→ 寫檔（不拿 mtx）→ 收尾（unique lock）
+    struct Checkpoint;
+    // 每次存檔重複使用（checkpointMtx 保護），vector 的 capacity 留著下次用
+    mutable std::unique_ptr<Checkpoint> scratch;
+    void flushLoop();
+    void requestFlush() const;
+    void checkpoint() const;
+    bool prepareCheckpoint(Checkpoint& cp) const; // false = 有 user 要先讀回 records，改走 writeStorage
+    bool writeCheckpoint(Checkpoint& cp) const;
+    void finishCheckpoint(const Checkpoint& cp) const;
+
+    // records 不在記憶體裡的 user 從 snapshot / user 檔讀回來；要拿 unique lock。
+    // records 只是磁碟內容的快取，所以 const 的查詢 / 存檔也可以呼叫。false = 讀不回來
+    bool materialize(const UserData& user) const;
+    void materializeAll() const;
+    // 暫時讀回來給 fn 用，用完本來不在記憶體裡的再丟掉（整份匯出不會把 budget 撐爆）
+    template <typename Fn>
+    bool withRecords(const UserData& user, Fn&& fn) const;
+
+    // Memory budget（memoryBudget = 0 時都不做事）
+    void touch(const UserData& user) const;   // 記 hit / miss，更新 LRU 時間
+    void account(const UserData& user) const; // records 改過 / 讀回來之後重新估計大小
+    bool canEvict(const UserData& user) const;
+    void evict(const UserData& user) const;
+    void enforceBudget(const UserData* keep) const; // 超過 budget 就從最久沒用的開始趕，keep 不動
+
+    // hot tier 開頭夠舊的 records 封存進 cold（coldAfterMs = 0 時不做事）；只是換個存法，不算修改
+    void seal(const UserData& user) const;
+
+    // UserData::byDuration 整個重建（要拿著 unique lock）
+    void indexDurations(const UserData& user) const;
+    // 所有 user 的 waters / activities 掃一遍建排行榜（要拿著 unique lock）
+    void buildLeaderboards() const;
+
+    // 每個修改最後都呼叫：記下哪個 user 改了，autoSave 時叫背景 thread 之後寫檔（不在這裡寫）
+    void persist(const UserData& user) const {
+        seal(user);
+        markDirty(user);
+        account(user);
+        if (autoSave) requestFlush();
+        enforceBudget(&user);
+    }
 
     // Token / 使用者
     std::string generateToken() const;
-    UserData*       getUserByToken(const std::string& token);
-    const UserData* getUserByToken(const std::string& token) const;
+    UserData*       getUserByToken(std::string_view token);  // 會順便 materialize；讀不回來是 nullptr
+    const UserData* getUserByToken(std::string_view token) const;
+    // 要讀 records 的查詢用：records 不在記憶體裡的話暫時換成 unique lock 讀回來，再換回 shared lock
+    const UserData* getUserRecordsByToken(std::string_view   token,
+                                          std::shared_lock<std::shared_mutex>& lock) const;
 };
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "Leaderboard.hpp"
+
+namespace {
+
+constexpr std::int64_t kDayMs = 86400000;
+
+// 往負無限大取整（1970 年以前的日期也是同一週）
+std::int64_t floorDiv(std::int64_t a, std::int64_t b) { return a / b - ((a % b != 0 && (a < 0) != (b < 0)) ? 1 : 0); }
+
+// 週一 = 0 … 週日 = 6；1970-01-01 是週四
+int weekday(std::int64_t day) { return static_cast<int>(((day + 3) % 7 + 7) % 7); }
+
+} // namespace
+
+std::int32_t Leaderboard::weekOf(std::int64_t ms) {
+    const std::int64_t day = floorDiv(ms, kDayMs);
+    return static_cast<std::int32_t>(day - weekday(day));
+}
+
+void Leaderboard::add(std::string_view user, std::int64_t ms, std::int64_t amount) { change(user, ms, amount, +1); }
+
+void Leaderboard::remove(std::string_view user, std::int64_t ms, std::int64_t amount) { change(user, ms, amount, -1); }
+
+void Leaderboard::change(std::string_view user, std::int64_t ms, std::int64_t amount, int sign) {
+    std::uint32_t id;
+    if (auto it = ids_.find(user); it != ids_.end()) {
+        id = it->second;
+    } else {
+        if (sign < 0) return; // 沒加過的 user 沒有東西可以減
+        id = static_cast<std::uint32_t>(names_.size());
+        names_.emplace_back(user);
+        ids_.try_emplace(std::string(user), id);
+    }
+
+    const std::int64_t day     = floorDiv(ms, kDayMs);
+    const std::int32_t weekKey = static_cast<std::int32_t>(day - weekday(day));
+    auto               weekIt  = weeks_.find(weekKey);
+    if (weekIt == weeks_.end()) {
+        if (sign < 0) return;
+        weekIt = weeks_.emplace(weekKey, Week(Before{&names_})).first;
+    }
+    Week& week   = weekIt->second;
+    auto  slotIt = week.slots.find(id);
+    if (slotIt == week.slots.end()) {
+        if (sign < 0) return;
+        slotIt = week.slots.emplace(id, Slot{}).first;
+    }
+    Slot&          slot  = slotIt->second;
+    std::uint32_t& count = slot.days[weekday(day)];
+    if (sign < 0 && count == 0) return;
+
+    const std::int64_t before = slot.score;
+    if (sign > 0) {
+        ++count;
+    } else {
+        --count;
+    }
+    if (score_ == Score::Total) {
+        slot.score += sign * amount;
+    } else if (count == (sign > 0 ? 1u : 0u)) {
+        slot.score += sign; // 那天從沒有變成有 / 從有變成沒有
+    }
+
+    if (before != slot.score) {
+        week.ranking.erase(Key{before, id});
+        if (slot.score != 0) week.ranking.insert(Key{slot.score, id});
+    }
+
+    bool empty = true;
+    for (std::uint32_t c : slot.days) empty = empty && c == 0;
+    if (!empty) return;
+    // 這週沒有 records 了（分數照理已經是 0；amount 對不上的話也一起拿掉）
+    if (slot.score != 0) week.ranking.erase(Key{slot.score, id});
+    week.slots.erase(slotIt);
+    if (week.slots.empty()) weeks_.erase(weekIt);
+}
+
+std::vector<Leaderboard::Entry> Leaderboard::top(std::int32_t week, std::size_t k) const {
+    std::vector<Entry> out;
+    auto               it = weeks_.find(week);
+    if (it == weeks_.end()) return out;
+    const auto keys = it->second.ranking.first(k);
+    out.reserve(keys.size());
+    for (const Key& key : keys) out.push_back(Entry{names_[key.user], key.score});
+    return out;
+}
+
+std::size_t Leaderboard::rankOf(std::string_view user, std::int32_t week, std::int64_t& score) const {
+    score       = 0;
+    auto idIt   = ids_.find(user);
+    auto weekIt = weeks_.find(week);
+    if (idIt == ids_.end() || weekIt == weeks_.end()) return 0;
+    auto slotIt = weekIt->second.slots.find(idIt->second);
+    if (slotIt == weekIt->second.slots.end() || slotIt->second.score == 0) return 0;
+    score = slotIt->second.score;
+    return weekIt->second.ranking.rank(Key{score, idIt->second}) + 1;
+}
+
+std::size_t Leaderboard::size(std::int32_t week) const {
+    auto it = weeks_.find(week);
+    return it == weeks_.end() ? 0 : it->second.ranking.size();
+}
+
+void Leaderboard::clear() {
+    weeks_.clear();
+    ids_.clear();
+    names_.clear();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../helpers/FlatHashMap.hpp"
+#include "../helpers/RankTree.hpp"
+
+// 跨 user 的每週排行榜。週是 ISO week（週一 00:00 UTC 開始），用那個週一的 epoch 天數當 key。
+//
+// 每一週一棵 util::RankTree（分數由高到低、一樣高照名字），records 新增 / 刪除時只動那個 user 在那一週的
+// 一個 key：O(log n)，不用每次把所有 user 的 records 掃一遍重算。前 k 名 O(log n + k)，某個 user 的名次 O(log n)。
+//
+// 每個 (user, week) 記著一週七天各有幾筆 records，刪掉一筆時才知道那天還有沒有別的；
+// 這週完全沒有 records 的 user 不在榜上。
+class Leaderboard {
+public:
+    enum class Score {
+        Total, // 這週 records 的 amount 加總（activity minutes）
+        Days,  // 這週有記錄的天數，0–7（喝水規不規律）
+    };
+
+    struct Entry {
+        std::string  name;
+        std::int64_t score = 0;
+    };
+
+    explicit Leaderboard(Score score) : score_(score) {}
+
+    // 比較函式指著 names_，不能複製 / 搬移
+    Leaderboard(const Leaderboard&)            = delete;
+    Leaderboard& operator=(const Leaderboard&) = delete;
+
+    // ms（UTC epoch 毫秒）那一週的週一是 epoch 第幾天
+    static std::int32_t weekOf(std::int64_t ms);
+
+    // user 多了 / 少了一筆 datetime 是 ms 的 record；amount 是 Score::Total 要加減的量（Days 不用）
+    void add(std::string_view user, std::int64_t ms, std::int64_t amount);
+    void remove(std::string_view user, std::int64_t ms, std::int64_t amount);
+
+    // week 的前 k 名，名次由高到低
+    std::vector<Entry> top(std::int32_t week, std::size_t k) const;
+    // user 在 week 的名次（1 起算）和分數；0 = 這週不在榜上
+    std::size_t rankOf(std::string_view user, std::int32_t week, std::int64_t& score) const;
+    // week 榜上有幾個 user
+    std::size_t size(std::int32_t week) const;
+
+    void clear();
+
+private:
+    struct Key {
+        std::int64_t  score;
+        std::uint32_t user; // names_ 的 index
+    };
+    struct Before {
+        const std::vector<std::string>* names;
+        bool operator()(const Key& a, const Key& b) const {
+            return a.score != b.score ? a.score > b.score : (*names)[a.user] < (*names)[b.user];
+        }
+    };
+    struct Slot {
+        std::int64_t  score   = 0;
+        std::uint32_t days[7] = {}; // 週一 … 週日各有幾筆
+    };
+    struct Week {
+        explicit Week(Before before) : ranking(before) {}
+
+        std::unordered_map<std::uint32_t, Slot> slots; // user → 這週的分數
+        util::RankTree<Key, Before>             ranking;
+    };
+
+    void change(std::string_view user, std::int64_t ms, std::int64_t amount, int sign);
+
+    Score                            score_;
+    util::FlatHashMap<std::uint32_t> ids_;   // user name → names_ 的 index
+    std::vector<std::string>         names_; // 出現過的 user，清掉之前不會少
+    std::map<std::int32_t, Week>     weeks_;
+};
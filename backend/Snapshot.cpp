@@ -0,0 +1,512 @@
+#include "Snapshot.hpp"
+#include "ColdTier.hpp"
+#include "../helpers/Checksum.hpp"
+
+#include <fcntl.h>  // open
+#include <unistd.h> // read, close
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// ----------------------
+// 檔案裡的結構（大小固定、都是 8 的倍數，陣列接起來也會對齊）
+// ----------------------
+
+constexpr char kMagic[8] = {'H', 'B', 'S', 'N', 'A', 'P', '\r', '\n'};
+constexpr char kTrailerMagic[8] = {'H', 'B', 'S', 'U', 'M', '6', '4', '\n'};
+
+// Header::flags
+constexpr std::uint64_t kFlagChecksum = 1; // 檔尾有 Trailer（舊檔沒有，照樣可以讀，只是不驗）
+
+struct StrRef {
+    std::uint32_t off;
+    std::uint32_t len;
+};
+
+struct Header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t headerBytes;
+    std::uint64_t userCount;
+    std::uint64_t dirOffset;
+    std::uint64_t dirStringsOffset;
+    std::uint64_t dirStringsBytes;
+    std::uint64_t fileBytes;
+    std::uint64_t flags;
+};
+
+// 最後 16 bytes：checksum = XXH64(header, seed = XXH64(header 之後到 trailer 之前的所有 bytes))
+struct Trailer {
+    char          magic[8];
+    std::uint64_t checksum;
+};
+
+struct DirEntry {
+    std::uint64_t blockOffset;
+    std::uint64_t blockBytes;
+    StrRef        name;
+    StrRef        id;
+    StrRef        gender;
+    StrRef        password;
+    double        weightKg;
+    double        heightM;
+    std::int32_t  age;
+    std::uint32_t waters;
+    std::uint32_t sleeps;
+    std::uint32_t activities;
+    std::uint32_t categories;
+    std::uint32_t items;
+};
+
+struct WaterRec {
+    StrRef datetime;
+    double amountMl;
+};
+
+struct SleepRec {
+    StrRef datetime;
+    double hours;
+};
+
+struct ActivityRec {
+    StrRef        datetime;
+    StrRef        intensity;
+    std::int32_t  minutes;
+    std::uint32_t reserved;
+};
+
+struct CategoryRec {
+    StrRef        name;
+    std::uint32_t items; // 這個 category 的 item 數，item 依 category 順序接在 ItemRec[] 裡
+    std::uint32_t reserved;
+};
+
+struct ItemRec {
+    StrRef datetime;
+    StrRef note;
+    double value;
+};
+
+static_assert(sizeof(Header) == 64 && sizeof(Trailer) == 16, "snapshot header layout");
+static_assert(sizeof(DirEntry) == 88, "snapshot directory layout");
+static_assert(sizeof(WaterRec) == 16 && sizeof(SleepRec) == 16 && sizeof(ActivityRec) == 24 &&
+                  sizeof(CategoryRec) == 16 && sizeof(ItemRec) == 24,
+              "snapshot record layout");
+
+bool hostIsLittleEndian() {
+    const std::uint16_t probe = 1;
+    unsigned char       first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+// mmap 的位址不保證符合結構對齊（block 內是 8-byte 對齊，但還是用 memcpy 最保險，編譯器會變成單純的 load）
+template <class T>
+T load(const char* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <class T>
+void append(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+std::uint64_t recordBytes(const DirEntry& e) {
+    return std::uint64_t{e.waters} * sizeof(WaterRec) + std::uint64_t{e.sleeps} * sizeof(SleepRec) +
+           std::uint64_t{e.activities} * sizeof(ActivityRec) + std::uint64_t{e.categories} * sizeof(CategoryRec) +
+           std::uint64_t{e.items} * sizeof(ItemRec);
+}
+
+bool refInside(const StrRef& r, std::uint64_t areaBytes) {
+    return std::uint64_t{r.off} + r.len <= areaBytes;
+}
+
+void padTo8(std::string& s) {
+    s.append((8 - s.size() % 8) % 8, '\0');
+}
+
+// 一段一段算，算完的頁面馬上還給 kernel：驗整個檔案不會讓 RSS 漲到檔案大小
+bool checksumMatches(const util::MappedFile& file, std::uint64_t bodyEnd, std::uint64_t expected) {
+    constexpr std::size_t kChunk = std::size_t{4} << 20;
+    util::Xxh64           body;
+    for (std::size_t off = sizeof(Header); off < bodyEnd;) {
+        const std::size_t n = std::min<std::size_t>(kChunk, static_cast<std::size_t>(bodyEnd) - off);
+        body.update(file.data() + off, n);
+        file.release(off, n);
+        off += n;
+    }
+    return util::Xxh64::hash(file.data(), sizeof(Header), body.digest()) == expected;
+}
+
+} // namespace
+
+// ----------------------
+// SnapshotFile
+// ----------------------
+
+SnapshotFile::~SnapshotFile() = default;
+
+bool SnapshotFile::isSnapshot(const std::string& path) {
+    // 每次載入都會先問一次，用 raw fd 免得 ifstream 配 buffer
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    char          magic[sizeof(kMagic)] = {0};
+    const ssize_t n = ::read(fd, magic, sizeof(magic));
+    ::close(fd);
+    return n == static_cast<ssize_t>(sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+std::shared_ptr<const SnapshotFile> SnapshotFile::open(const std::string& path, std::string& error) {
+    if (!hostIsLittleEndian()) {
+        error = "snapshot format is little-endian only";
+        return nullptr;
+    }
+
+    std::shared_ptr<SnapshotFile> snap(new SnapshotFile());
+    if (!snap->file_.open(path)) {
+        error = std::string("cannot open: ") + std::strerror(errno);
+        return nullptr;
+    }
+    const char*       data = snap->file_.data();
+    const std::size_t size = snap->file_.size();
+
+    if (size < sizeof(Header)) {
+        error = "file too small for header";
+        return nullptr;
+    }
+    const auto h = load<Header>(data);
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+        error = "bad magic";
+        return nullptr;
+    }
+    if (h.version != kVersion) {
+        error = "unsupported snapshot version " + std::to_string(h.version) + " (expected " +
+                std::to_string(kVersion) + ")";
+        return nullptr;
+    }
+    if (h.headerBytes != sizeof(Header) || h.fileBytes != size) {
+        error = "size mismatch (truncated or corrupted file)";
+        return nullptr;
+    }
+    std::uint64_t bodyEnd = size;
+    if (h.flags & kFlagChecksum) {
+        if (size < sizeof(Header) + sizeof(Trailer)) {
+            error = "file too small for trailer";
+            return nullptr;
+        }
+        bodyEnd      = size - sizeof(Trailer);
+        const auto t = load<Trailer>(data + bodyEnd);
+        if (std::memcmp(t.magic, kTrailerMagic, sizeof(kTrailerMagic)) != 0) {
+            error = "bad trailer";
+            return nullptr;
+        }
+        if (!checksumMatches(snap->file_, bodyEnd, t.checksum)) {
+            error = "checksum mismatch";
+            return nullptr;
+        }
+        snap->verified_ = true;
+    }
+    if (h.dirOffset < sizeof(Header) || h.dirOffset > bodyEnd ||
+        h.userCount > (bodyEnd - h.dirOffset) / sizeof(DirEntry) ||
+        h.dirStringsOffset < h.dirOffset + h.userCount * sizeof(DirEntry) ||
+        h.dirStringsOffset > bodyEnd || h.dirStringsBytes > bodyEnd - h.dirStringsOffset) {
+        error = "directory out of bounds";
+        return nullptr;
+    }
+
+    snap->userCount_        = static_cast<std::size_t>(h.userCount);
+    snap->dirOffset_        = h.dirOffset;
+    snap->dirStringsOffset_ = h.dirStringsOffset;
+    snap->dirStringsBytes_  = h.dirStringsBytes;
+
+    // directory 整個檢查一遍（只碰 directory，不碰 user block）
+    for (std::size_t i = 0; i < snap->userCount_; ++i) {
+        const auto e = load<DirEntry>(data + h.dirOffset + i * sizeof(DirEntry));
+        const bool ok = e.blockOffset >= sizeof(Header) && e.blockOffset <= h.dirOffset &&
+                        e.blockBytes <= h.dirOffset - e.blockOffset && recordBytes(e) <= e.blockBytes &&
+                        refInside(e.name, h.dirStringsBytes) && refInside(e.id, h.dirStringsBytes) &&
+                        refInside(e.gender, h.dirStringsBytes) && refInside(e.password, h.dirStringsBytes);
+        if (!ok) {
+            error = "corrupted directory entry #" + std::to_string(i);
+            return nullptr;
+        }
+    }
+    return snap;
+}
+
+std::string SnapshotFile::dirString(std::uint32_t off, std::uint32_t len) const {
+    return std::string(file_.data() + dirStringsOffset_ + off, len);
+}
+
+void SnapshotFile::readProfile(std::size_t index, HealthBackend::UserData& out) const {
+    const auto e = load<DirEntry>(file_.data() + dirOffset_ + index * sizeof(DirEntry));
+    out.profile.name     = dirString(e.name.off, e.name.len);
+    out.profile.id       = dirString(e.id.off, e.id.len);
+    out.profile.gender   = dirString(e.gender.off, e.gender.len);
+    out.profile.age      = e.age;
+    out.profile.weightKg = e.weightKg;
+    out.profile.heightM  = e.heightM;
+    out.password         = dirString(e.password.off, e.password.len);
+}
+
+SnapshotFile::Counts SnapshotFile::counts(std::size_t index) const {
+    const auto e = load<DirEntry>(file_.data() + dirOffset_ + index * sizeof(DirEntry));
+    return Counts{e.waters, e.sleeps, e.activities, e.categories, e.items};
+}
+
+std::string_view SnapshotFile::block(std::size_t index) const {
+    const auto e = load<DirEntry>(file_.data() + dirOffset_ + index * sizeof(DirEntry));
+    return std::string_view(file_.data() + e.blockOffset, static_cast<std::size_t>(e.blockBytes));
+}
+
+bool SnapshotFile::readRecords(std::size_t index, HealthBackend::UserData& out) const {
+    const auto  e     = load<DirEntry>(file_.data() + dirOffset_ + index * sizeof(DirEntry));
+    const char* p     = file_.data() + e.blockOffset;
+    const char* pool  = p + recordBytes(e);
+    const auto  poolN = e.blockBytes - recordBytes(e);
+    bool        ok    = true;
+
+    auto str = [&](const StrRef& r) {
+        if (!refInside(r, poolN)) {
+            ok = false;
+            return std::string();
+        }
+        return std::string(pool + r.off, r.len);
+    };
+    auto when = [&](const StrRef& r) {
+        if (!refInside(r, poolN)) {
+            ok = false;
+            return util::PackedDateTime();
+        }
+        return util::PackedDateTime(std::string_view(pool + r.off, r.len));
+    };
+    // intensity / category 名在 pool 裡本來就只存一份（見 writeUser），同一個 offset 只 intern 一次
+    std::vector<std::pair<std::uint32_t, util::Symbol>> symbols;
+    auto sym = [&](const StrRef& r) {
+        for (const auto& [off, s] : symbols) {
+            if (off == r.off) return s;
+        }
+        if (!refInside(r, poolN)) {
+            ok = false;
+            return util::Symbol();
+        }
+        util::Symbol s;
+        if (!util::Symbol::tryIntern(std::string_view(pool + r.off, r.len), s)) {
+            ok = false;
+            return s;
+        }
+        if (symbols.size() < 16) symbols.emplace_back(r.off, s);
+        return s;
+    };
+
+    out.waters.clear();
+    out.waters.reserve(e.waters);
+    for (std::uint32_t i = 0; i < e.waters; ++i, p += sizeof(WaterRec)) {
+        const auto r = load<WaterRec>(p);
+        out.waters.push_back(WaterRecord{when(r.datetime), r.amountMl});
+    }
+
+    out.sleeps.clear();
+    out.sleeps.reserve(e.sleeps);
+    for (std::uint32_t i = 0; i < e.sleeps; ++i, p += sizeof(SleepRec)) {
+        const auto r = load<SleepRec>(p);
+        out.sleeps.push_back(SleepRecord{when(r.datetime), r.hours});
+    }
+
+    out.activities.clear();
+    out.intensities.clear();
+    out.activities.reserve(e.activities);
+    for (std::uint32_t i = 0; i < e.activities; ++i, p += sizeof(ActivityRec)) {
+        const auto         r         = load<ActivityRec>(p);
+        const util::Symbol intensity = sym(r.intensity);
+        out.activities.push_back(ActivityRecord{when(r.datetime), r.minutes, intensity});
+        out.holdIntensity(intensity);
+    }
+
+    const char*   cats      = p;
+    const char*   items     = p + std::size_t{e.categories} * sizeof(CategoryRec);
+    std::uint32_t itemsLeft = e.items;
+    out.categories.clear();
+    for (std::uint32_t c = 0; c < e.categories; ++c) {
+        const auto cat = load<CategoryRec>(cats + std::size_t{c} * sizeof(CategoryRec));
+        auto&      vec = out.categories[sym(cat.name)];
+        vec.clear();
+        std::uint32_t n = cat.items;
+        if (n > itemsLeft) {
+            ok = false;
+            n  = itemsLeft;
+        }
+        vec.reserve(n);
+        for (std::uint32_t i = 0; i < n; ++i, items += sizeof(ItemRec)) {
+            const auto r = load<ItemRec>(items);
+            vec.push_back(CategoryItem{when(r.datetime), str(r.note), r.value});
+        }
+        itemsLeft -= n;
+    }
+    return ok && itemsLeft == 0;
+}
+
+// ----------------------
+// SnapshotWriter
+// ----------------------
+
+bool SnapshotWriter::fail() {
+    if (error_.empty()) error_ = out_.error();
+    return false;
+}
+
+// header 之後的內容都經過這裡，順便累積 checksum
+bool SnapshotWriter::write(const void* data, std::size_t n) {
+    if (!out_.write(data, n)) return fail();
+    bodyHash_.update(data, n);
+    offset_ += n;
+    return true;
+}
+
+bool SnapshotWriter::open(const std::string& path) {
+    if (!out_.open(path)) return fail();
+    const Header placeholder{}; // close() 時回頭補
+    if (!out_.write(&placeholder, sizeof(placeholder))) return fail();
+    offset_ = sizeof(placeholder);
+    return true;
+}
+
+std::uint32_t SnapshotWriter::dirString(const std::string& s) {
+    auto it = dirStrings_.offsets.find(s);
+    if (it != dirStrings_.offsets.end()) return it->second;
+    const auto off = static_cast<std::uint32_t>(dirStrings_.bytes.size());
+    dirStrings_.bytes += s;
+    dirStrings_.offsets.emplace(s, off);
+    return off;
+}
+
+bool SnapshotWriter::addEntry(const void* entry) {
+    if (dirStrings_.bytes.size() > UINT32_MAX) {
+        error_ = "directory strings exceed 4 GiB";
+        return false;
+    }
+    entries_.append(static_cast<const char*>(entry), sizeof(DirEntry));
+    ++users_;
+    return true;
+}
+
+bool SnapshotWriter::writeUser(const HealthBackend::UserData& u) {
+    // 檔案格式沒有 cold tier，封存的 records 解開照原本的順序寫
+    if (!u.cold.empty()) return writeUser(ColdTier::expand(u));
+
+    block_.clear();
+    pool_.clear();
+    interned_.clear();
+
+    // datetime 幾乎不會重複，直接接在後面；其他短字串同一個 user 內只存一份
+    auto raw = [&](std::string_view s) {
+        const StrRef r{static_cast<std::uint32_t>(pool_.size()), static_cast<std::uint32_t>(s.size())};
+        pool_ += s;
+        return r;
+    };
+    util::PackedDateTime::Buffer buf;
+    auto when = [&](const util::PackedDateTime& d) { return raw(d.view(buf)); };
+    auto intern = [&](const std::string& s) {
+        auto it = interned_.find(s);
+        if (it != interned_.end()) return StrRef{it->second, static_cast<std::uint32_t>(s.size())};
+        const StrRef r = raw(s);
+        interned_.emplace(std::string_view(s), r.off);
+        return r;
+    };
+
+    for (const auto& w : u.waters) append(block_, WaterRec{when(w.datetime), w.amountMl});
+    for (const auto& s : u.sleeps) append(block_, SleepRec{when(s.datetime), s.hours});
+    for (const auto& a : u.activities) {
+        append(block_, ActivityRec{when(a.datetime), intern(a.intensity.str()), a.minutes, 0});
+    }
+    std::uint32_t items = 0;
+    for (const auto& [name, vec] : u.categories) {
+        append(block_, CategoryRec{intern(name.str()), static_cast<std::uint32_t>(vec.size()), 0});
+        items += static_cast<std::uint32_t>(vec.size());
+    }
+    for (const auto& [name, vec] : u.categories) {
+        for (const auto& it : vec) append(block_, ItemRec{when(it.datetime), intern(it.note), it.value});
+    }
+    if (pool_.size() > UINT32_MAX) {
+        error_ = "user " + u.profile.name + " has more than 4 GiB of strings";
+        return false;
+    }
+    block_ += pool_;
+    padTo8(block_);
+
+    DirEntry e{};
+    e.blockOffset = offset_;
+    e.blockBytes  = block_.size();
+    e.name        = StrRef{dirString(u.profile.name), static_cast<std::uint32_t>(u.profile.name.size())};
+    e.id          = StrRef{dirString(u.profile.id), static_cast<std::uint32_t>(u.profile.id.size())};
+    e.gender      = StrRef{dirString(u.profile.gender), static_cast<std::uint32_t>(u.profile.gender.size())};
+    e.password    = StrRef{dirString(u.password), static_cast<std::uint32_t>(u.password.size())};
+    e.weightKg    = u.profile.weightKg;
+    e.heightM     = u.profile.heightM;
+    e.age         = u.profile.age;
+    e.waters      = static_cast<std::uint32_t>(u.waters.size());
+    e.sleeps      = static_cast<std::uint32_t>(u.sleeps.size());
+    e.activities  = static_cast<std::uint32_t>(u.activities.size());
+    e.categories  = static_cast<std::uint32_t>(u.categories.size());
+    e.items       = items;
+
+    if (!write(block_.data(), block_.size())) return false;
+    return addEntry(&e);
+}
+
+bool SnapshotWriter::copyUser(const SnapshotFile& from, std::size_t index) {
+    HealthBackend::UserData profile;
+    from.readProfile(index, profile);
+    const auto             c   = from.counts(index);
+    const std::string_view blk = from.block(index);
+
+    DirEntry e{};
+    e.blockOffset = offset_;
+    e.blockBytes  = blk.size();
+    e.name        = StrRef{dirString(profile.profile.name), static_cast<std::uint32_t>(profile.profile.name.size())};
+    e.id          = StrRef{dirString(profile.profile.id), static_cast<std::uint32_t>(profile.profile.id.size())};
+    e.gender =
+        StrRef{dirString(profile.profile.gender), static_cast<std::uint32_t>(profile.profile.gender.size())};
+    e.password   = StrRef{dirString(profile.password), static_cast<std::uint32_t>(profile.password.size())};
+    e.weightKg   = profile.profile.weightKg;
+    e.heightM    = profile.profile.heightM;
+    e.age        = profile.profile.age;
+    e.waters     = c.waters;
+    e.sleeps     = c.sleeps;
+    e.activities = c.activities;
+    e.categories = c.categories;
+    e.items      = c.items;
+
+    if (!write(blk.data(), blk.size())) return false;
+    return addEntry(&e);
+}
+
+bool SnapshotWriter::close(unsigned keep) {
+    if (!error_.empty() || offset_ == 0) return false; // 前面寫失敗過：out_ 的 destructor 會刪掉暫存檔
+
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version     = SnapshotFile::kVersion;
+    h.headerBytes = sizeof(Header);
+    h.userCount   = users_;
+
+    h.dirOffset = offset_;
+    if (!write(entries_.data(), entries_.size())) return false;
+    h.dirStringsOffset = offset_;
+    h.dirStringsBytes  = dirStrings_.bytes.size();
+    padTo8(dirStrings_.bytes);
+    if (!write(dirStrings_.bytes.data(), dirStrings_.bytes.size())) return false;
+    h.fileBytes = offset_ + sizeof(Trailer);
+    h.flags     = kFlagChecksum;
+
+    Trailer t{};
+    std::memcpy(t.magic, kTrailerMagic, sizeof(kTrailerMagic));
+    t.checksum = util::Xxh64::hash(&h, sizeof(h), bodyHash_.digest());
+    if (!out_.write(&t, sizeof(t)) || !out_.writeAt(0, &h, sizeof(h))) return fail();
+    if (!out_.commit(keep)) return fail();
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "HealthBackend.hpp"
+#include "../helpers/AtomicFile.hpp"
+#include "../helpers/Checksum.hpp"
+#include "../helpers/MappedFile.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ----------------------
+// Binary snapshot（storage.snap）
+// ----------------------
+//
+// 版面（little-endian，每一段都 8-byte 對齊）：
+//   Header       magic "HBSNAP\r\n"、版本、各段位置
+//   user block   每個 user 一塊：WaterRec[] SleepRec[] ActivityRec[] CategoryRec[] ItemRec[]，後面接這個 user 的字串區
+//   directory    DirEntry × users（profile、各類 record 數量、block 位置）
+//   dir strings  directory 用到的字串（name / id / gender / password）
+//   trailer      XXH64 checksum（header 的 flags 有標才有；open 時整個檔案驗一遍）
+//
+// 字串一律是 (offset, length)，offset 相對於所屬的字串區；同一個 user 裡重複的字串
+// （intensity、note、category 名）只存一份。user block 不指向 block 外面，
+// 所以存檔時還沒解開的 user 可以整塊照抄（SnapshotWriter::copyUser）。
+//
+// 版本規則：格式有不相容的改動就把 kVersion 加一，舊版讀到新版檔案會直接拒絕。
+
+// mmap 進來的 snapshot；open 時只檢查 header / directory，user 的 records 要用的時候才解
+class SnapshotFile {
+public:
+    static constexpr std::uint32_t kVersion = 1;
+
+    using Counts = HealthBackend::RecordCounts;
+
+    ~SnapshotFile();
+    SnapshotFile(const SnapshotFile&)            = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    // 檔案開頭是不是 snapshot 的 magic（不存在 / 太短都算不是）
+    static bool isSnapshot(const std::string& path);
+
+    // nullptr = 失敗（含 checksum 不符），error 有原因
+    static std::shared_ptr<const SnapshotFile> open(const std::string& path, std::string& error);
+
+    std::size_t userCount() const { return userCount_; }
+    std::size_t bytes() const { return file_.size(); }
+    bool        verified() const { return verified_; } // false = 沒有 checksum 的舊檔
+
+    // 只填 profile 與 password，records 不動
+    void readProfile(std::size_t index, HealthBackend::UserData& out) const;
+
+    // 把 records 解到 out（覆蓋原本的 records）；false = block 內容壞掉（讀得到的部分仍會填入）
+    bool readRecords(std::size_t index, HealthBackend::UserData& out) const;
+
+    Counts counts(std::size_t index) const;
+
+    // 整個 user block 的原始 bytes
+    std::string_view block(std::size_t index) const;
+
+private:
+    SnapshotFile() = default;
+
+    util::MappedFile file_;
+    std::size_t   userCount_ = 0;
+    std::uint64_t dirOffset_ = 0;
+    std::uint64_t dirStringsOffset_ = 0;
+    std::uint64_t dirStringsBytes_  = 0;
+    bool          verified_ = false;
+
+    std::string dirString(std::uint32_t off, std::uint32_t len) const;
+};
+
+// 依序寫出 user，close() 時補上 directory / header / checksum。
+// 透過 util::AtomicFile 寫：close() 成功前 path 都還是舊檔，沒 close() 的話暫存檔會被刪掉
+class SnapshotWriter {
+public:
+    SnapshotWriter() = default;
+    SnapshotWriter(const SnapshotWriter&)            = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    bool open(const std::string& path);
+    bool writeUser(const HealthBackend::UserData& user);
+    // user 還沒被解開時，直接照抄舊 snapshot 的 block
+    bool copyUser(const SnapshotFile& from, std::size_t index);
+    // keep = 舊檔留幾份（<path>.1 … <path>.keep）
+    bool close(unsigned keep = 0);
+
+    std::uint64_t      bytesWritten() const { return offset_; }
+    const std::string& error() const { return error_; }
+
+private:
+    struct DirStrings {
+        std::string                                  bytes;
+        std::unordered_map<std::string, std::uint32_t> offsets;
+    };
+
+    util::AtomicFile  out_;
+    util::Xxh64       bodyHash_;   // header 之後寫出的所有 bytes
+    std::uint64_t     offset_ = 0;
+    std::string       error_;
+    std::string       entries_;    // 已編碼的 DirEntry
+    std::uint64_t     users_ = 0;
+    DirStrings        dirStrings_;
+    std::string       block_;      // 重複使用的 user block buffer
+    std::string       pool_;       // 目前這個 user 的字串區
+    std::unordered_map<std::string_view, std::uint32_t> interned_; // pool_ 裡已經有的字串
+
+    bool          write(const void* data, std::size_t n);
+    bool          fail(); // 把 out_ 的錯誤記到 error_
+    std::uint32_t dirString(const std::string& s);
+    bool          addEntry(const void* entry);
+};
@@ -0,0 +1,630 @@
+#include "StorageLoader.hpp"
+#include "../external/json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "../helpers/Checksum.hpp"
+#include "../helpers/MappedFile.hpp"
+
+using nlohmann::json;
+
+namespace {
+
+// ----------------------
+// 結構掃描：只找出 "users" 陣列每個元素的範圍
+// ----------------------
+// 只檢查括號 / 字串有沒有配對，內容的正確性交給後面的 SAX parse。
+
+struct Range {
+    const char *begin;
+    const char *end;
+};
+
+class Scanner {
+public:
+    Scanner(const char *begin, const char *end) : begin_(begin), p_(begin), end_(end) {}
+
+    bool scan(std::vector<Range> &users, std::string &error) {
+        ws();
+        if (!expect('{')) return fail(error, "expected '{' at top level");
+        ws();
+        if (peek('}')) {
+            ++p_;
+        } else {
+            for (;;) {
+                ws();
+                const char *keyBegin = p_;
+                if (!peek('"') || !skipString()) return fail(error, "expected object key");
+                const std::string_view key(keyBegin + 1, static_cast<std::size_t>(p_ - keyBegin - 2));
+                ws();
+                if (!expect(':')) return fail(error, "expected ':'");
+                ws();
+                if (key == "users" && peek('[')) {
+                    users.clear(); // 重複的 key 以最後一個為準（跟 DOM 一樣）
+                    if (!scanUsers(users)) return fail(error, "malformed \"users\" array");
+                } else if (!skipValue()) {
+                    return fail(error, "malformed value");
+                }
+                ws();
+                if (peek(',')) {
+                    ++p_;
+                    continue;
+                }
+                if (!expect('}')) return fail(error, "expected ',' or '}'");
+                break;
+            }
+        }
+        ws();
+        if (p_ != end_) return fail(error, "trailing characters after top-level object");
+        return true;
+    }
+
+private:
+    const char *begin_;
+    const char *p_;
+    const char *end_;
+
+    bool fail(std::string &error, const char *what) const {
+        error = std::string(what) + " near byte " + std::to_string(offset());
+        return false;
+    }
+
+    std::size_t offset() const { return static_cast<std::size_t>(p_ - begin_); }
+
+    bool peek(char c) const { return p_ < end_ && *p_ == c; }
+
+    bool expect(char c) {
+        if (!peek(c)) return false;
+        ++p_;
+        return true;
+    }
+
+    void ws() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+
+    // p_ 在開頭的 '"'；結束時 p_ 在結尾 '"' 的下一個字
+    bool skipString() {
+        ++p_;
+        for (;;) {
+            const void *q = std::memchr(p_, '"', static_cast<std::size_t>(end_ - p_));
+            if (!q) return false;
+            const char *quote = static_cast<const char *>(q);
+            // 前面有奇數個 '\' 代表這個 '"' 被跳脫了
+            std::size_t slashes = 0;
+            for (const char *s = quote; s > p_ && s[-1] == '\\'; --s) ++slashes;
+            p_ = quote + 1;
+            if (slashes % 2 == 0) return true;
+        }
+    }
+
+    bool skipValue() {
+        if (p_ >= end_) return false;
+        if (*p_ == '"') return skipString();
+        if (*p_ != '{' && *p_ != '[') {
+            // number / true / false / null
+            const char *start = p_;
+            while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' && *p_ != ' ' && *p_ != '\n' &&
+                   *p_ != '\r' && *p_ != '\t')
+                ++p_;
+            return p_ != start;
+        }
+        std::size_t depth = 0;
+        while (p_ < end_) {
+            const char c = *p_;
+            if (c == '"') {
+                if (!skipString()) return false;
+                continue;
+            }
+            ++p_;
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) return true;
+            }
+        }
+        return false;
+    }
+
+    bool scanUsers(std::vector<Range> &users) {
+        ++p_; // '['
+        ws();
+        if (peek(']')) {
+            ++p_;
+            return true;
+        }
+        for (;;) {
+            ws();
+            const char *begin = p_;
+            if (!skipValue()) return false;
+            users.push_back(Range{begin, p_});
+            ws();
+            if (peek(',')) {
+                ++p_;
+                continue;
+            }
+            return expect(']');
+        }
+    }
+};
+
+// ----------------------
+// SAX handler：一個 user object → UserData
+// ----------------------
+// 欄位缺少 / 型別不對就用預設值（跟以前 ju.value(key, default) 一樣）。
+// depth：1 = user object，2 = waters / sleeps / activities 陣列或 categories object，
+//        3 = 一筆 record 或一個 category 陣列，4 = 一筆 category item
+
+class UserSaxHandler {
+public:
+    explicit UserSaxHandler(HealthBackend::UserData &data) : d_(data) {
+        d_.profile.gender = "other";
+    }
+
+    bool hasName() const { return hasName_; }
+    bool hasId() const { return hasId_; }
+    const std::string &error() const { return error_; }
+
+    // ---- nlohmann SAX interface ----
+
+    bool null() { return true; }
+    bool boolean(bool) { return true; }
+    bool number_integer(json::number_integer_t v) { return number(static_cast<double>(v), v); }
+    bool number_unsigned(json::number_unsigned_t v) {
+        return number(static_cast<double>(v), static_cast<long long>(v));
+    }
+    bool number_float(json::number_float_t v, const json::string_t &) {
+        return number(v, static_cast<long long>(v));
+    }
+    bool binary(json::binary_t &) { return true; }
+
+    bool string(json::string_t &v) {
+        if (skipping()) return true;
+        if (depth_ == 1) {
+            if (key_ == "name") {
+                d_.profile.name = std::move(v);
+                hasName_        = true;
+            } else if (key_ == "id") {
+                d_.profile.id = std::move(v);
+                hasId_        = true;
+            } else if (key_ == "gender") {
+                d_.profile.gender = std::move(v);
+            } else if (key_ == "password") {
+                d_.password = std::move(v);
+            }
+        } else if (depth_ == 3) {
+            if (section_ == Section::Waters && key_ == "datetime") water_.datetime = v;
+            else if (section_ == Section::Sleeps && key_ == "datetime") sleep_.datetime = v;
+            else if (section_ == Section::Activities) {
+                if (key_ == "datetime") activity_.datetime = v;
+                else if (key_ == "intensity") {
+                    if (!util::Symbol::tryIntern(v, intensity_)) {
+                        error_ = "too many distinct intensity values";
+                        return false;
+                    }
+                    activity_.intensity = intensity_;
+                }
+            }
+        } else if (depth_ == 4 && section_ == Section::Categories) {
+            if (key_ == "datetime") item_.datetime = v;
+            else if (key_ == "note") item_.note = std::move(v);
+        }
+        return true;
+    }
+
+    bool key(json::string_t &k) {
+        if (!skipping()) key_ = std::move(k);
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        if (skipping()) return enterSkipped();
+        if (depth_ == 0) {
+            depth_ = 1;
+            return true;
+        }
+        if (depth_ == 1 && key_ == "categories") {
+            section_ = Section::Categories;
+            depth_   = 2;
+            return true;
+        }
+        if (depth_ == 2 && section_ != Section::Categories && section_ != Section::None) {
+            water_     = WaterRecord{};
+            sleep_     = SleepRecord{};
+            activity_  = ActivityRecord{};
+            intensity_ = util::Symbol();
+            depth_     = 3;
+            return true;
+        }
+        if (depth_ == 3 && section_ == Section::Categories) {
+            item_  = CategoryItem{};
+            depth_ = 4;
+            return true;
+        }
+        return startSkip();
+    }
+
+    bool end_object() { return leave(); }
+
+    bool start_array(std::size_t) {
+        if (skipping()) return enterSkipped();
+        if (depth_ == 1) {
+            if (key_ == "waters") {
+                section_ = Section::Waters;
+                d_.waters.clear();
+            } else if (key_ == "sleeps") {
+                section_ = Section::Sleeps;
+                d_.sleeps.clear();
+            } else if (key_ == "activities") {
+                section_ = Section::Activities;
+                d_.activities.clear();
+            } else {
+                return startSkip();
+            }
+            depth_ = 2;
+            return true;
+        }
+        if (depth_ == 2 && section_ == Section::Categories) {
+            util::Symbol name;
+            if (!util::Symbol::tryIntern(key_, name)) {
+                error_ = "too many distinct category names";
+                return false;
+            }
+            items_ = &d_.categories[name];
+            items_->clear();
+            depth_ = 3;
+            return true;
+        }
+        return startSkip();
+    }
+
+    bool end_array() { return leave(); }
+
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &e) {
+        error_ = e.what();
+        return false;
+    }
+
+private:
+    enum class Section { None, Waters, Sleeps, Activities, Categories };
+
+    HealthBackend::UserData &d_;
+    int         depth_     = 0;
+    int         skipUntil_ = -1; // >= 0：在回到這個 depth 之前的 event 都忽略
+    Section     section_   = Section::None;
+    std::string key_;
+    bool        hasName_ = false;
+    bool        hasId_   = false;
+    std::string error_;
+
+    WaterRecord                water_;
+    SleepRecord                sleep_;
+    ActivityRecord             activity_;
+    util::Symbol               intensity_; // activity_.intensity 的 reference，record 結束時交給 d_.intensities
+    CategoryItem               item_;
+    std::vector<CategoryItem> *items_ = nullptr;
+
+    bool skipping() const { return skipUntil_ >= 0; }
+
+    bool startSkip() {
+        skipUntil_ = depth_;
+        ++depth_;
+        return true;
+    }
+
+    bool enterSkipped() {
+        ++depth_;
+        return true;
+    }
+
+    bool leave() {
+        --depth_;
+        if (skipping()) {
+            if (depth_ == skipUntil_) skipUntil_ = -1;
+            return true;
+        }
+        if (depth_ == 2) {
+            // 一筆 record 結束
+            switch (section_) {
+            case Section::Waters: d_.waters.push_back(std::move(water_)); break;
+            case Section::Sleeps: d_.sleeps.push_back(std::move(sleep_)); break;
+            case Section::Activities:
+                d_.activities.push_back(activity_);
+                d_.holdIntensity(intensity_);
+                break;
+            default: break;
+            }
+        } else if (depth_ == 3 && section_ == Section::Categories) {
+            items_->push_back(std::move(item_));
+        } else if (depth_ == 1) {
+            section_ = Section::None;
+        }
+        return true;
+    }
+
+    bool number(double d, long long i) {
+        if (skipping()) return true;
+        if (depth_ == 1) {
+            if (key_ == "age") d_.profile.age = static_cast<int>(i);
+            else if (key_ == "weightKg") d_.profile.weightKg = d;
+            else if (key_ == "heightM") d_.profile.heightM = d;
+        } else if (depth_ == 3) {
+            if (section_ == Section::Waters && key_ == "amountMl") water_.amountMl = d;
+            else if (section_ == Section::Sleeps && key_ == "hours") sleep_.hours = d;
+            else if (section_ == Section::Activities && key_ == "minutes") activity_.minutes = static_cast<int>(i);
+        } else if (depth_ == 4 && section_ == Section::Categories && key_ == "value") {
+            item_.value = d;
+        }
+        return true;
+    }
+};
+
+// ----------------------
+// 檔尾的 "checksum"
+// ----------------------
+
+constexpr std::string_view kChecksumKey    = "\"checksum\"";
+constexpr std::string_view kChecksumPrefix = "xxh64:";
+
+enum class Trailer {
+    None,     // 沒有 checksum（舊檔 / 手寫 / gen_dataset）
+    Ok,
+    Mismatch,
+};
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+// 只看檔尾：`, "checksum" : "xxh64:<hex>" }`，格式不完全符合就當作沒有
+Trailer checkTrailer(const char *data, std::size_t size) {
+    const std::string_view all(data, size);
+    const std::size_t      tail = size > 128 ? size - 128 : 0;
+    const std::size_t      key  = all.rfind(kChecksumKey);
+    if (key == std::string_view::npos || key < tail) return Trailer::None;
+
+    std::size_t comma = key;
+    while (comma > 0 && isSpace(all[comma - 1])) --comma;
+    if (comma == 0 || all[comma - 1] != ',') return Trailer::None;
+    --comma;
+
+    std::size_t p    = key + kChecksumKey.size();
+    auto        skip = [&] {
+        while (p < size && isSpace(all[p])) ++p;
+    };
+    skip();
+    if (p >= size || all[p++] != ':') return Trailer::None;
+    skip();
+    if (all.compare(p, 1 + kChecksumPrefix.size(), "\"xxh64:") != 0) return Trailer::None;
+    p += 1 + kChecksumPrefix.size();
+    std::uint64_t expected = 0;
+    for (int i = 0; i < 16; ++i, ++p) {
+        if (p >= size) return Trailer::None;
+        const char c = all[p];
+        int        v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (v < 0) return Trailer::None;
+        expected = expected << 4 | static_cast<std::uint64_t>(v);
+    }
+    if (p >= size || all[p++] != '"') return Trailer::None;
+    skip();
+    if (p >= size || all[p++] != '}') return Trailer::None;
+    skip();
+    if (p != size) return Trailer::None;
+
+    return util::Xxh64::hash(data, comma) == expected ? Trailer::Ok : Trailer::Mismatch;
+}
+
+} // namespace
+
+void StorageLoader::appendChecksum(std::string &doc) {
+    // dump(2) 的結尾是 "\n}"；拿掉後接上 checksum 再補回來
+    while (!doc.empty() && isSpace(doc.back())) doc.pop_back();
+    if (!doc.empty() && doc.back() == '}') doc.pop_back();
+    while (!doc.empty() && isSpace(doc.back())) doc.pop_back();
+
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), ",\n  \"checksum\": \"xxh64:%016llx\"\n}\n",
+                  static_cast<unsigned long long>(util::Xxh64::hash(doc.data(), doc.size())));
+    doc += buf;
+}
+
+std::string StorageLoader::userFilePath(const std::string &dir, const std::string &name) {
+    static const char hex[] = "0123456789abcdef";
+    const std::uint64_t h = util::Xxh64::hash(name.data(), name.size());
+
+    std::string file;
+    for (const char c : name) {
+        const auto u = static_cast<unsigned char>(c);
+        if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_' || u == '-') {
+            file += c;
+        } else {
+            file += '%';
+            file += hex[u >> 4];
+            file += hex[u & 15];
+        }
+    }
+    if (file.size() > 200) { // 檔名上限 255 bytes；name 存在檔案裡，檔名不需要還原得回來
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "~%016llx", static_cast<unsigned long long>(h));
+        file = buf;
+    }
+
+    char bucket[4];
+    std::snprintf(bucket, sizeof(bucket), "%02x", static_cast<unsigned>(h & 0xff));
+    return dir + "/" + bucket + "/" + file + ".json";
+}
+
+StorageLoader::Status StorageLoader::loadUserFile(const std::string &path, HealthBackend::UserData &out,
+                                                  std::string &error) {
+    util::MappedFile file;
+    if (!file.open(path)) {
+        if (errno == ENOENT) return Status::Missing;
+        error = std::string("cannot open: ") + std::strerror(errno);
+        return Status::Error;
+    }
+    if (checkTrailer(file.data(), file.size()) == Trailer::Mismatch) {
+        error = "checksum mismatch";
+        return Status::Error;
+    }
+    UserSaxHandler handler(out);
+    if (!json::sax_parse(file.data(), file.data() + file.size(), &handler)) {
+        error = handler.error();
+        return Status::Error;
+    }
+    if (!handler.hasName()) {
+        error = "missing \"name\"";
+        return Status::Error;
+    }
+    if (!handler.hasId()) out.profile.id = out.profile.name;
+    return Status::Ok;
+}
+
+StorageLoader::Status StorageLoader::loadDirectory(const std::string &dir, unsigned threads, Result &out,
+                                                  bool keepRecords) {
+    namespace fs = std::filesystem;
+    out = Result{};
+
+    // 只認 <bucket>/*.json；.tmp、.1 備份、.corrupt 都不算
+    std::vector<std::string> files;
+    try {
+        if (!fs::exists(dir)) return Status::Missing;
+        for (const auto &bucket : fs::directory_iterator(dir)) {
+            if (!bucket.is_directory()) continue;
+            for (const auto &f : fs::directory_iterator(bucket.path())) {
+                if (f.path().extension() != ".json" || !f.is_regular_file()) continue;
+                files.push_back(f.path().string());
+                out.bytes += static_cast<std::size_t>(f.file_size());
+            }
+        }
+    } catch (const fs::filesystem_error &e) {
+        out.error = e.what();
+        return Status::Error;
+    }
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(1, files.size() / 64)));
+    out.threads = threads;
+
+    std::vector<HealthBackend::UserData> decoded(files.size());
+    std::vector<char>                    valid(files.size(), 0);
+    std::atomic<std::size_t>             next{0};
+    std::mutex                           failedMtx;
+
+    // 每個檔案都要 open + mmap，一批拿少一點就好
+    constexpr std::size_t kBatch = 16;
+    auto worker = [&] {
+        for (;;) {
+            const std::size_t first = next.fetch_add(kBatch, std::memory_order_relaxed);
+            if (first >= files.size()) return;
+            const std::size_t last = std::min(first + kBatch, files.size());
+            for (std::size_t i = first; i < last; ++i) {
+                std::string error;
+                if (loadUserFile(files[i], decoded[i], error) == Status::Ok) {
+                    valid[i] = 1;
+                    if (!keepRecords) {
+                        auto &d    = decoded[i];
+                        d.counts   = d.recordCounts();
+                        d.resident = false;
+                        std::vector<WaterRecord>().swap(d.waters);
+                        std::vector<SleepRecord>().swap(d.sleeps);
+                        std::vector<ActivityRecord>().swap(d.activities);
+                        d.intensities.clear();
+                        d.categories.clear();
+                    }
+                    continue;
+                }
+                decoded[i] = HealthBackend::UserData{};
+                std::lock_guard<std::mutex> lk(failedMtx);
+                out.failed.push_back(Failure{files[i], error.empty() ? "disappeared while loading" : error});
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool) t.join();
+
+    out.users.reserve(files.size());
+    for (std::size_t i = 0; i < decoded.size(); ++i) {
+        if (valid[i]) out.users.push_back(std::move(decoded[i]));
+    }
+    return Status::Ok;
+}
+
+StorageLoader::Status StorageLoader::load(const std::string &path, unsigned threads, Result &out) {
+    out = Result{};
+
+    util::MappedFile file;
+    if (!file.open(path)) {
+        if (errno == ENOENT) return Status::Missing;
+        out.error = std::string("cannot open: ") + std::strerror(errno);
+        return Status::Error;
+    }
+    out.bytes = file.size();
+
+    switch (checkTrailer(file.data(), file.size())) {
+    case Trailer::Mismatch:
+        out.error = "checksum mismatch";
+        return Status::Error;
+    case Trailer::Ok:
+        out.verified = true;
+        break;
+    case Trailer::None:
+        break;
+    }
+
+    std::vector<Range> ranges;
+    Scanner scanner(file.data(), file.data() + file.size());
+    if (!scanner.scan(ranges, out.error)) return Status::Error;
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    // user 很少的時候多開 thread 只是浪費
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(1, ranges.size() / 64)));
+    out.threads = threads;
+
+    std::vector<HealthBackend::UserData> decoded(ranges.size());
+    std::vector<char>                    valid(ranges.size(), 0);
+    std::atomic<std::size_t>             next{0};
+    std::atomic<bool>                    failed{false};
+    std::mutex                           errorMtx;
+
+    // 一次拿一小批，skew 很大的時候（少數 user 佔大部分資料）也能分得平均
+    constexpr std::size_t kBatch = 32;
+    auto worker = [&] {
+        for (;;) {
+            const std::size_t first = next.fetch_add(kBatch, std::memory_order_relaxed);
+            if (first >= ranges.size() || failed.load(std::memory_order_relaxed)) return;
+            const std::size_t last = std::min(first + kBatch, ranges.size());
+            for (std::size_t i = first; i < last; ++i) {
+                UserSaxHandler handler(decoded[i]);
+                if (!json::sax_parse(ranges[i].begin, ranges[i].end, &handler)) {
+                    std::lock_guard<std::mutex> lk(errorMtx);
+                    if (!failed.exchange(true)) out.error = "user #" + std::to_string(i) + ": " + handler.error();
+                    return;
+                }
+                if (!handler.hasName()) continue;
+                if (!handler.hasId()) decoded[i].profile.id = decoded[i].profile.name;
+                valid[i] = 1;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool) t.join();
+    if (failed.load()) return Status::Error;
+
+    out.users.reserve(ranges.size());
+    for (std::size_t i = 0; i < decoded.size(); ++i) {
+        if (valid[i]) out.users.push_back(std::move(decoded[i]));
+    }
+    return Status::Ok;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "HealthBackend.hpp"
+
+#include <string>
+#include <vector>
+
+// ----------------------
+// storage.json 的 streaming loader
+// ----------------------
+//
+// 不建整份 nlohmann DOM：
+//   1. mmap 整個檔案，單執行緒掃一遍，只切出 "users" 陣列裡每個 user 的 byte range
+//   2. 多個 thread 各自把 range 丟給 SAX handler，直接組出 UserData
+// 記憶體高峰 ≈ 最後的 UserData 本身（檔案內容在 page cache，不另外複製）。
+//
+// 任何一個 user 解析失敗就整份失敗（跟以前 DOM parse 失敗一樣，不會只載入一半）。
+//
+// HealthBackend 存的檔案最後一個 key 是 "checksum"（見 appendChecksum）：有的話先驗，
+// 不符就當成壞檔。手寫 / gen_dataset 產生的檔案沒有這個 key，照樣載入。
+//
+// per-user 目錄（StorageFormat::PerUser）：每個 user 一個檔案 <dir>/<bucket>/<name>.json，
+// 內容就是 storage.json 裡 "users" 陣列的一個元素（加上 checksum）。
+class StorageLoader {
+public:
+    enum class Status {
+        Ok,
+        Missing, // 檔案不存在 → 呼叫端當成空資料庫
+        Error,   // 打不開 / 格式錯誤，error 有原因
+    };
+
+    struct Failure {
+        std::string path;
+        std::string error;
+    };
+
+    struct Result {
+        // 照檔案順序；沒有 "name" 的 user 已經跳過
+        std::vector<HealthBackend::UserData> users;
+        std::vector<Failure>                 failed; // loadDirectory：讀不進來的 user 檔
+        std::size_t bytes   = 0;
+        unsigned    threads = 0; // 實際用到的 thread 數
+        bool        verified = false; // 有 checksum 而且對得上
+        std::string error;
+    };
+
+    // threads = 0 → std::thread::hardware_concurrency()
+    static Status load(const std::string& path, unsigned threads, Result& out);
+
+    // 整個 per-user 目錄，多 thread 各自讀一批檔案。單一檔案壞掉不會讓整個目錄失敗：
+    // 列在 out.failed，其他 user 照樣載入（要不要退回備份由呼叫端決定）。
+    // keepRecords = false：只留 profile 和 records 數量（UserData::resident = false），之後要用再讀單一檔案
+    static Status loadDirectory(const std::string& dir, unsigned threads, Result& out, bool keepRecords = true);
+
+    // 單一 user 檔（也拿來讀 <file>.1 之類的備份）；沒有 "name" 算錯誤
+    static Status loadUserFile(const std::string& path, HealthBackend::UserData& out, std::string& error);
+
+    // bucket = XXH64(name) 的低 8 bits（00 … ff），一個目錄裡不會有幾十萬個檔案。
+    // 檔名是 name 本身，[A-Za-z0-9_-] 以外的字元寫成 %XX；太長的 name 改用 hash 當檔名
+    static std::string userFilePath(const std::string& dir, const std::string& name);
+
+    // doc 是 json::dump(2) 的結果（以 "}" 結尾的 object）：在最後補上
+    //   ,\n  "checksum": "xxh64:<16 hex>"\n}
+    // checksum 涵蓋前面那個 "," 之前的所有 bytes
+    static void appendChecksum(std::string& doc);
+};
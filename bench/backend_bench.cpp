@@ -0,0 +1,501 @@
+// bench/backend_bench.cpp
+// HealthBackend 核心操作的 microbenchmark（不開 HTTP，不需要既有使用者）
+//
+//   backend_bench                          -> 1k / 10k / 100k / 1M records, text table
+//   backend_bench --sizes 1000,10000 --ops 5000 --json
+//
+// 每個 size 先灌一份合成資料（每個 user 約 100 筆，平均分給 water/sleep/activity/category），
+// 再量 ns/op 與 allocations/op（全域 operator new 計數）。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../backend/HealthBackend.hpp"
+#include "../external/json.hpp"
+#include "../helpers/Arena.hpp"
+#include "../helpers/DateTime.hpp"
+#include "../helpers/FlatHashMap.hpp"
+#include "../helpers/Logger.hpp"
+
+using json = nlohmann::ordered_json;
+
+// ===== allocation counter =====
+
+static std::atomic<std::uint64_t> g_allocs{0};
+
+void* operator new(std::size_t n) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(n ? n : 1);
+}
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(n ? n : 1);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr std::size_t kRecordsPerUser = 100;
+constexpr std::size_t kDeepUsers = 64;
+constexpr std::size_t kDeepWaters = 1024;
+constexpr std::size_t kRankActivities = 1024;
+constexpr const char* kCategory = "mood";
+
+struct Result {
+  std::size_t records = 0;
+  std::string op;
+  std::uint64_t ops = 0;
+  double nsPerOp = 0.0;
+  double allocsPerOp = 0.0;
+};
+
+template <typename F>
+Result measure(std::size_t records, const char* op, std::uint64_t ops, F&& fn) {
+  const std::uint64_t a0 = g_allocs.load(std::memory_order_relaxed);
+  const auto t0 = std::chrono::steady_clock::now();
+  for (std::uint64_t i = 0; i < ops; ++i) fn(i);
+  const auto t1 = std::chrono::steady_clock::now();
+  const std::uint64_t a1 = g_allocs.load(std::memory_order_relaxed);
+
+  Result r;
+  r.records = records;
+  r.op = op;
+  r.ops = ops;
+  r.nsPerOp = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()) /
+              static_cast<double>(ops);
+  r.allocsPerOp = static_cast<double>(a1 - a0) / static_cast<double>(ops);
+  return r;
+}
+
+std::string datetimeFor(std::uint64_t i) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "2025-%02u-%02uT%02u:%02u:00Z", static_cast<unsigned>(i / 28 % 12 + 1),
+                static_cast<unsigned>(i % 28 + 1), static_cast<unsigned>(i % 24), static_cast<unsigned>(i % 60));
+  return buf;
+}
+
+// server.cpp 的 json：DOM 從 request arena 配置
+using ArenaJson = nlohmann::basic_json<nlohmann::ordered_map, std::vector, std::string, bool, std::int64_t,
+                                       std::uint64_t, double, util::ArenaAllocator>;
+
+// 照 server.cpp 的 GET /waters 組回應
+template <typename Json>
+std::size_t renderWaters(const std::vector<WaterRecord>& records) {
+  Json arr = Json::array();
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    Json jr;
+    jr["id"] = std::to_string(i);
+    jr["datetime"] = records[i].datetime.str();
+    jr["amountMl"] = records[i].amountMl;
+    arr.push_back(std::move(jr));
+  }
+  return arr.dump().size();
+}
+
+// 照 server.cpp 的 POST /waters：解析 body、回傳新 record
+template <typename Json>
+std::size_t echoWater(const std::string& body) {
+  Json j = Json::parse(body);
+  Json out;
+  out["id"] = "0";
+  out["datetime"] = j["datetime"].template get<std::string>();
+  out["amountMl"] = j["amountMl"].template get<double>();
+  return out.dump().size();
+}
+
+std::vector<std::size_t> parseSizes(const char* spec) {
+  std::vector<std::size_t> out;
+  for (const char* p = spec; *p;) {
+    char* end = nullptr;
+    const unsigned long long v = std::strtoull(p, &end, 10);
+    if (end == p) break;
+    if (v > 0) out.push_back(static_cast<std::size_t>(v));
+    p = *end == ',' ? end + 1 : end;
+  }
+  return out;
+}
+
+// 灌資料：users = records / 100，每人 waters/sleeps/activities/category 各 1/4
+std::vector<std::string> seed(HealthBackend& backend, std::size_t records) {
+  const std::size_t users = std::max<std::size_t>(1, records / kRecordsPerUser);
+  std::vector<std::string> tokens;
+  tokens.reserve(users);
+  std::size_t left = records;
+  for (std::size_t u = 0; u < users; ++u) {
+    const std::string name = "user" + std::to_string(u);
+    backend.registerUser(name, 30, 70.0, 1.75, "pw" + std::to_string(u), "other");
+    const std::string token = backend.login(name, "pw" + std::to_string(u));
+    backend.createCategory(token, kCategory);
+    const std::size_t mine = u + 1 == users ? left : std::min(left, kRecordsPerUser);
+    for (std::size_t i = 0; i < mine; ++i) {
+      const std::string dt = datetimeFor(i);
+      switch (i % 4) {
+        case 0: backend.addWater(token, dt, 250.0); break;
+        case 1: backend.addSleep(token, dt, 7.5); break;
+        case 2: backend.addActivity(token, dt, 30, "moderate"); break;
+        default: backend.addOtherRecord(token, kCategory, dt, 1.0, "ok"); break;
+      }
+    }
+    left -= mine;
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+
+void runSize(std::size_t records, std::uint64_t maxOps, const std::filesystem::path& dir,
+             std::vector<Result>& results) {
+  const std::string path = (dir / ("storage_" + std::to_string(records) + ".json")).string();
+  std::filesystem::remove(path);
+
+  HealthBackend::Options opts;
+  opts.storagePath = path;
+  opts.autoSave = false;  // 只量記憶體內的操作；存檔另外量
+  HealthBackend backend(opts);
+  std::vector<std::string> tokens = seed(backend, records);
+  const std::size_t users = tokens.size();
+
+  // 參數字串先準備好，不要把 benchmark 自己的 allocation 算進去
+  std::vector<std::string> datetimes, newNames, names, passwords;
+  for (std::uint64_t i = 0; i < 1024; ++i) datetimes.push_back(datetimeFor(i));
+  for (std::uint64_t i = 0; i < maxOps; ++i) newNames.push_back("new" + std::to_string(records) + "_" + std::to_string(i));
+  for (std::size_t u = 0; u < users; ++u) {
+    names.push_back("user" + std::to_string(u));
+    passwords.push_back("pw" + std::to_string(u));
+  }
+  auto dt = [&](std::uint64_t i) -> const std::string& { return datetimes[i % datetimes.size()]; };
+
+  std::mt19937_64 rng(42);
+  auto pick = [&]() -> const std::string& { return tokens[rng() % users]; };
+  const std::uint64_t ops = maxOps;
+  // 每次 login 都會產生新 token（random_device），比其他操作慢很多
+  const std::uint64_t loginOps = std::min<std::uint64_t>(ops, 2000);
+
+  auto add = [&](Result r) { results.push_back(std::move(r)); };
+
+  // 順序：先量不會改變資料量的操作（save/load、查詢、update），
+  // 再做 add / delete / register，避免大量新增把小 size 的資料撐大
+
+  // 整份檔案的 save / load；大 size 只跑一次
+  const std::uint64_t ioOps = records >= 1000000 ? 1 : 3;
+  add(measure(records, "saveToFile", ioOps, [&](std::uint64_t) { backend.saveToFile(); }));
+  add(measure(records, "loadFromFile", ioOps, [&](std::uint64_t) {
+    HealthBackend loaded(opts);  // constructor 會 loadFromFile()
+    if (loaded.getStats().users == 0) std::cerr << "load produced no users\n";
+  }));
+
+  // per-user 目錄：整份匯出 / 載入，以及 autoSave 下新增一筆（只重寫那個 user 的檔案，含 fsync）
+  const std::string userDir = (dir / ("users_" + std::to_string(records))).string();
+  std::filesystem::remove_all(userDir);
+  add(measure(records, "savePerUser", ioOps,
+              [&](std::uint64_t) { backend.exportTo(userDir, HealthBackend::StorageFormat::PerUser); }));
+  HealthBackend::Options dirOpts = opts;
+  dirOpts.storagePath = userDir;
+  dirOpts.format = HealthBackend::StorageFormat::PerUser;
+  add(measure(records, "loadPerUser", ioOps, [&](std::uint64_t) {
+    HealthBackend loaded(dirOpts);
+    if (loaded.getStats().users == 0) std::cerr << "per-user load produced no users\n";
+  }));
+  {
+    dirOpts.autoSave = true;
+    HealthBackend live(dirOpts);
+    std::vector<std::string> liveTokens;
+    for (std::size_t u = 0; u < std::min<std::size_t>(users, 64); ++u) {
+      liveTokens.push_back(live.login(names[u], passwords[u]));
+    }
+    add(measure(records, "persistAddWater", std::min<std::uint64_t>(ops, 200),
+                [&](std::uint64_t i) {
+                  live.addWater(liveTokens[i % liveTokens.size()], dt(i), 300.0);
+                  live.flush();  // 存檔在背景 thread；這裡等它寫完（那個 user 的檔案 + fsync）
+                }));
+  }
+  {
+    // memory budget 只放得下幾個 user：隨機查詢幾乎每次都要從 user 檔讀回來，再把最舊的趕出去
+    HealthBackend::Options budgetOpts = dirOpts;
+    budgetOpts.autoSave = false;
+    budgetOpts.memoryBudget = 64 * 1024;
+    HealthBackend cold(budgetOpts);
+    std::vector<std::string> coldTokens;
+    for (std::size_t u = 0; u < std::min<std::size_t>(users, 2000); ++u) {
+      coldTokens.push_back(cold.login(names[u], passwords[u]));
+    }
+    add(measure(records, "faultInPerUser", std::min<std::uint64_t>(ops, 2000),
+                [&](std::uint64_t) { cold.getAllWater(coldTokens[rng() % coldTokens.size()]); }));
+  }
+  std::filesystem::remove_all(userDir);
+  {
+    // 歷史比較長的 user（每人 kDeepWaters 筆 waters，datetime 都在 2025）：
+    // coldAfterDays = 30 時整份歷史都封存在 cold tier，跟全部留在 hot 的同一份資料比
+    const std::string deepPath = (dir / ("deep_" + std::to_string(records) + ".json")).string();
+    HealthBackend::Options deepOpts = opts;
+    deepOpts.storagePath = deepPath;
+    std::filesystem::remove(deepPath);
+    // 每 8 小時一筆，照時間順序（2025-01-01 起約 341 天）
+    const std::int64_t jan = 1735689600000;  // 2025-01-01T00:00:00Z
+    std::vector<std::string> deepNames, deepDatetimes(kDeepWaters);
+    for (std::size_t i = 0; i < kDeepWaters; ++i) {
+      util::formatDateTime(jan + static_cast<std::int64_t>(i) * 8 * 3600000, util::DateTimeFormat::IsoZ,
+                           deepDatetimes[i]);
+    }
+    {
+      HealthBackend deep(deepOpts);
+      for (std::size_t u = 0; u < kDeepUsers; ++u) {
+        deepNames.push_back("deep" + std::to_string(u));
+        deep.registerUser(deepNames.back(), 30, 70.0, 1.75, passwords[0], "other");
+        const std::string token = deep.login(deepNames.back(), passwords[0]);
+        for (std::size_t i = 0; i < kDeepWaters; ++i) {
+          deep.addWater(token, deepDatetimes[i], 250.0 + static_cast<double>(i % 8) * 50.0);
+        }
+      }
+      deep.saveToFile();
+    }
+    const std::int64_t june = 1748736000000;  // 2025-06-01T00:00:00Z
+    for (const unsigned coldAfterDays : {0u, 30u}) {
+      deepOpts.coldAfterDays = coldAfterDays;
+      HealthBackend deep(deepOpts);
+      std::vector<std::string> deepTokens;
+      for (const auto& name : deepNames) deepTokens.push_back(deep.login(name, passwords[0]));
+      auto deepPick = [&]() -> const std::string& { return deepTokens[rng() % deepTokens.size()]; };
+      const std::string suffix = coldAfterDays ? "Cold" : "Hot";
+      add(measure(records, ("getAllWater" + suffix).c_str(), std::min<std::uint64_t>(ops, 2000),
+                  [&](std::uint64_t) { deep.getAllWater(deepPick()); }));
+      add(measure(records, ("getWater" + suffix).c_str(), ops, [&](std::uint64_t) {
+        WaterRecord w;
+        deep.getWater(deepPick(), rng() % kDeepWaters, w);
+      }));
+      // 一個月：cold 只解日期範圍重疊的 block
+      add(measure(records, ("getWaterBetween" + suffix).c_str(), std::min<std::uint64_t>(ops, 2000),
+                  [&](std::uint64_t) { deep.getWaterBetween(deepPick(), june, june + 30LL * 86400000); }));
+    }
+    std::filesystem::remove(deepPath);
+  }
+
+  {
+    // 一個 request 的 JSON：一般 allocator vs. 每個 request reset 一次的 arena（server 的 RequestArena）
+    const std::vector<WaterRecord> list = backend.getAllWater(tokens[0]);
+    const std::string body = R"({"datetime":"2025-01-01T08:00:00Z","amountMl":250})";
+    util::Arena arena;
+    add(measure(records, "renderWatersJson", ops, [&](std::uint64_t) { renderWaters<json>(list); }));
+    add(measure(records, "renderWatersArena", ops, [&](std::uint64_t) {
+      util::ArenaScope scope(arena);
+      arena.reset();
+      renderWaters<ArenaJson>(list);
+    }));
+    add(measure(records, "parseWaterJson", ops, [&](std::uint64_t) { echoWater<json>(body); }));
+    add(measure(records, "parseWaterArena", ops, [&](std::uint64_t) {
+      util::ArenaScope scope(arena);
+      arena.reset();
+      echoWater<ArenaJson>(body);
+    }));
+  }
+
+  {
+    // activities 很多的 user 取最長的 10 筆：整串拿出來 partial_sort vs. backend 維護的 duration index
+    HealthBackend::Options rankOpts = opts;
+    rankOpts.storagePath = (dir / ("rank_" + std::to_string(records) + ".json")).string();
+    HealthBackend rank(rankOpts);
+    rank.registerUser("ranker", 30, 70.0, 1.75, passwords[0], "other");
+    const std::string token = rank.login("ranker", passwords[0]);
+    for (std::size_t i = 0; i < kRankActivities; ++i) {
+      rank.addActivity(token, dt(i), 1 + static_cast<int>(rng() % 240), "moderate");
+    }
+    rank.getActivitiesByDuration(token, 10);  // 第一次查詢會建 index，不算在裡面
+    add(measure(records, "topActivitySort", ops, [&](std::uint64_t) {
+      auto all = rank.getAllActivity(token);
+      std::partial_sort(all.begin(), all.begin() + 10, all.end(),
+                        [](const ActivityRecord& a, const ActivityRecord& b) { return a.minutes > b.minutes; });
+    }));
+    add(measure(records, "topActivityIndex", ops, [&](std::uint64_t) { rank.getActivitiesByDuration(token, 10); }));
+  }
+
+  {
+    // token → name 表本身，key 數 = records（--sizes 1000000 就是 1M 個 user）：
+    // 舊的 std::map 要先把 header 裡的 token 複製成 std::string 才能查；FlatHashMap 直接拿 string_view 查
+    std::mt19937_64 keyRng(7);
+    std::vector<std::string> headers;
+    headers.reserve(records);
+    std::map<std::string, std::string> tree;
+    util::FlatHashMap<std::string> flat;
+    flat.reserve(records);
+    for (std::size_t k = 0; k < records; ++k) {
+      char token[33];
+      std::snprintf(token, sizeof(token), "%016llx%016llx", static_cast<unsigned long long>(keyRng()),
+                    static_cast<unsigned long long>(keyRng()));
+      const std::string name = "user" + std::to_string(k);
+      tree.emplace(token, name);
+      flat.try_emplace(token, name);
+      headers.push_back(std::string("Bearer ") + token);
+    }
+    auto header = [&]() { return std::string_view(headers[rng() % records]).substr(7); };
+    std::size_t hits = 0;
+    add(measure(records, "tokenFindMap", ops, [&](std::uint64_t) { hits += tree.count(std::string(header())); }));
+    add(measure(records, "tokenFindFlat", ops, [&](std::uint64_t) { hits += flat.contains(header()); }));
+    if (hits != 2 * ops) std::cerr << "token lookup missed\n";
+  }
+
+  add(measure(records, "getUserByToken", ops, [&](std::uint64_t) { backend.hasUserForToken(tokens[rng() % users]); }));
+
+  add(measure(records, "getAllWater", ops, [&](std::uint64_t) { backend.getAllWater(tokens[rng() % users]); }));
+  add(measure(records, "getAllSleep", ops, [&](std::uint64_t) { backend.getAllSleep(tokens[rng() % users]); }));
+  add(measure(records, "getAllActivity", ops, [&](std::uint64_t) { backend.getAllActivity(tokens[rng() % users]); }));
+  add(measure(records, "getOtherRecords", ops,
+              [&](std::uint64_t) { backend.getOtherRecords(tokens[rng() % users], kCategory); }));
+
+  {
+    // 每週 activity minutes 排行榜：每次把所有 user 的 activities 掃一遍重算 vs. 跟著修改更新的 Leaderboard。
+    // 另外一個 backend，排行榜建好之後的修改成本（updateActivityRanked）不會混進上面 / 下面的 update*
+    HealthBackend::Options boardOpts = opts;
+    boardOpts.storagePath = (dir / ("board_" + std::to_string(records) + ".json")).string();
+    HealthBackend boards(boardOpts);
+    const std::vector<std::string> boardTokens = seed(boards, records);
+    std::int64_t atMs = 0;
+    util::parseDateTime(dt(2), atMs);
+    const std::int32_t week = Leaderboard::weekOf(atMs);
+    HealthBackend::Ranking ranking;
+    boards.getLeaderboard(boardTokens[0], HealthBackend::Board::ActivityMinutes, atMs, 10, ranking);  // 第一次查詢會建排行榜
+    add(measure(records, "leaderboardRecompute", std::min<std::uint64_t>(ops, 200), [&](std::uint64_t) {
+      std::vector<std::pair<std::int64_t, std::size_t>> scores;  // (-minutes, user)
+      for (std::size_t u = 0; u < users; ++u) {
+        std::int64_t total = 0;
+        for (const auto& a : boards.getAllActivity(boardTokens[u])) {
+          std::int64_t ms;
+          if (a.datetime.millis(ms) && Leaderboard::weekOf(ms) == week) total += a.minutes;
+        }
+        if (total > 0) scores.emplace_back(-total, u);
+      }
+      const std::size_t k = std::min<std::size_t>(10, scores.size());
+      std::partial_sort(scores.begin(), scores.begin() + static_cast<std::ptrdiff_t>(k), scores.end());
+    }));
+    add(measure(records, "leaderboardTop", ops, [&](std::uint64_t) {
+      boards.getLeaderboard(boardTokens[rng() % users], HealthBackend::Board::ActivityMinutes, atMs, 10, ranking);
+    }));
+    add(measure(records, "updateActivityRanked", ops, [&](std::uint64_t i) {
+      boards.updateActivity(boardTokens[rng() % users], rng() % (kRecordsPerUser / 4), dt(i), 20, "low");
+    }));
+  }
+
+  // update / delete 都挑該 user 現有範圍內的隨機 index
+  add(measure(records, "updateWater", ops, [&](std::uint64_t i) {
+    backend.updateWater(tokens[rng() % users], rng() % (kRecordsPerUser / 4), dt(i), 100.0);
+  }));
+  add(measure(records, "updateSleep", ops, [&](std::uint64_t i) {
+    backend.updateSleep(tokens[rng() % users], rng() % (kRecordsPerUser / 4), dt(i), 8.0);
+  }));
+  add(measure(records, "updateActivity", ops, [&](std::uint64_t i) {
+    backend.updateActivity(tokens[rng() % users], rng() % (kRecordsPerUser / 4), dt(i), 20, "low");
+  }));
+  add(measure(records, "updateOtherRecord", ops, [&](std::uint64_t i) {
+    backend.updateOtherRecord(tokens[rng() % users], kCategory, rng() % (kRecordsPerUser / 4), dt(i), 3.0,
+                              "meh");
+  }));
+
+  add(measure(records, "addWater", ops, [&](std::uint64_t i) { backend.addWater(pick(), dt(i), 300.0); }));
+  add(measure(records, "addSleep", ops, [&](std::uint64_t i) { backend.addSleep(pick(), dt(i), 6.0); }));
+  add(measure(records, "addActivity", ops,
+              [&](std::uint64_t i) { backend.addActivity(pick(), dt(i), 45, "high"); }));
+  add(measure(records, "addOtherRecord", ops,
+              [&](std::uint64_t i) { backend.addOtherRecord(pick(), kCategory, dt(i), 2.0, "fine"); }));
+
+  add(measure(records, "deleteWater", ops,
+              [&](std::uint64_t) { backend.deleteWater(tokens[rng() % users], rng() % (kRecordsPerUser / 4)); }));
+  add(measure(records, "deleteSleep", ops,
+              [&](std::uint64_t) { backend.deleteSleep(tokens[rng() % users], rng() % (kRecordsPerUser / 4)); }));
+  add(measure(records, "deleteActivity", ops,
+              [&](std::uint64_t) { backend.deleteActivity(tokens[rng() % users], rng() % (kRecordsPerUser / 4)); }));
+  add(measure(records, "deleteOtherRecord", ops, [&](std::uint64_t) {
+    backend.deleteOtherRecord(tokens[rng() % users], kCategory, rng() % (kRecordsPerUser / 4));
+  }));
+
+  add(measure(records, "registerUser", ops, [&](std::uint64_t i) {
+    backend.registerUser(newNames[i], 30, 70.0, 1.75, passwords[0], "other");
+  }));
+  add(measure(records, "login", loginOps, [&](std::uint64_t) {
+    const std::size_t u = rng() % users;
+    backend.login(names[u], passwords[u]);
+  }));
+
+  std::filesystem::remove(path);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::size_t> sizes = {1000, 10000, 100000, 1000000};
+  std::uint64_t ops = 20000;
+  bool asJson = false;
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "health_bench";
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0) {
+      asJson = true;
+    } else if (std::strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+      sizes = parseSizes(argv[++i]);
+    } else if (std::strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+      ops = std::max<std::uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+      dir = argv[++i];
+    } else {
+      std::cerr << "usage: backend_bench [--sizes 1000,10000,...] [--ops N] [--dir tmpdir] [--json]\n";
+      return 2;
+    }
+  }
+  std::filesystem::create_directories(dir);
+
+  // backend 的 INFO log 會吃掉大部分時間，只留 ERROR（也不寫檔）
+  util::Logger::init("", util::LogLevel::Error);
+
+  std::vector<Result> results;
+  for (std::size_t n : sizes) {
+    if (!asJson) std::cerr << "running " << n << " records...\n";
+    runSize(n, ops, dir, results);
+  }
+
+  if (asJson) {
+    json out;
+    out["benchmarks"] = json::array();
+    for (const auto& r : results) {
+      json j;
+      j["records"] = r.records;
+      j["op"] = r.op;
+      j["ops"] = r.ops;
+      j["ns_per_op"] = r.nsPerOp;
+      j["allocs_per_op"] = r.allocsPerOp;
+      out["benchmarks"].push_back(std::move(j));
+    }
+    std::cout << out.dump(2) << "\n";
+  } else {
+    std::printf("%10s  %-18s %10s %14s %14s\n", "records", "op", "ops", "ns/op", "allocs/op");
+    for (const auto& r : results) {
+      std::printf("%10zu  %-18s %10llu %14.1f %14.2f\n", r.records, r.op.c_str(),
+                  static_cast<unsigned long long>(r.ops), r.nsPerOp, r.allocsPerOp);
+    }
+  }
+
+  util::Logger::shutdown();
+  return 0;
+}
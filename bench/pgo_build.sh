@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+# bench/pgo_build.sh — PGO build：instrumented build → loadgen 訓練 → 用 profile 重編
+#
+#   bench/pgo_build.sh [BUILD_DIR]          -> 預設 ./build-pgo，完成後 BUILD_DIR/server_app 就是最佳化版本
+#
+# 可調：TRAIN_SECONDS（每個 workload 跑幾秒）、TRAIN_USERS / TRAIN_RECORDS（預載的 dataset 大小）、
+#       PORT（server 固定 listen 8080）、CMAKE_ARGS（額外的 cmake 參數）
+#
+# 兩個階段要用同一個 build 目錄：gcc 的 profile 檔名是照 object 路徑取的，換目錄就對不上。
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD="${1:-$ROOT/build-pgo}"
+mkdir -p "$BUILD"
+BUILD="$(cd "$BUILD" && pwd)"
+PROFILE_DIR="$BUILD/pgo-profile"
+TRAIN_SECONDS="${TRAIN_SECONDS:-20}"
+TRAIN_USERS="${TRAIN_USERS:-2000}"
+TRAIN_RECORDS="${TRAIN_RECORDS:-50}"
+PORT="${PORT:-8080}"
+JOBS="$(nproc 2>/dev/null || echo 4)"
+
+configure() {
+  # shellcheck disable=SC2086
+  cmake -S "$ROOT" -B "$BUILD" -DCMAKE_BUILD_TYPE=Release -DHB_PGO="$1" -DHB_PGO_DIR="$PROFILE_DIR" ${CMAKE_ARGS:-}
+}
+
+echo "== [1/3] instrumented build"
+rm -rf "$PROFILE_DIR"
+configure GENERATE
+cmake --build "$BUILD" -j"$JOBS" --target server_app loadgen gen_dataset
+
+WORK="$(mktemp -d)"
+SERVER_PID=""
+cleanup() {
+  if [ -n "$SERVER_PID" ]; then
+    kill -TERM "$SERVER_PID" 2>/dev/null || true
+    wait "$SERVER_PID" 2>/dev/null || true
+  fi
+  rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+echo "== [2/3] training: $TRAIN_USERS users x $TRAIN_RECORDS records, ${TRAIN_SECONDS}s per workload"
+mkdir -p "$WORK/data"
+"$BUILD/gen_dataset" --users "$TRAIN_USERS" --records "$TRAIN_RECORDS" -o "$WORK/data/storage.json"
+
+# 啟動時會載入上面的 dataset，loadFromFile 也一起被訓練到
+(cd "$WORK" && LOG_LEVEL=ERROR exec "$BUILD/server_app" > server.out 2>&1) &
+SERVER_PID=$!
+for _ in $(seq 1 300); do
+  if curl -sf "http://127.0.0.1:$PORT/health" > /dev/null 2>&1; then break; fi
+  if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+    echo "server_app exited early:" >&2
+    cat "$WORK/server.out" >&2 || true
+    exit 2
+  fi
+  sleep 0.1
+done
+
+# 預設 mix（跟 bench/run_perf.sh 一樣），再加一段讀多寫少的
+"$BUILD/loadgen" --port "$PORT" -c 8 -d "$TRAIN_SECONDS"
+"$BUILD/loadgen" --port "$PORT" -c 8 -d "$TRAIN_SECONDS" --mix login=1,profile=4,add=2,list=10,category=3
+
+# SIGTERM → listen() 返回、正常 exit，profile 才會寫出來
+kill -TERM "$SERVER_PID"
+wait "$SERVER_PID" 2>/dev/null || true
+SERVER_PID=""
+
+if compgen -G "$PROFILE_DIR/*.profraw" > /dev/null; then
+  llvm-profdata merge -output="$PROFILE_DIR/default.profdata" "$PROFILE_DIR"/*.profraw
+fi
+
+echo "== [3/3] optimized build using $PROFILE_DIR"
+configure USE
+cmake --build "$BUILD" -j"$JOBS"
+
+echo "PGO build ready: $BUILD/server_app"
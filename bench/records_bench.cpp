@@ -0,0 +1,272 @@
+// bench/records_bench.cpp
+// helpers/SortedVector.hpp 和 records/ 的 managers（server 沒有 link 它們，所以另外一個 driver）
+//
+//   records_bench --check        -> 只跑正確性檢查（ctest 用），有錯回傳 1
+//   records_bench [--n 5000]     -> 檢查完再量：維持排序 vs. 每次整個 std::sort（改版前 managers 的做法）
+//
+// 檢查是跟參考答案比：一樣大的 key 照加入的先後（stable_sort 的結果），
+// 包含很多重複的 key、移到最前面 / 最後面、空的 vector。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../helpers/SortedVector.hpp"
+#include "../records/Water.hpp"
+
+namespace {
+
+struct Item {
+  int key = 0;
+  int seq = 0;  // 第幾個加進來的，用來看一樣大的 key 順序對不對
+
+  bool operator==(const Item& o) const { return key == o.key && seq == o.seq; }
+};
+
+bool byKey(const Item& a, const Item& b) { return a.key < b.key; }
+
+int g_failures = 0;
+
+void expect(bool ok, const char* what, int round) {
+  if (ok) return;
+  if (++g_failures <= 10) std::cerr << "FAIL " << what << " (round " << round << ")\n";
+}
+
+// 參考答案：把 value 放在所有不比它大的後面
+void referenceInsert(std::vector<Item>& vec, const Item& value) {
+  vec.insert(std::upper_bound(vec.begin(), vec.end(), value, byKey), value);
+}
+
+std::size_t positionOf(const std::vector<Item>& vec, int seq) {
+  for (std::size_t i = 0; i < vec.size(); ++i) {
+    if (vec[i].seq == seq) return i;
+  }
+  return vec.size();
+}
+
+void checkInsertSorted(std::mt19937& rng) {
+  // 固定的邊界情況：空的、比全部小、跟最後一筆一樣、跟第一筆一樣
+  {
+    std::vector<Item> vec;
+    expect(util::insertSorted(vec, Item{5, 0}, byKey) == 0, "insertSorted into empty", 0);
+    expect(util::insertSorted(vec, Item{5, 1}, byKey) == 1, "insertSorted equal to back goes after it", 0);
+    expect(util::insertSorted(vec, Item{1, 2}, byKey) == 0, "insertSorted smaller than all goes first", 0);
+    expect(util::insertSorted(vec, Item{1, 3}, byKey) == 1, "insertSorted equal to front goes after it", 0);
+    expect(util::insertSorted(vec, Item{9, 4}, byKey) == 4, "insertSorted larger than all goes last", 0);
+    expect(util::insertSorted(vec, Item{5, 5}, byKey) == 4, "insertSorted among equals goes after them", 0);
+    const std::vector<Item> want = {{1, 2}, {1, 3}, {5, 0}, {5, 1}, {5, 5}, {9, 4}};
+    expect(vec == want, "insertSorted fixed sequence", 0);
+  }
+  for (int round = 1; round <= 200; ++round) {
+    std::vector<Item> vec, ref;
+    const int keys = 1 + static_cast<int>(rng() % 20);  // key 少 → 很多重複
+    for (int seq = 0; seq < 200; ++seq) {
+      const Item value{static_cast<int>(rng() % keys), seq};
+      const std::size_t pos = util::insertSorted(vec, value, byKey);
+      referenceInsert(ref, value);
+      expect(pos < vec.size() && vec[pos] == value, "insertSorted returns the new position", round);
+    }
+    expect(vec == ref, "insertSorted matches stable order", round);
+  }
+}
+
+void checkRepositionSorted(std::mt19937& rng) {
+  for (int round = 1; round <= 2000; ++round) {
+    const int keys = 1 + static_cast<int>(rng() % 10);
+    std::vector<Item> vec;
+    const std::size_t n = 1 + rng() % 40;
+    for (std::size_t i = 0; i < n; ++i) vec.push_back(Item{static_cast<int>(rng() % keys), static_cast<int>(i)});
+    std::stable_sort(vec.begin(), vec.end(), byKey);
+
+    const std::size_t index = rng() % n;
+    int newKey;
+    switch (round % 4) {
+      case 0: newKey = -1; break;    // 移到最前面
+      case 1: newKey = keys; break;  // 移到最後面
+      default: newKey = static_cast<int>(rng() % keys); break;  // 常常跟別人一樣大
+    }
+    Item changed = vec[index];
+    changed.key = newKey;
+
+    // 參考答案：還在該在的位置就不動；不然拿出來再照 upper_bound 放回去
+    std::vector<Item> ref = vec;
+    ref[index] = changed;
+    if (!std::is_sorted(ref.begin(), ref.end(), byKey)) {
+      ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(index));
+      referenceInsert(ref, changed);
+    }
+
+    vec[index] = changed;
+    const std::size_t pos = util::repositionSorted(vec, index, byKey);
+    expect(vec == ref, "repositionSorted matches reference", round);
+    expect(pos == positionOf(vec, changed.seq), "repositionSorted returns the new position", round);
+    if (round % 4 == 0) expect(pos == 0, "repositionSorted moves the smallest to the front", round);
+    if (round % 4 == 1) expect(pos == n - 1, "repositionSorted moves the largest to the back", round);
+  }
+}
+
+void checkAppendSorted(std::mt19937& rng) {
+  for (int round = 1; round <= 500; ++round) {
+    const int keys = 1 + static_cast<int>(rng() % 15);
+    int seq = 0;
+    std::vector<Item> vec;
+    if (round % 5 != 0) {  // 每五輪一次從空的開始
+      for (std::size_t i = rng() % 50; i > 0; --i) vec.push_back(Item{static_cast<int>(rng() % keys), seq++});
+      std::stable_sort(vec.begin(), vec.end(), byKey);
+    }
+    std::vector<Item> more;
+    for (std::size_t i = rng() % 50; i > 0; --i) more.push_back(Item{static_cast<int>(rng() % keys), seq++});
+    if (round % 3 == 0) std::stable_sort(more.begin(), more.end(), byKey);  // 已經排好的那條路
+
+    // 參考答案：原本的在前、這批在後，整個 stable_sort
+    std::vector<Item> ref = vec;
+    ref.insert(ref.end(), more.begin(), more.end());
+    std::stable_sort(ref.begin(), ref.end(), byKey);
+
+    util::appendSorted(vec, more, byKey);
+    expect(vec == ref, "appendSorted matches stable order", round);
+  }
+}
+
+// WaterManager 整個走一遍：加、批次加、改到最前 / 最後、刪，getAll 一直是照日期排、同一天照加入的先後
+void checkWaterManager() {
+  records::WaterManager m;
+  m.addRecord("u", "2025-01-03", 3);
+  m.addRecord("u", "2025-01-01", 1);
+  m.addRecord("u", "2025-01-03", 4);
+  m.addRecords("u", {{"2025-01-02", 2}, {"2025-01-01", 0.5}});
+  auto all = m.getAll("u");
+  const std::vector<double> want = {1, 0.5, 2, 3, 4};
+  bool ok = all.size() == want.size();
+  for (std::size_t i = 0; ok && i < all.size(); ++i) ok = all[i].amountMl == want[i];
+  expect(ok, "WaterManager add / addRecords order", 0);
+
+  m.updateRecord("u", 0, "2025-01-09", 1);  // 最前面移到最後面
+  m.updateRecord("u", 3, "2024-12-31", 4);  // 最後面那天的第二筆（4）移到最前面
+  all = m.getAll("u");
+  const std::vector<double> moved = {4, 0.5, 2, 3, 1};
+  ok = all.size() == moved.size();
+  for (std::size_t i = 0; ok && i < all.size(); ++i) ok = all[i].amountMl == moved[i];
+  expect(ok, "WaterManager updateRecord moves to either end", 0);
+
+  m.deleteRecord("u", 0);
+  all = m.getAll("u");
+  expect(all.size() == 4 && all.front().date == "2025-01-01", "WaterManager deleteRecord", 0);
+}
+
+// ===== 計時：改版前每次 add / update 都整個 std::sort =====
+
+class ResortingWater {
+ public:
+  void add(const std::string& date, double ml) {
+    vec_.push_back(records::WaterRecord{date, ml});
+    sort();
+  }
+  void update(std::size_t index, const std::string& date, double ml) {
+    vec_[index] = records::WaterRecord{date, ml};
+    sort();
+  }
+
+ private:
+  void sort() {
+    std::sort(vec_.begin(), vec_.end(),
+              [](const records::WaterRecord& a, const records::WaterRecord& b) { return a.date < b.date; });
+  }
+  std::vector<records::WaterRecord> vec_;
+};
+
+std::string dateOf(std::size_t day) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "%04zu-%02zu-%02zu", 2000 + day / 336, 1 + day / 28 % 12, 1 + day % 28);
+  return buf;
+}
+
+template <typename F>
+double millis(F&& f) {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void runTimings(std::size_t n) {
+  std::mt19937 rng(7);
+  std::vector<std::string> inOrder, shuffled;
+  for (std::size_t i = 0; i < n; ++i) inOrder.push_back(dateOf(i));
+  shuffled = inOrder;
+  std::shuffle(shuffled.begin(), shuffled.end(), rng);
+  const std::size_t updates = n / 10;
+  std::vector<std::pair<std::size_t, std::string>> edits;
+  for (std::size_t i = 0; i < updates; ++i) edits.emplace_back(rng() % n, dateOf(rng() % n));
+
+  std::printf("%-22s %10s %14s %14s\n", "op", "n", "resort ms", "sorted ms");
+  auto row = [](const char* op, std::size_t count, double before, double after) {
+    std::printf("%-22s %10zu %14.2f %14.2f\n", op, count, before, after);
+  };
+
+  for (const auto* dates : {&inOrder, &shuffled}) {
+    ResortingWater old;
+    records::WaterManager now;
+    const double before = millis([&] {
+      for (const auto& d : *dates) old.add(d, 250);
+    });
+    const double after = millis([&] {
+      for (const auto& d : *dates) now.addRecord("u", d, 250);
+    });
+    row(dates == &inOrder ? "addRecord in order" : "addRecord random", n, before, after);
+    if (dates != &shuffled) continue;
+
+    const double updBefore = millis([&] {
+      for (const auto& [i, d] : edits) old.update(i, d, 300);
+    });
+    const double updAfter = millis([&] {
+      for (const auto& [i, d] : edits) now.updateRecord("u", i, d, 300);
+    });
+    row("updateRecord", updates, updBefore, updAfter);
+  }
+
+  std::vector<records::WaterRecord> batch;
+  for (const auto& d : shuffled) batch.push_back(records::WaterRecord{d, 250});
+  ResortingWater old;
+  records::WaterManager now;
+  const double before = millis([&] {
+    for (const auto& r : batch) old.add(r.date, r.amountMl);
+  });
+  const double after = millis([&] { now.addRecords("u", batch); });
+  row("addRecords (one batch)", n, before, after);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool checkOnly = false;
+  std::size_t n = 5000;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--check") == 0) {
+      checkOnly = true;
+    } else if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      n = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      std::cerr << "usage: records_bench [--check] [--n records]\n";
+      return 2;
+    }
+  }
+
+  std::mt19937 rng(42);
+  checkInsertSorted(rng);
+  checkRepositionSorted(rng);
+  checkAppendSorted(rng);
+  checkWaterManager();
+  if (g_failures > 0) {
+    std::cerr << g_failures << " check(s) failed\n";
+    return 1;
+  }
+  std::cout << "SortedVector / WaterManager checks passed\n";
+  if (!checkOnly && n > 0) runTimings(n);
+  return 0;
+}
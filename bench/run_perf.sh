@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+# bench/run_perf.sh — 跑 backend_bench + loadgen，跟 bench/baseline.json 比較
+#
+#   bench/run_perf.sh [BIN_DIR] [BASELINE]                   -> 退步超過門檻 exit 1
+#   WRITE_BASELINE=1 bench/run_perf.sh [BIN_DIR] [BASELINE]  -> 用這次的結果覆蓋 baseline
+#
+# BIN_DIR 要有 server_app、backend_bench、loadgen、perf_compare（預設 ./build）
+# 可調：BENCH_SIZES、BENCH_RUNS（backend_bench 跑幾次取最快）、HTTP_DURATION、HTTP_CONNECTIONS、PORT（server 固定 listen 8080）
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BIN_DIR="$(cd "${1:-$ROOT/build}" && pwd)"
+BASELINE="${2:-$ROOT/bench/baseline.json}"
+BENCH_SIZES="${BENCH_SIZES:-1000,10000,100000}"
+BENCH_RUNS="${BENCH_RUNS:-5}"
+HTTP_DURATION="${HTTP_DURATION:-15}"
+HTTP_CONNECTIONS="${HTTP_CONNECTIONS:-8}"
+PORT="${PORT:-8080}"
+
+for exe in server_app backend_bench loadgen perf_compare; do
+  if [ ! -x "$BIN_DIR/$exe" ]; then
+    echo "missing $BIN_DIR/$exe" >&2
+    exit 2
+  fi
+done
+
+WORK="$(mktemp -d)"
+SERVER_PID=""
+cleanup() {
+  if [ -n "$SERVER_PID" ]; then
+    kill -TERM "$SERVER_PID" 2>/dev/null || true
+    wait "$SERVER_PID" 2>/dev/null || true
+  fi
+  rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+echo "== backend_bench (sizes $BENCH_SIZES, best of $BENCH_RUNS)"
+BACKEND_ARGS=()
+for run in $(seq 1 "$BENCH_RUNS"); do
+  "$BIN_DIR/backend_bench" --sizes "$BENCH_SIZES" --dir "$WORK/bench" --json > "$WORK/backend.$run.json"
+  BACKEND_ARGS+=(--backend "$WORK/backend.$run.json")
+done
+
+echo "== server_app + loadgen (${HTTP_DURATION}s, $HTTP_CONNECTIONS connections)"
+mkdir -p "$WORK/server"
+(cd "$WORK/server" && LOG_LEVEL=ERROR exec "$BIN_DIR/server_app" > server.out 2>&1) &
+SERVER_PID=$!
+
+for _ in $(seq 1 100); do
+  if curl -sf "http://127.0.0.1:$PORT/health" > /dev/null 2>&1; then break; fi
+  if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+    echo "server_app exited early:" >&2
+    cat "$WORK/server/server.out" >&2 || true
+    exit 2
+  fi
+  sleep 0.1
+done
+
+"$BIN_DIR/loadgen" --port "$PORT" -d "$HTTP_DURATION" -c "$HTTP_CONNECTIONS" --json > "$WORK/http.json"
+
+kill -TERM "$SERVER_PID"
+wait "$SERVER_PID" 2>/dev/null || true
+SERVER_PID=""
+
+echo "== compare against $BASELINE"
+ARGS=(--baseline "$BASELINE" "${BACKEND_ARGS[@]}" --http "$WORK/http.json")
+if [ "${WRITE_BASELINE:-0}" = "1" ]; then ARGS+=(--write-baseline); fi
+status=0
+"$BIN_DIR/perf_compare" "${ARGS[@]}" || status=$?
+exit $status
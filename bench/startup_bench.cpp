@@ -0,0 +1,300 @@
+// bench/startup_bench.cpp
+// 啟動時間 benchmark：用 gen_dataset 產生指定大小的 storage.json，量 HealthBackend 載入要多久、吃多少記憶體
+//
+//   startup_bench                                  -> 100MB / 1GB，streaming loader 1 thread 與全部 core，
+//                                                     再加同一份資料的 binary snapshot（mmap + lazy）與 per-user 目錄
+//   startup_bench --mb 50,200 --threads 1,2,4 --formats json,per-user --json
+//   startup_bench --mb 100 --dom-max-mb 100        -> 另外量舊的「整份 parse 成 DOM」當對照
+//   startup_bench --mb 100 --budget-mb 16          -> per-user 另外量設了 memory budget（records 用到才讀）的情況
+//
+// 每次量測都 fork 一個子行程，peak RSS（getrusage）才不會被前一次量測墊高。
+// 量之前先把檔案讀過一遍，所以量到的是 page cache 熱的情況（磁碟速度另外算）。
+// peak RSS 包含 mmap 進來、已經讀過的檔案頁（可回收的 page cache），DOM 模式則是 heap 上的 DOM。
+
+#include <sys/resource.h>  // getrusage
+#include <sys/wait.h>      // waitpid
+#include <unistd.h>        // fork, pipe, readlink
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../backend/HealthBackend.hpp"
+#include "../external/json.hpp"
+#include "../helpers/Logger.hpp"
+
+using json = nlohmann::ordered_json;
+
+namespace {
+
+// gen_dataset 每筆 record 大約 62 bytes（compact JSON），每個 user 100 筆
+constexpr std::size_t kRecordsPerUser = 100;
+constexpr double kBytesPerUser = 6300.0;
+
+struct Result {
+  std::size_t targetMb = 0;
+  std::uint64_t bytes = 0;
+  std::string mode;  // "dom" / "stream" / "snap" / "per-user"
+  unsigned threads = 0;
+  std::uint64_t users = 0;
+  double ms = 0.0;
+  double peakRssMb = 0.0;
+  bool ok = false;
+};
+
+std::vector<std::size_t> parseList(const std::string& s) {
+  std::vector<std::size_t> out;
+  std::size_t pos = 0;
+  while (pos < s.size()) {
+    const std::size_t comma = s.find(',', pos);
+    const std::string item = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+    if (!item.empty()) out.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    if (comma == std::string::npos) break;
+    pos = comma + 1;
+  }
+  return out;
+}
+
+std::string selfDir() {
+  char buf[4096] = {0};
+  const ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+  if (len <= 0) return ".";
+  return std::filesystem::path(std::string(buf, static_cast<std::size_t>(len))).parent_path().string();
+}
+
+// 讀過一遍放進 page cache
+void warmCache(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::vector<char> buf(1 << 20);
+  while (in.read(buf.data(), static_cast<std::streamsize>(buf.size())) || in.gcount() > 0) {
+  }
+}
+
+// 舊的載入方式：整份 parse 成 nlohmann DOM（不含之後轉成 UserData 的時間，所以是下限）
+std::uint64_t loadDom(const std::filesystem::path& path) {
+  std::ifstream in(path);
+  nlohmann::json j;
+  in >> j;
+  return j.contains("users") ? j["users"].size() : 0;
+}
+
+// storage.json 走 streaming loader，.snap 走 mmap，目錄走 per-user（HealthBackend 自己判斷）
+std::uint64_t loadStream(const std::filesystem::path& path, unsigned threads, std::size_t memoryBudget) {
+  HealthBackend::Options opts;
+  opts.storagePath = path.string();
+  opts.autoSave = false;
+  opts.loadThreads = threads;
+  opts.memoryBudget = memoryBudget;
+  if (memoryBudget > 0) opts.format = HealthBackend::StorageFormat::PerUser;  // JSON 格式會忽略 budget
+  auto* backend = new HealthBackend(opts);  // 故意不 delete：子行程直接 _exit，不量釋放的時間
+  return backend->getStats().users;
+}
+
+// 在子行程裡跑一次載入，結果從 pipe 傳回來
+bool measure(const std::filesystem::path& path, const std::string& mode, unsigned threads, std::size_t budgetMb,
+             Result& r) {
+  int fds[2];
+  if (pipe(fds) != 0) return false;
+  const pid_t pid = fork();
+  if (pid < 0) return false;
+
+  if (pid == 0) {
+    close(fds[0]);
+    util::Logger::init("", util::LogLevel::Error);
+    const auto start = std::chrono::steady_clock::now();
+    const std::uint64_t users = mode == "dom" ? loadDom(path) : loadStream(path, threads, budgetMb << 20);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    struct rusage ru {};
+    getrusage(RUSAGE_SELF, &ru);
+    char line[128];
+    const int n = std::snprintf(line, sizeof(line), "%llu %.3f %ld\n", static_cast<unsigned long long>(users), ms,
+                                static_cast<long>(ru.ru_maxrss));
+    if (write(fds[1], line, static_cast<std::size_t>(n)) != n) _exit(1);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  char buf[128] = {0};
+  std::size_t got = 0;
+  ssize_t n;
+  while (got < sizeof(buf) - 1 && (n = read(fds[0], buf + got, sizeof(buf) - 1 - got)) > 0) got += static_cast<std::size_t>(n);
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+
+  r.mode = mode;
+  r.threads = threads;
+  unsigned long long users = 0;
+  long rssKb = 0;
+  double ms = 0.0;
+  r.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && std::sscanf(buf, "%llu %lf %ld", &users, &ms, &rssKb) == 3;
+  if (!r.ok && WIFSIGNALED(status)) {
+    std::cerr << "  " << mode << " killed by signal " << WTERMSIG(status) << " (out of memory?)\n";
+  }
+  r.users = users;
+  r.ms = ms;
+  r.peakRssMb = static_cast<double>(rssKb) / 1024.0;
+  return r.ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::size_t> sizesMb = {100, 1000};
+  const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::size_t> threadCounts = {1, hw};
+  std::size_t domMaxMb = 0;
+  std::size_t budgetMb = 0;
+  bool asJson = false;
+  bool keep = false;
+  std::vector<std::string> formats = {"json", "binary", "per-user"};
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "health_startup_bench";
+  std::string gen = selfDir() + "/gen_dataset";
+  const std::string convert = selfDir() + "/snapshot_convert";
+  auto wants = [&](const char* f) { return std::find(formats.begin(), formats.end(), f) != formats.end(); };
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0) {
+      asJson = true;
+    } else if (std::strcmp(argv[i], "--keep") == 0) {
+      keep = true;
+    } else if (std::strcmp(argv[i], "--formats") == 0 && i + 1 < argc) {
+      formats.clear();
+      for (const char* p = argv[++i]; *p;) {
+        const char* comma = std::strchr(p, ',');
+        const std::size_t n = comma ? static_cast<std::size_t>(comma - p) : std::strlen(p);
+        if (n > 0) formats.emplace_back(p, n);
+        p += comma ? n + 1 : n;
+      }
+    } else if (std::strcmp(argv[i], "--mb") == 0 && i + 1 < argc) {
+      sizesMb = parseList(argv[++i]);
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threadCounts = parseList(argv[++i]);
+    } else if (std::strcmp(argv[i], "--dom-max-mb") == 0 && i + 1 < argc) {
+      domMaxMb = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--budget-mb") == 0 && i + 1 < argc) {
+      budgetMb = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+      dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--gen") == 0 && i + 1 < argc) {
+      gen = argv[++i];
+    } else {
+      std::cerr << "usage: startup_bench [--mb 100,1000] [--threads 1,N] [--dom-max-mb MB] [--dir tmpdir]\n"
+                   "                     [--gen path/to/gen_dataset] [--budget-mb MB]\n"
+                   "                     [--formats json,binary,per-user] [--keep] [--json]\n";
+      return 2;
+    }
+  }
+  std::filesystem::create_directories(dir);
+
+  // 重複產生 1GB 很慢：同樣大小的檔案已經在就直接用（--keep 時留下來給下次）
+  std::vector<Result> results;
+  for (std::size_t mb : sizesMb) {
+    const auto users = static_cast<std::size_t>(static_cast<double>(mb) * 1024.0 * 1024.0 / kBytesPerUser);
+    auto generate = [&](const std::filesystem::path& path, const char* format) {
+      if (std::filesystem::exists(path)) return true;
+      const std::string cmd = "\"" + gen + "\" --users " + std::to_string(users) + " --records " +
+                              std::to_string(kRecordsPerUser) + " --format " + format + " -o \"" + path.string() +
+                              "\" > /dev/null";
+      if (!asJson) std::cerr << "generating " << mb << " MB " << format << " (" << users << " users)...\n";
+      if (std::system(cmd.c_str()) != 0) {
+        std::cerr << "gen_dataset failed (use --gen to point at it): " << cmd << "\n";
+        return false;
+      }
+      return true;
+    };
+    auto run = [&](const std::filesystem::path& path, const std::string& mode, unsigned threads,
+                   std::size_t budget = 0) {
+      if (!asJson) std::cerr << "  " << mb << " MB " << mode << " x" << threads << "...\n";
+      Result r;
+      r.targetMb = mb;
+      r.bytes = 0;
+      if (std::filesystem::is_directory(path)) {
+        for (const auto& f : std::filesystem::recursive_directory_iterator(path)) {
+          if (f.is_regular_file()) r.bytes += f.file_size();
+        }
+      } else {
+        r.bytes = std::filesystem::file_size(path);
+      }
+      measure(path, mode, threads, budget, r);
+      results.push_back(r);
+    };
+
+    const std::filesystem::path path = dir / ("storage_" + std::to_string(mb) + "mb.json");
+    if (wants("json") || wants("per-user")) {
+      if (!generate(path, "json")) return 1;
+      warmCache(path);
+    }
+    if (wants("json")) {
+      if (mb <= domMaxMb) run(path, "dom", 1);
+      for (std::size_t t : threadCounts) run(path, "stream", static_cast<unsigned>(t));
+    }
+
+    // 同一份資料拆成 per-user 目錄（用 snapshot_convert，不在這個行程裡載入，免得 fork 出去的子行程 RSS 被墊高）
+    if (wants("per-user")) {
+      const std::filesystem::path usersDir = dir / ("users_" + std::to_string(mb) + "mb");
+      if (!std::filesystem::exists(usersDir)) {
+        if (!asJson) std::cerr << "converting " << mb << " MB to per-user files...\n";
+        const std::string cmd = "\"" + convert + "\" --to per-user \"" + path.string() + "\" \"" +
+                                usersDir.string() + "\" 2> /dev/null";
+        if (std::system(cmd.c_str()) != 0) {
+          std::cerr << "snapshot_convert failed: " << cmd << "\n";
+          return 1;
+        }
+      }
+      for (std::size_t t : threadCounts) run(usersDir, "per-user", static_cast<unsigned>(t));
+      if (budgetMb > 0) run(usersDir, "budget", hw, budgetMb);
+      if (!keep) std::filesystem::remove_all(usersDir);
+    }
+    if (!keep) std::filesystem::remove(path);
+
+    // 同樣的 users / records 寫成 snapshot；file MB 欄位是 snapshot 本身的大小
+    if (wants("binary")) {
+      const std::filesystem::path snapPath = dir / ("storage_" + std::to_string(mb) + "mb.snap");
+      if (!generate(snapPath, "binary")) return 1;
+      warmCache(snapPath);
+      run(snapPath, "snap", 1);
+      if (!keep) std::filesystem::remove(snapPath);
+    }
+  }
+
+  if (asJson) {
+    json out;
+    out["benchmarks"] = json::array();
+    for (const auto& r : results) {
+      json j;
+      j["target_mb"] = r.targetMb;
+      j["bytes"] = r.bytes;
+      j["mode"] = r.mode;
+      j["threads"] = r.threads;
+      j["ok"] = r.ok;
+      j["users"] = r.users;
+      j["ms"] = r.ms;
+      j["peak_rss_mb"] = r.peakRssMb;
+      out["benchmarks"].push_back(std::move(j));
+    }
+    std::cout << out.dump(2) << "\n";
+  } else {
+    std::printf("%10s  %-8s %8s %10s %12s %10s %14s\n", "file MB", "mode", "threads", "users", "ms", "MB/s",
+                "peak RSS MB");
+    for (const auto& r : results) {
+      const double fileMb = static_cast<double>(r.bytes) / (1024.0 * 1024.0);
+      if (!r.ok) {
+        std::printf("%10.1f  %-8s %8u %10s\n", fileMb, r.mode.c_str(), r.threads, "failed");
+        continue;
+      }
+      std::printf("%10.1f  %-8s %8u %10llu %12.1f %10.1f %14.1f\n", fileMb, r.mode.c_str(), r.threads,
+                  static_cast<unsigned long long>(r.users), r.ms, r.ms > 0 ? fileMb / (r.ms / 1000.0) : 0.0,
+                  r.peakRssMb);
+    }
+  }
+  return 0;
+}
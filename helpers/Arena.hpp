@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Per-request monotonic arena.
+//
+//   util::RequestArena::begin();   // pre-routing：這個 worker thread 的 arena 清空、掛上
+//   ... handler 裡的 JSON 用 util::ArenaAllocator 配置 ...
+//   util::RequestArena::end();     // post-routing：卸下，累計這個 request 的配置次數
+//
+// 一個 request 裡的 JSON（body 解析出來的 DOM、組回應的 object / array）是一堆活不過這個 request 的小塊，
+// 從 arena 拿只是往後推一個指標，deallocate 什麼都不做，下一個 request 開始時整塊收回。
+// 沒有掛 arena 的 thread（背景 thread、request 之外）ArenaAllocator 就是一般的 operator new。
+
+namespace util {
+
+class Arena {
+public:
+    explicit Arena(std::size_t firstChunk = 16 * 1024) : firstChunk_(firstChunk) {}
+    ~Arena() {
+        for (const auto &c : chunks_) std::free(c.data);
+    }
+
+    Arena(const Arena &)            = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(std::size_t n, std::size_t align) {
+        std::uintptr_t p = (cur_ + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+        if (cur_ == 0 || p + n > end_) p = grow(n, align);
+        cur_ = p + n;
+        ++allocations_;
+        return reinterpret_cast<void *>(p);
+    }
+
+    bool owns(const void *p) const {
+        const auto a = reinterpret_cast<std::uintptr_t>(p);
+        for (const auto &c : chunks_) {
+            const auto base = reinterpret_cast<std::uintptr_t>(c.data);
+            if (a >= base && a < base + c.size) return true;
+        }
+        return false;
+    }
+
+    // 全部收回。上一輪長到好幾個 chunk 的話換成一個一樣大的（最多 kMaxRetained），
+    // 同樣大小的 request 下次就只用一個 chunk
+    void reset() {
+        if (chunks_.size() > 1) {
+            std::size_t total = 0;
+            for (const auto &c : chunks_) {
+                total += c.size;
+                std::free(c.data);
+            }
+            chunks_.clear();
+            addChunk(total < kMaxRetained ? total : firstChunk_);
+        }
+        cur_         = chunks_.empty() ? 0 : reinterpret_cast<std::uintptr_t>(chunks_.front().data);
+        end_         = chunks_.empty() ? 0 : cur_ + chunks_.front().size;
+        allocations_ = 0;
+    }
+
+    // 上次 reset() 之後
+    std::size_t allocations() const { return allocations_; }
+    std::size_t capacity() const {
+        std::size_t total = 0;
+        for (const auto &c : chunks_) total += c.size;
+        return total;
+    }
+
+private:
+    static constexpr std::size_t kMaxRetained = 1024 * 1024;
+
+    struct Chunk {
+        char       *data;
+        std::size_t size;
+    };
+
+    std::uintptr_t grow(std::size_t n, std::size_t align) {
+        std::size_t size = chunks_.empty() ? firstChunk_ : chunks_.back().size * 2;
+        while (size < n + align) size *= 2;
+        addChunk(size);
+        return (cur_ + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+    }
+
+    void addChunk(std::size_t size) {
+        char *data = static_cast<char *>(std::malloc(size));
+        if (!data) throw std::bad_alloc();
+        chunks_.push_back(Chunk{data, size});
+        cur_ = reinterpret_cast<std::uintptr_t>(data);
+        end_ = cur_ + size;
+    }
+
+    std::size_t        firstChunk_;
+    std::vector<Chunk> chunks_;
+    std::uintptr_t     cur_         = 0;
+    std::uintptr_t     end_         = 0;
+    std::size_t        allocations_ = 0;
+};
+
+// 目前這個 thread 掛著的 arena（沒有就是 nullptr）
+inline Arena *&currentArena() {
+    static thread_local Arena *arena = nullptr;
+    return arena;
+}
+
+// 在 scope 內把 arena 掛到這個 thread 上（benchmark、測試用；server 走 RequestArena）
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena &arena) : prev_(currentArena()) { currentArena() = &arena; }
+    ~ArenaScope() { currentArena() = prev_; }
+
+    ArenaScope(const ArenaScope &)            = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+    Arena *prev_;
+};
+
+// Stateless allocator：有掛 arena 就從 arena 拿，否則 operator new。
+// 用它配置的東西不能活過 arena 的 reset()（RequestArena：不能活過 request）
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        if (Arena *arena = currentArena()) return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, std::size_t) noexcept {
+        if (Arena *arena = currentArena(); arena && arena->owns(p)) return;
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &) const noexcept {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &) const noexcept {
+        return false;
+    }
+};
+
+// Worker thread 各自一個 arena；pre-routing / post-routing hook 呼叫（兩個都在 request 的 worker thread 上跑）
+class RequestArena {
+public:
+    static void begin() {
+        Arena &arena = local();
+        arena.reset();
+        currentArena() = &arena;
+    }
+
+    static void end() {
+        if (currentArena() != &local()) return;
+        currentArena() = nullptr;
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        allocations_.fetch_add(local().allocations(), std::memory_order_relaxed);
+    }
+
+    // /metrics 用：所有 request 加總
+    static std::uint64_t requests() { return requests_.load(std::memory_order_relaxed); }
+    static std::uint64_t allocations() { return allocations_.load(std::memory_order_relaxed); }
+
+private:
+    static Arena &local() {
+        static thread_local Arena arena;
+        return arena;
+    }
+
+    static inline std::atomic<std::uint64_t> requests_{0};
+    static inline std::atomic<std::uint64_t> allocations_{0};
+};
+
+} // namespace util
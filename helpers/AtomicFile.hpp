@@ -0,0 +1,121 @@
+#pragma once
+
+#include <fcntl.h>      // open
+#include <sys/stat.h>   // stat
+#include <unistd.h>     // fsync, link, close
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace util {
+
+// 整份重寫的存檔用：先寫 <path>.tmp，commit() 時 fsync 後 rename 蓋過 path。
+// 中途失敗 / crash 時 path 還是舊的完整檔案；沒 commit 的暫存檔在 destructor 刪掉。
+//
+// commit(keep) 會順便把原本的 path 留成 <path>.1 … <path>.keep（數字越大越舊），
+// 載入端發現 path 壞掉時可以退回最近一份好的（見 HealthBackend::readStorage）。
+class AtomicFile {
+public:
+    AtomicFile() = default;
+    ~AtomicFile() { abort(); }
+    AtomicFile(const AtomicFile &)            = delete;
+    AtomicFile &operator=(const AtomicFile &) = delete;
+
+    static std::string backupPath(const std::string &path, unsigned n) { return path + "." + std::to_string(n); }
+
+    bool open(const std::string &path) {
+        abort();
+        error_.clear();
+        path_    = path;
+        tmpPath_ = path + ".tmp";
+        file_    = std::fopen(tmpPath_.c_str(), "wb");
+        if (!file_) return fail("open " + tmpPath_);
+        return true;
+    }
+
+    bool write(const void *data, std::size_t n) {
+        if (!file_) return false;
+        if (n > 0 && std::fwrite(data, 1, n, file_) != n) return fail("write " + tmpPath_);
+        return true;
+    }
+
+    // 回頭改已經寫過的位置（例如最後才知道內容的 header），寫完回到檔尾
+    bool writeAt(std::uint64_t offset, const void *data, std::size_t n) {
+        if (!file_) return false;
+        if (std::fseek(file_, static_cast<long>(offset), SEEK_SET) != 0) return fail("seek " + tmpPath_);
+        if (!write(data, n)) return false;
+        if (std::fseek(file_, 0, SEEK_END) != 0) return fail("seek " + tmpPath_);
+        return true;
+    }
+
+    // sync = false：不 fsync（大量檔案一次寫完、最後自己 sync() 的情況），其他步驟一樣
+    bool commit(unsigned keep = 0, bool sync = true) {
+        if (!file_) return false;
+        const bool synced = std::fflush(file_) == 0 && (!sync || ::fsync(fileno(file_)) == 0);
+        const int  saved  = errno;
+        const bool closed = std::fclose(file_) == 0;
+        file_             = nullptr;
+        if (!synced || !closed) {
+            if (!synced) errno = saved;
+            fail("flush " + tmpPath_);
+            std::remove(tmpPath_.c_str());
+            return false;
+        }
+
+        rotate(keep);
+        if (std::rename(tmpPath_.c_str(), path_.c_str()) != 0) {
+            fail("rename " + tmpPath_ + " -> " + path_);
+            std::remove(tmpPath_.c_str());
+            return false;
+        }
+        if (sync) syncDir(); // rename 本身也要落到磁碟，不然 crash 後可能還看到舊的目錄項目
+        return true;
+    }
+
+    void abort() {
+        if (!file_) return;
+        std::fclose(file_);
+        file_ = nullptr;
+        std::remove(tmpPath_.c_str());
+    }
+
+    const std::string &error() const { return error_; }
+
+private:
+    std::FILE  *file_ = nullptr;
+    std::string path_;
+    std::string tmpPath_;
+    std::string error_;
+
+    bool fail(const std::string &what) {
+        if (error_.empty()) error_ = what + ": " + std::strerror(errno);
+        return false;
+    }
+
+    // path.(keep-1) → path.keep … path.1 → path.2，再把目前的 path 留成 path.1。
+    // 用 hard link 留舊檔，path 本身到 rename 之前都還在；不支援 link 的檔案系統才改用 rename。
+    void rotate(unsigned keep) const {
+        struct stat st {};
+        if (keep == 0 || ::stat(path_.c_str(), &st) != 0) return; // 第一次存檔，沒有舊檔
+        for (unsigned i = keep; i > 1; --i) {
+            std::rename(backupPath(path_, i - 1).c_str(), backupPath(path_, i).c_str());
+        }
+        const std::string first = backupPath(path_, 1);
+        std::remove(first.c_str());
+        if (::link(path_.c_str(), first.c_str()) != 0) std::rename(path_.c_str(), first.c_str());
+    }
+
+    void syncDir() const {
+        const auto        pos = path_.find_last_of('/');
+        const std::string dir = pos == std::string::npos ? "." : (pos == 0 ? "/" : path_.substr(0, pos));
+        const int         fd  = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) return;
+        ::fsync(fd);
+        ::close(fd);
+    }
+};
+
+} // namespace util
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Binary log layout (LoggerOptions::encoding = Binary), decoded by tools/log_decode.cpp.
+// Integers are little-endian; varint = LEB128.
+//
+//   session : 'S' "HBLOG" u8 version            -- every Logger::init; resets the format table
+//   format  : 'F' varint id, varint len, bytes   -- written once per call site before its first event
+//   event   : 'E' u8 level, varint id, u64 micros since epoch, u8 argc, args...
+//   arg     : 'i' zigzag varint | 'u' varint | 'd' 8-byte double | 'b' u8 | 's' varint len, bytes
+//
+// Format id 0 is always "{}" with one string argument (plain Logger::info(...) messages).
+
+namespace util {
+namespace binlog {
+
+constexpr char          kSessionTag  = 'S';
+constexpr char          kFormatTag   = 'F';
+constexpr char          kEventTag    = 'E';
+constexpr char          kMagic[]     = "HBLOG";
+constexpr std::uint8_t  kVersion     = 1;
+constexpr std::uint32_t kPlainTextId = 0;
+
+constexpr char kArgInt    = 'i';
+constexpr char kArgUInt   = 'u';
+constexpr char kArgDouble = 'd';
+constexpr char kArgBool   = 'b';
+constexpr char kArgString = 's';
+
+inline void putVarint(std::string &out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline void putFixed64(std::string &out, std::uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+inline bool getVarint(const char *&p, const char *end, std::uint64_t &v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        const auto b = static_cast<std::uint8_t>(*p++);
+        v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline bool getFixed64(const char *&p, const char *end, std::uint64_t &v) {
+    if (end - p < 8) return false;
+    v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(p[i])) << (8 * i);
+    p += 8;
+    return true;
+}
+
+inline void putSession(std::string &out) {
+    out.push_back(kSessionTag);
+    out.append(kMagic, sizeof(kMagic) - 1);
+    out.push_back(static_cast<char>(kVersion));
+}
+
+inline void putFormat(std::string &out, std::uint32_t id, std::string_view fmt) {
+    out.push_back(kFormatTag);
+    putVarint(out, id);
+    putVarint(out, fmt.size());
+    out.append(fmt.data(), fmt.size());
+}
+
+inline void beginEvent(std::string &out, std::uint8_t level, std::uint32_t id,
+                       std::uint64_t micros, std::size_t argc) {
+    out.push_back(kEventTag);
+    out.push_back(static_cast<char>(level));
+    putVarint(out, id);
+    putFixed64(out, micros);
+    out.push_back(static_cast<char>(argc));
+}
+
+// ===== 參數編碼：原始值，不做任何文字格式化 =====
+
+inline void encodeArg(std::string &out, std::string_view v) {
+    out.push_back(kArgString);
+    putVarint(out, v.size());
+    out.append(v.data(), v.size());
+}
+inline void encodeArg(std::string &out, const std::string &v) { encodeArg(out, std::string_view(v)); }
+inline void encodeArg(std::string &out, const char *v) { encodeArg(out, std::string_view(v ? v : "(null)")); }
+inline void encodeArg(std::string &out, char v) { encodeArg(out, std::string_view(&v, 1)); }
+
+inline void encodeArg(std::string &out, bool v) {
+    out.push_back(kArgBool);
+    out.push_back(v ? 1 : 0);
+}
+
+template <typename T>
+std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>
+encodeArg(std::string &out, T v) {
+    if constexpr (std::is_signed_v<T>) {
+        const auto s = static_cast<std::int64_t>(v);
+        out.push_back(kArgInt);
+        putVarint(out, (static_cast<std::uint64_t>(s) << 1) ^ static_cast<std::uint64_t>(s >> 63));
+    } else {
+        out.push_back(kArgUInt);
+        putVarint(out, static_cast<std::uint64_t>(v));
+    }
+}
+
+template <typename T>
+std::enable_if_t<std::is_floating_point_v<T>> encodeArg(std::string &out, T v) {
+    const double d = static_cast<double>(v);
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    out.push_back(kArgDouble);
+    putFixed64(out, bits);
+}
+
+} // namespace binlog
+} // namespace util
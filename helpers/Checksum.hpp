@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace util {
+
+// XXH64（https://github.com/Cyan4973/xxHash 的演算法，結果跟官方實作相同）。
+// 存檔的完整性檢查用：比 CRC32 快很多，而且可以邊寫邊算。
+class Xxh64 {
+public:
+    explicit Xxh64(std::uint64_t seed = 0) { reset(seed); }
+
+    void reset(std::uint64_t seed = 0) {
+        seed_ = seed;
+        v_[0] = seed + P1 + P2;
+        v_[1] = seed + P2;
+        v_[2] = seed;
+        v_[3] = seed - P1;
+        total_ = 0;
+        bufLen_ = 0;
+    }
+
+    void update(const void *data, std::size_t n) {
+        const auto *p = static_cast<const unsigned char *>(data);
+        total_ += n;
+        if (bufLen_ + n < sizeof(buf_)) {
+            std::memcpy(buf_ + bufLen_, p, n);
+            bufLen_ += n;
+            return;
+        }
+        if (bufLen_ > 0) {
+            const std::size_t fill = sizeof(buf_) - bufLen_;
+            std::memcpy(buf_ + bufLen_, p, fill);
+            stripe(buf_);
+            p += fill;
+            n -= fill;
+            bufLen_ = 0;
+        }
+        for (; n >= sizeof(buf_); p += sizeof(buf_), n -= sizeof(buf_)) stripe(p);
+        std::memcpy(buf_, p, n);
+        bufLen_ = n;
+    }
+
+    std::uint64_t digest() const {
+        std::uint64_t h;
+        if (total_ >= sizeof(buf_)) {
+            h = rotl(v_[0], 1) + rotl(v_[1], 7) + rotl(v_[2], 12) + rotl(v_[3], 18);
+            for (std::uint64_t v : v_) h = (h ^ round(0, v)) * P1 + P4;
+        } else {
+            h = seed_ + P5;
+        }
+        h += total_;
+
+        const unsigned char *p   = buf_;
+        const unsigned char *end = buf_ + bufLen_;
+        for (; p + 8 <= end; p += 8) h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+        if (p + 4 <= end) {
+            h = rotl(h ^ (std::uint64_t{read32(p)} * P1), 23) * P2 + P3;
+            p += 4;
+        }
+        for (; p < end; ++p) h = rotl(h ^ (*p * P5), 11) * P1;
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    static std::uint64_t hash(const void *data, std::size_t n, std::uint64_t seed = 0) {
+        Xxh64 x(seed);
+        x.update(data, n);
+        return x.digest();
+    }
+
+private:
+    static constexpr std::uint64_t P1 = 11400714785074694791ULL;
+    static constexpr std::uint64_t P2 = 14029467366897019727ULL;
+    static constexpr std::uint64_t P3 = 1609587929392839161ULL;
+    static constexpr std::uint64_t P4 = 9650029242287828579ULL;
+    static constexpr std::uint64_t P5 = 2870177450012600261ULL;
+
+    std::uint64_t seed_ = 0;
+    std::uint64_t v_[4];
+    std::uint64_t total_ = 0;
+    unsigned char buf_[32];
+    std::size_t   bufLen_ = 0;
+
+    static std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+        acc += input * P2;
+        return rotl(acc, 31) * P1;
+    }
+
+    // little-endian 讀法（跟官方一樣；這個專案只跑在 little-endian 上）
+    static std::uint64_t read64(const unsigned char *p) {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    static std::uint32_t read32(const unsigned char *p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    void stripe(const unsigned char *p) {
+        for (int i = 0; i < 4; ++i) v_[i] = round(v_[i], read64(p + 8 * i));
+    }
+};
+
+} // namespace util
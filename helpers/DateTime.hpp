@@ -0,0 +1,315 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "Symbol.hpp"
+
+namespace util {
+
+// records 的 datetime 是使用者給的字串，這裡只認常見的幾種 ISO 8601 寫法。
+// parse 出來是 UTC epoch 毫秒，另外記住原本是哪一種寫法（有 ±HH:MM 的再加上 offset 分鐘數）：
+// formatDateTime(ms, format, offset) 一定還原成一模一樣的字串（欄位寬度固定、範圍都檢查過），所以可以只存數字。
+enum class DateTimeFormat : std::uint8_t {
+    IsoZ,         // 2025-01-01T08:00:00Z
+    IsoMillisZ,   // 2025-01-01T08:00:00.000Z（JavaScript 的 toISOString）
+    Iso,          // 2025-01-01T08:00:00
+    IsoMinutes,   // 2025-01-01T08:00
+    Space,        // 2025-01-01 08:00:00
+    SpaceMinutes, // 2025-01-01 08:00
+    Date,         // 2025-01-01
+    IsoOffset,       // 2025-01-01T08:00:00+08:00
+    IsoMillisOffset, // 2025-01-01T08:00:00.000+08:00
+};
+constexpr unsigned kDateTimeFormats = 9;
+
+inline bool hasOffset(DateTimeFormat format) {
+    return format == DateTimeFormat::IsoOffset || format == DateTimeFormat::IsoMillisOffset;
+}
+
+namespace detail {
+
+// Howard Hinnant 的 days_from_civil / civil_from_days（proleptic Gregorian，1970-01-01 = 0）
+inline std::int64_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int      era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return static_cast<std::int64_t>(era) * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+inline void civilFromDays(std::int64_t z, int &y, unsigned &m, unsigned &d) {
+    z += 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned     doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned     yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned     doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned     mp  = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int>(static_cast<std::int64_t>(yoe) + era * 400) + (m <= 2);
+}
+
+inline bool digits(std::string_view s, std::size_t pos, std::size_t n, unsigned &out) {
+    out = 0;
+    for (std::size_t i = pos; i < pos + n; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        out = out * 10 + static_cast<unsigned>(s[i] - '0');
+    }
+    return true;
+}
+
+inline void put(char *p, unsigned v, int n) {
+    for (int i = n - 1; i >= 0; --i, v /= 10) p[i] = static_cast<char>('0' + v % 10);
+}
+
+inline unsigned daysInMonth(unsigned y, unsigned m) {
+    static const unsigned kDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    return m == 2 && leap ? 29 : kDays[m - 1];
+}
+
+} // namespace detail
+
+// false = 不是上面任何一種寫法，或日期 / 時間不存在（2025-02-30、25:00 …）。
+// offsetMinutes 是 ±HH:MM 的分鐘數（東邊是正的），沒有 offset 的寫法是 0；ms 已經扣掉 offset 換成 UTC。
+// -00:00 不收：它跟 +00:00 是同一個 offset，還原不回原本的字串
+inline bool parseDateTime(std::string_view s, std::int64_t &ms, DateTimeFormat &format, int &offsetMinutes) {
+    std::size_t n = s.size(); // 不含 ±HH:MM
+    offsetMinutes = 0;
+    if ((n == 25 || n == 29) && s[10] == 'T' && (s[n - 6] == '+' || s[n - 6] == '-') && s[n - 3] == ':') {
+        unsigned oh, om;
+        if (!detail::digits(s, n - 5, 2, oh) || !detail::digits(s, n - 2, 2, om) || oh > 23 || om > 59) return false;
+        if (s[n - 6] == '-' && oh == 0 && om == 0) return false;
+        offsetMinutes = static_cast<int>(oh * 60 + om) * (s[n - 6] == '-' ? -1 : 1);
+        n -= 6;
+        if (n == 23 && s[19] != '.') return false;
+        format = n == 19 ? DateTimeFormat::IsoOffset : DateTimeFormat::IsoMillisOffset;
+    } else if (n == 10) {
+        format = DateTimeFormat::Date;
+    } else if (n == 16 && (s[10] == 'T' || s[10] == ' ')) {
+        format = s[10] == 'T' ? DateTimeFormat::IsoMinutes : DateTimeFormat::SpaceMinutes;
+    } else if (n == 19 && (s[10] == 'T' || s[10] == ' ')) {
+        format = s[10] == 'T' ? DateTimeFormat::Iso : DateTimeFormat::Space;
+    } else if (n == 20 && s[10] == 'T' && s[19] == 'Z') {
+        format = DateTimeFormat::IsoZ;
+    } else if (n == 24 && s[10] == 'T' && s[19] == '.' && s[23] == 'Z') {
+        format = DateTimeFormat::IsoMillisZ;
+        n      = 23;
+    } else {
+        return false;
+    }
+
+    unsigned y, mo, d, h = 0, mi = 0, sec = 0, milli = 0;
+    if (s[4] != '-' || s[7] != '-' || !detail::digits(s, 0, 4, y) || !detail::digits(s, 5, 2, mo) ||
+        !detail::digits(s, 8, 2, d)) {
+        return false;
+    }
+    if (n >= 16 && (s[13] != ':' || !detail::digits(s, 11, 2, h) || !detail::digits(s, 14, 2, mi))) return false;
+    if (n >= 19 && (s[16] != ':' || !detail::digits(s, 17, 2, sec))) return false;
+    if (n == 23 && !detail::digits(s, 20, 3, milli)) return false;
+    if (mo < 1 || mo > 12 || d < 1 || d > detail::daysInMonth(y, mo) || h > 23 || mi > 59 || sec > 59) return false;
+
+    const std::int64_t days = detail::daysFromCivil(static_cast<int>(y), mo, d);
+    ms = ((days * 24 + h) * 60 + mi) * 60000 + static_cast<std::int64_t>(sec) * 1000 + milli;
+    ms -= static_cast<std::int64_t>(offsetMinutes) * 60000;
+    return true;
+}
+
+inline bool parseDateTime(std::string_view s, std::int64_t &ms, DateTimeFormat &format) {
+    int offsetMinutes;
+    return parseDateTime(s, ms, format, offsetMinutes);
+}
+
+inline bool parseDateTime(std::string_view s, std::int64_t &ms) {
+    DateTimeFormat format;
+    int            offsetMinutes;
+    return parseDateTime(s, ms, format, offsetMinutes);
+}
+
+namespace detail {
+
+// 寫進 buf（至少 29 bytes），回傳長度
+inline std::size_t formatDateTime(std::int64_t ms, DateTimeFormat format, int offsetMinutes, char *buf) {
+    ms += static_cast<std::int64_t>(offsetMinutes) * 60000; // 印的是當地時間
+    std::int64_t days = ms / 86400000;
+    std::int64_t rem  = ms % 86400000;
+    if (rem < 0) {
+        rem += 86400000;
+        --days;
+    }
+    int      y;
+    unsigned mo, d;
+    detail::civilFromDays(days, y, mo, d);
+    const unsigned t = static_cast<unsigned>(rem);
+
+    detail::put(buf, static_cast<unsigned>(y), 4);
+    buf[4] = '-';
+    detail::put(buf + 5, mo, 2);
+    buf[7] = '-';
+    detail::put(buf + 8, d, 2);
+    std::size_t n = 10;
+    if (format != DateTimeFormat::Date) {
+        const bool space = format == DateTimeFormat::Space || format == DateTimeFormat::SpaceMinutes;
+        buf[10] = space ? ' ' : 'T';
+        detail::put(buf + 11, t / 3600000, 2);
+        buf[13] = ':';
+        detail::put(buf + 14, t / 60000 % 60, 2);
+        n = 16;
+        if (format != DateTimeFormat::IsoMinutes && format != DateTimeFormat::SpaceMinutes) {
+            buf[16] = ':';
+            detail::put(buf + 17, t / 1000 % 60, 2);
+            n = 19;
+        }
+        if (format == DateTimeFormat::IsoMillisZ || format == DateTimeFormat::IsoMillisOffset) {
+            buf[19] = '.';
+            detail::put(buf + 20, t % 1000, 3);
+            n = 23;
+        }
+        if (format == DateTimeFormat::IsoZ || format == DateTimeFormat::IsoMillisZ) buf[n++] = 'Z';
+        if (hasOffset(format)) {
+            const unsigned off = static_cast<unsigned>(offsetMinutes < 0 ? -offsetMinutes : offsetMinutes);
+            buf[n] = offsetMinutes < 0 ? '-' : '+';
+            detail::put(buf + n + 1, off / 60, 2);
+            buf[n + 3] = ':';
+            detail::put(buf + n + 4, off % 60, 2);
+            n += 6;
+        }
+    }
+    return n;
+}
+
+} // namespace detail
+
+// parseDateTime 的反向；ms / format / offsetMinutes 要是 parse 得出來的值（當地時間的年份 0000 … 9999）
+inline void formatDateTime(std::int64_t ms, DateTimeFormat format, int offsetMinutes, std::string &out) {
+    char buf[32];
+    out.assign(buf, detail::formatDateTime(ms, format, offsetMinutes, buf));
+}
+
+inline void formatDateTime(std::int64_t ms, DateTimeFormat format, std::string &out) {
+    formatDateTime(ms, format, 0, out);
+}
+
+// records 的 datetime 欄位：24 bytes、trivially copyable，不用 heap（std::string 放不下 20 字以上的
+// datetime，每筆 record 都要另外配置一塊）。存法看字串而定：
+//   parseDateTime 認得 → 毫秒 + 寫法 + offset，要字串的時候再 formatDateTime（一定還原成原本的字串）
+//   認不得、kInlineText 以內 → 原字串直接放在裡面
+//   認不得又更長 → interned（util::Symbol::permanent），這種字串不會釋放（這個 class 要 trivially copyable，
+//     沒辦法替它算 reference）。只留給舊資料載入用：新寫入的 datetime 要先過 storable()，不然 client 可以讓 Symbol 表一直長
+// 同一個字串一定是同一種存法、同樣的 bytes，所以 == 直接比 bytes。
+class PackedDateTime {
+public:
+    static constexpr std::size_t kInlineText = 22;
+    // view() 的 buffer：最長的寫法（IsoMillisOffset）29 字
+    using Buffer = char[32];
+
+    PackedDateTime() = default;
+    explicit PackedDateTime(std::string_view s) { assign(s); }
+
+    PackedDateTime &operator=(std::string_view s) {
+        assign(s);
+        return *this;
+    }
+
+    // ms / format / offsetMinutes 要是 parseDateTime 得出來的值（cold tier 解 block 的時候用，不必先格式化再 parse）
+    static PackedDateTime fromMillis(std::int64_t ms, DateTimeFormat format, int offsetMinutes = 0) {
+        PackedDateTime d;
+        d.setMillis(ms, format, offsetMinutes);
+        return d;
+    }
+
+    // 存得下而且不會 intern：認得的寫法，或不超過 kInlineText 的字串
+    static bool storable(std::string_view s) {
+        std::int64_t ms;
+        return s.size() <= kInlineText || parseDateTime(s, ms);
+    }
+
+    void assign(std::string_view s) {
+        std::int64_t   ms;
+        DateTimeFormat format;
+        int            offsetMinutes;
+        if (parseDateTime(s, ms, format, offsetMinutes)) {
+            setMillis(ms, format, offsetMinutes);
+            return;
+        }
+        std::memset(bytes_, 0, sizeof(bytes_));
+        if (s.size() <= kInlineText) {
+            std::memcpy(bytes_, s.data(), s.size());
+            tag_ = static_cast<std::uint8_t>(s.size());
+        } else {
+            const std::uint32_t id = Symbol::permanent(s).id();
+            std::memcpy(bytes_, &id, sizeof(id));
+            tag_ = kInterned;
+        }
+    }
+
+    // 認得的寫法才有毫秒（跟 parseDateTime 一樣），不用再 parse
+    bool millis(std::int64_t &ms, DateTimeFormat &format, int &offsetMinutes) const {
+        if (tag_ != kParsed) return false;
+        std::int16_t offset;
+        std::memcpy(&ms, bytes_, sizeof(ms));
+        format = static_cast<DateTimeFormat>(bytes_[8]);
+        std::memcpy(&offset, bytes_ + 9, sizeof(offset));
+        offsetMinutes = offset;
+        return true;
+    }
+    bool millis(std::int64_t &ms) const {
+        DateTimeFormat format;
+        int            offsetMinutes;
+        return millis(ms, format, offsetMinutes);
+    }
+
+    // 原本的字串；指向 buf、這個物件本身或 Symbol 表，buf 和這個物件都要活得比回傳值久
+    std::string_view view(Buffer &buf) const {
+        std::int64_t   ms;
+        DateTimeFormat format;
+        int            offsetMinutes;
+        if (millis(ms, format, offsetMinutes)) {
+            return std::string_view(buf, detail::formatDateTime(ms, format, offsetMinutes, buf));
+        }
+        if (tag_ == kInterned) {
+            std::uint32_t id;
+            std::memcpy(&id, bytes_, sizeof(id));
+            return SymbolRef::fromId(id).str();
+        }
+        return std::string_view(bytes_, tag_);
+    }
+
+    std::string str() const {
+        Buffer buf;
+        return std::string(view(buf));
+    }
+
+    bool empty() const { return tag_ == 0; }
+
+    friend bool operator==(const PackedDateTime &a, const PackedDateTime &b) {
+        return a.tag_ == b.tag_ && std::memcmp(a.bytes_, b.bytes_, sizeof(a.bytes_)) == 0;
+    }
+    friend bool operator!=(const PackedDateTime &a, const PackedDateTime &b) { return !(a == b); }
+
+private:
+    static constexpr std::uint8_t kParsed   = 0xff;
+    static constexpr std::uint8_t kInterned = 0xfe;
+
+    void setMillis(std::int64_t ms, DateTimeFormat format, int offsetMinutes) {
+        const auto offset = static_cast<std::int16_t>(offsetMinutes);
+        std::memset(bytes_, 0, sizeof(bytes_));
+        std::memcpy(bytes_, &ms, sizeof(ms));
+        bytes_[8] = static_cast<char>(format);
+        std::memcpy(bytes_ + 9, &offset, sizeof(offset));
+        tag_ = kParsed;
+    }
+
+    char         bytes_[kInlineText + 1] = {}; // 毫秒 + 寫法 + offset / 原字串 / symbol id，沒用到的都是 0
+    std::uint8_t tag_                    = 0;  // 0 … kInlineText = 原字串長度；kParsed；kInterned
+};
+
+static_assert(sizeof(PackedDateTime) == 24, "PackedDateTime should stay 24 bytes");
+static_assert(std::is_trivially_copyable_v<PackedDateTime>, "records copy PackedDateTime with memcpy");
+
+} // namespace util
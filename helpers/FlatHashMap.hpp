@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// std::string key 的 open-addressing hash map（linear probing），查詢直接吃 std::string_view：
+// Authorization header 切出來的 token 不用先複製成 std::string 才能查。
+//
+// bucket 只有 8 bytes（hash 的 32 bits + entry 的位置），probe 都在連續的 bucket 陣列裡，
+// hash 對上了才去比字串；entries 照插入順序放在 deque 裡，走訪也是連續的。
+//
+// 跟 std::map 不一樣的地方：
+//   - 走訪順序是插入順序，不是 key 的順序
+//   - insert 不會讓既有 entry 的 reference 失效（deque 只從尾端長，rehash 只動 bucket）；
+//     erase 會把最後一筆搬進被刪的位置，那一筆的 reference / iterator 會失效
+template <typename V>
+class FlatHashMap {
+public:
+    using value_type     = std::pair<std::string, V>;
+    using iterator       = typename std::deque<value_type>::iterator;
+    using const_iterator = typename std::deque<value_type>::const_iterator;
+
+    iterator       begin() { return entries_.begin(); }
+    iterator       end() { return entries_.end(); }
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+
+    std::size_t size() const { return entries_.size(); }
+    bool        empty() const { return entries_.empty(); }
+
+    void reserve(std::size_t n) {
+        if (n * 4 > buckets_.size() * 3) rehash(bucketsFor(n));
+    }
+
+    void clear() {
+        entries_.clear();
+        buckets_.clear();
+        mask_ = 0;
+    }
+
+    iterator find(std::string_view key) {
+        std::size_t slot;
+        return findSlot(key, hashOf(key), slot) ? entries_.begin() + buckets_[slot].index : entries_.end();
+    }
+    const_iterator find(std::string_view key) const {
+        std::size_t slot;
+        return findSlot(key, hashOf(key), slot) ? entries_.begin() + buckets_[slot].index : entries_.end();
+    }
+
+    bool contains(std::string_view key) const { return find(key) != end(); }
+
+    V& at(std::string_view key) {
+        auto it = find(key);
+        if (it == end()) throw std::out_of_range("util::FlatHashMap::at");
+        return it->second;
+    }
+    const V& at(std::string_view key) const {
+        auto it = find(key);
+        if (it == end()) throw std::out_of_range("util::FlatHashMap::at");
+        return it->second;
+    }
+
+    // key 已經在的話什麼都不做（args 不會被用到），回傳 {既有的, false}
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(std::string key, Args&&... args) {
+        const std::uint32_t h = hashOf(key);
+        std::size_t         slot;
+        if (findSlot(key, h, slot)) return {entries_.begin() + buckets_[slot].index, false};
+        if ((entries_.size() + 1) * 4 > buckets_.size() * 3) {
+            rehash(bucketsFor(entries_.size() + 1));
+            findSlot(key, h, slot);
+        }
+        buckets_[slot] = Bucket{h, static_cast<std::uint32_t>(entries_.size())};
+        entries_.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+        return {entries_.end() - 1, true};
+    }
+
+    std::pair<iterator, bool> emplace(std::string key, V value) {
+        return try_emplace(std::move(key), std::move(value));
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(std::string key, M&& value) {
+        auto result = try_emplace(std::move(key), std::forward<M>(value));
+        if (!result.second) result.first->second = std::forward<M>(value);
+        return result;
+    }
+
+    std::size_t erase(std::string_view key) {
+        std::size_t slot;
+        if (!findSlot(key, hashOf(key), slot)) return 0;
+        const std::uint32_t index = buckets_[slot].index;
+
+        // backward-shift：後面同一串的 bucket 往前補，不留 tombstone
+        std::size_t hole = slot;
+        for (std::size_t i = (slot + 1) & mask_; buckets_[i].index != kEmpty; i = (i + 1) & mask_) {
+            const std::size_t home = buckets_[i].hash & mask_;
+            if (((i - home) & mask_) >= ((i - hole) & mask_)) {
+                buckets_[hole] = buckets_[i];
+                hole           = i;
+            }
+        }
+        buckets_[hole] = Bucket{0, kEmpty};
+
+        // 最後一筆搬進空出來的位置，entries 保持連續
+        const auto last = static_cast<std::uint32_t>(entries_.size() - 1);
+        if (index != last) {
+            std::size_t lastSlot;
+            findSlot(entries_[last].first, hashOf(entries_[last].first), lastSlot);
+            buckets_[lastSlot].index = index;
+            entries_[index]          = std::move(entries_[last]);
+        }
+        entries_.pop_back();
+        return 1;
+    }
+
+private:
+    static constexpr std::uint32_t kEmpty = UINT32_MAX;
+
+    struct Bucket {
+        std::uint32_t hash;  // rehash 時不用再算一次字串的 hash
+        std::uint32_t index; // entries_ 裡的位置；kEmpty = 空的
+    };
+
+    static std::uint32_t hashOf(std::string_view key) {
+        const std::uint64_t h = std::hash<std::string_view>{}(key);
+        return static_cast<std::uint32_t>(h ^ (h >> 32));
+    }
+
+    // 使用率最多 3/4
+    static std::size_t bucketsFor(std::size_t n) {
+        std::size_t count = 16;
+        while (count * 3 < n * 4) count <<= 1;
+        return count;
+    }
+
+    // true：key 在 buckets_[slot]；false：slot 是它該放的空 bucket（沒有 bucket 時不填）
+    bool findSlot(std::string_view key, std::uint32_t h, std::size_t& slot) const {
+        if (buckets_.empty()) return false;
+        for (std::size_t i = h & mask_;; i = (i + 1) & mask_) {
+            const Bucket& b = buckets_[i];
+            if (b.index == kEmpty) {
+                slot = i;
+                return false;
+            }
+            if (b.hash == h && entries_[b.index].first == key) {
+                slot = i;
+                return true;
+            }
+        }
+    }
+
+    void rehash(std::size_t count) {
+        std::vector<Bucket> fresh(count, Bucket{0, kEmpty});
+        const std::size_t   mask = count - 1;
+        for (const Bucket& b : buckets_) {
+            if (b.index == kEmpty) continue;
+            std::size_t i = b.hash & mask;
+            while (fresh[i].index != kEmpty) i = (i + 1) & mask;
+            fresh[i] = b;
+        }
+        buckets_.swap(fresh);
+        mask_ = mask;
+    }
+
+    std::deque<value_type> entries_;
+    std::vector<Bucket>    buckets_;
+    std::size_t            mask_ = 0;
+};
+
+} // namespace util
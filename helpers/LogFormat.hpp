@@ -0,0 +1,53 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace util {
+namespace detail {
+
+// 把單一參數接到 out 後面（只在 log 真的會輸出時才呼叫）
+inline void appendArg(std::string &out, std::string_view v) { out.append(v.data(), v.size()); }
+inline void appendArg(std::string &out, const std::string &v) { out.append(v); }
+inline void appendArg(std::string &out, const char *v) { out.append(v ? v : "(null)"); }
+inline void appendArg(std::string &out, char v) { out.push_back(v); }
+inline void appendArg(std::string &out, bool v) { out.append(v ? "true" : "false"); }
+
+template <typename T>
+std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>
+appendArg(std::string &out, T v) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<std::size_t>(res.ptr - buf));
+}
+
+template <typename T>
+std::enable_if_t<std::is_floating_point_v<T>> appendArg(std::string &out, T v) {
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<std::size_t>(res.ptr - buf));
+}
+
+// 複製 fmt 直到下一個 "{}"，回傳 "{}" 後面的位置（沒有就回傳結尾）
+inline const char *appendUntilPlaceholder(std::string &out, const char *fmt) {
+    const char *p = std::strstr(fmt, "{}");
+    if (!p) {
+        out.append(fmt);
+        return fmt + std::strlen(fmt);
+    }
+    out.append(fmt, static_cast<std::size_t>(p - fmt));
+    return p + 2;
+}
+
+// "user={} token={}" 依序把 "{}" 換成參數
+template <typename... Args>
+void formatTo(std::string &out, const char *fmt, const Args &...args) {
+    ((fmt = appendUntilPlaceholder(out, fmt), appendArg(out, args)), ...);
+    out.append(fmt);
+}
+
+} // namespace detail
+} // namespace util
@@ -1,18 +1,196 @@
 #include "Logger.hpp"
+#include "RingBuffer.hpp"
 #include <iostream>
 #include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
 #include <filesystem>
-#include <iomanip>
+#include <memory>
+#include <thread>
+#include <vector>
 
 namespace util {
 
 std::mutex Logger::mtx_;
 std::ofstream Logger::out_;
-LogLevel Logger::level_ = LogLevel::Info;
+std::atomic<LogLevel> Logger::level_{LogLevel::Info};
+std::atomic<bool> Logger::binary_{false};
+std::uint32_t Logger::nextFormatId_ = binlog::kPlainTextId + 1;
+
+namespace {
+
+struct Entry {
+    LogLevel                              level = LogLevel::Info;
+    std::chrono::system_clock::time_point time;
+    std::string                           msg;   // binary mode: an encoded record
+};
+
+// 非同步模式的狀態：producer 丟進 ring buffer，背景 thread 批次寫出
+struct AsyncState {
+    explicit AsyncState(const LoggerOptions &o) : opts(o), queue(o.queueCapacity) {}
+
+    LoggerOptions           opts;
+    MpscRingBuffer<Entry>   queue;
+    std::atomic<bool>       running{true};
+    std::atomic<bool>       sleeping{false};
+    std::atomic<unsigned>   pushers{0}; // 正在 enqueue 的 producer；writer 要等它們都走了才結束
+    std::mutex              wakeMtx;
+    std::condition_variable wakeCv;
+    std::thread             worker;
+};
+
+// Producers only ever see the raw pointer. A producer that loaded it just before shutdown()
+// may still be using it, and nothing tells us when it is done, so states are never freed:
+// every init() adds one (re-init only happens in tests / tools, a handful per process).
+// back() is the current one; guarded by Logger::mtx_.
+std::vector<std::unique_ptr<AsyncState>> g_asyncStates;
+std::atomic<AsyncState*>                 g_async{nullptr};
+std::atomic<std::uint64_t>  g_dropped{0};
+
+std::atomic<TimestampPrecision> g_precision{TimestampPrecision::Seconds};
+
+// 已註冊的 format（guarded by Logger::mtx_），重新 init 時要再寫一次定義
+std::vector<std::pair<std::uint32_t, std::string>> g_formats;
+
+// WARN/ERROR 限流（GCRA 形式的 token bucket）：interval = 每個 token 的時間，
+// tolerance = (burst - 1) * interval；interval <= 0 代表不限流
+std::atomic<std::int64_t> g_warnInterval{1000000};
+std::atomic<std::int64_t> g_warnTolerance{9 * 1000000};
+
+// Logger::warn(string) 這種沒有 call site 的：一個 key（訊息本身 / format）一個 bucket，
+// 用完整的 64-bit hash 找、再比對字串，不相干的訊息不會共用額度、互相吃掉。
+// 表的大小固定（open addressing，最多看 kPlainProbe 格）；滿了就回收額度已經回滿的 slot，
+// 附近的 slot 都還在限流中的話這則不限流：寧可多印，不丟不相干的 ERROR
+struct PlainSlot {
+    bool                       used  = false;
+    std::uint64_t              hash  = 0;
+    LogLevel                   level = LogLevel::Warning;
+    std::string                key;
+    std::atomic<std::int64_t>  tat{0};
+    std::atomic<std::uint32_t> suppressed{0};
+};
+constexpr std::size_t kPlainSlots = 256;
+constexpr std::size_t kPlainProbe = 16;
+std::mutex            g_plainMtx; // 整個查表 + admit 都在這個鎖底下（只有沒 call site 的 WARN/ERROR 會走到）
+PlainSlot             g_plainSlots[kPlainSlots];
+
+// "] [INFO] " etc. with their lengths, so the prefix is a memcpy
+struct LevelTag {
+    const char *text;
+    std::size_t len;
+};
+
+LevelTag levelTag(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug:   return {"] [DEBUG] ", 10};
+        case LogLevel::Info:    return {"] [INFO] ", 9};
+        case LogLevel::Warning: return {"] [WARN] ", 9};
+        case LogLevel::Error:   return {"] [ERROR] ", 10};
+    }
+    return {"] [INFO] ", 9};
+}
+
+inline void put2(char *p, int v) {
+    p[0] = static_cast<char>('0' + v / 10);
+    p[1] = static_cast<char>('0' + v % 10);
+}
+
+// "YYYY-MM-DD HH:MM:SS" for one epoch second (the slow path: localtime_r)
+void formatSecond(std::time_t sec, char *out) {
+    std::tm tm{};
+    localtime_r(&sec, &tm);
+    const int year = tm.tm_year + 1900;
+    put2(out, year / 100);
+    put2(out + 2, year % 100);
+    out[4] = '-';
+    put2(out + 5, tm.tm_mon + 1);
+    out[7] = '-';
+    put2(out + 8, tm.tm_mday);
+    out[10] = ' ';
+    put2(out + 11, tm.tm_hour);
+    out[13] = ':';
+    put2(out + 14, tm.tm_min);
+    out[16] = ':';
+    put2(out + 17, tm.tm_sec);
+}
+
+// 所有 thread 共用的「目前這一秒」字串：每秒只有一個 thread 會呼叫 localtime_r，
+// 其他人用 seqlock 讀 atomic words，不需要上鎖
+class TimestampCache {
+public:
+    static constexpr std::size_t kLen = 19;
+
+    void get(std::time_t sec, char *out) {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            const std::uint32_t s1 = seq_.load(std::memory_order_acquire);
+            if (s1 & 1u) continue; // writer 正在更新
+            if (second_.load(std::memory_order_relaxed) != sec) break;
+            std::uint64_t w[kWords];
+            for (std::size_t i = 0; i < kWords; ++i) w[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == s1) {
+                std::memcpy(out, w, kLen);
+                return;
+            }
+        }
+
+        // miss：自己格式化，順便試著更新 cache（搶不到就算了）
+        std::uint64_t w[kWords] = {};
+        formatSecond(sec, reinterpret_cast<char *>(w));
+        std::memcpy(out, w, kLen);
+
+        std::uint32_t s = seq_.load(std::memory_order_relaxed);
+        if ((s & 1u) == 0 &&
+            seq_.compare_exchange_strong(s, s + 1, std::memory_order_relaxed)) {
+            std::atomic_thread_fence(std::memory_order_release);
+            for (std::size_t i = 0; i < kWords; ++i) words_[i].store(w[i], std::memory_order_relaxed);
+            second_.store(sec, std::memory_order_relaxed);
+            seq_.store(s + 2, std::memory_order_release);
+        }
+    }
+
+private:
+    static constexpr std::size_t kWords = 3; // 24 bytes >= kLen
+
+    std::atomic<std::uint32_t> seq_{0};
+    std::atomic<std::time_t>   second_{static_cast<std::time_t>(LLONG_MIN)};
+    std::atomic<std::uint64_t> words_[kWords] = {};
+};
+
+TimestampCache g_tsCache;
+
+// producer 放進 queue（或離開）之後叫醒 writer。跟 writerLoop 是 Dekker 式的配對：
+// 這邊「改 queue / pushers → fence → 讀 sleeping」，writer 那邊「寫 sleeping → fence → 檢查 queue / pushers」，
+// 兩邊至少有一邊看得到另一邊。看到 sleeping 的話先拿一下 wakeMtx 再 notify：writer 不是還沒檢查條件，
+// 就是已經在 wait 裡了，notify 不會掉在檢查和睡著中間
+void wake(AsyncState &st) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!st.sleeping.load(std::memory_order_relaxed)) return;
+    { std::lock_guard<std::mutex> lk(st.wakeMtx); }
+    st.wakeCv.notify_one();
+}
+
+// enqueue 的每個出口都走這裡；shutdown 之後最後一個離開的 producer 要叫醒等著結束的 writer
+void leave(AsyncState &st) {
+    st.pushers.fetch_sub(1);
+    wake(st);
+}
+
+} // namespace
 
 void Logger::init(const std::string &filePath, LogLevel level) {
+    init(filePath, level, LoggerOptions{});
+}
+
+void Logger::init(const std::string &filePath, LogLevel level, const LoggerOptions &opts) {
+    shutdown(); // 重新 init 時先把舊的 writer 收掉
+
     std::lock_guard<std::mutex> lk(mtx_);
-    level_ = level;
+    level_.store(level, std::memory_order_relaxed);
+    g_precision.store(opts.precision, std::memory_order_relaxed);
+    const bool binary = opts.encoding == LogEncoding::Binary;
     if (!filePath.empty()) {
         try {
             std::filesystem::path p(filePath);
@@ -20,49 +198,321 @@ void Logger::init(const std::string &filePath, LogLevel level) {
         } catch (...) {
             // ignore failures creating directory
         }
-        out_.open(filePath, std::ios::app);
+        out_.open(filePath, binary ? std::ios::app | std::ios::binary : std::ios::app);
+    }
+    if (binary && out_.is_open()) {
+        std::string header;
+        binlog::putSession(header);
+        for (const auto &[id, fmt] : g_formats) binlog::putFormat(header, id, fmt);
+        out_ << header;
+        out_.flush();
+    }
+    binary_.store(binary, std::memory_order_release);
+
+    const std::int64_t interval =
+        opts.warnRatePerSec > 0.0 ? static_cast<std::int64_t>(1e6 / opts.warnRatePerSec) : 0;
+    g_warnInterval.store(interval, std::memory_order_relaxed);
+    g_warnTolerance.store(opts.warnBurst > 1 ? static_cast<std::int64_t>(opts.warnBurst - 1) * interval : 0,
+                          std::memory_order_relaxed);
+
+    if (opts.async) {
+        g_asyncStates.push_back(std::make_unique<AsyncState>(opts));
+        AsyncState *st = g_asyncStates.back().get();
+        st->worker     = std::thread(&Logger::writerLoop);
+        g_async.store(st, std::memory_order_release);
     }
 }
 
 void Logger::shutdown() {
+    AsyncState *st = g_async.exchange(nullptr, std::memory_order_acq_rel);
+    if (st) {
+        st->running.store(false);
+        wake(*st);
+        if (st->worker.joinable()) st->worker.join();
+    }
+
     std::lock_guard<std::mutex> lk(mtx_);
+    std::fflush(stdout);
     if (out_.is_open()) {
         out_.flush();
         out_.close();
     }
 }
 
-std::string Logger::timeStamp() {
+std::uint64_t Logger::droppedCount() {
+    return g_dropped.load(std::memory_order_relaxed);
+}
+
+std::size_t Logger::timeStamp(char *buf, Clock::time_point when) {
     using namespace std::chrono;
-    auto now = system_clock::now();
-    auto itt = system_clock::to_time_t(now);
-    std::ostringstream ss;
-    ss << std::put_time(std::localtime(&itt), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+    const auto ms  = duration_cast<milliseconds>(when.time_since_epoch()).count();
+    auto       sec = static_cast<std::time_t>(ms / 1000);
+    auto       rem = static_cast<int>(ms % 1000);
+    if (rem < 0) {
+        rem += 1000;
+        --sec;
+    }
+    g_tsCache.get(sec, buf);
+    if (g_precision.load(std::memory_order_relaxed) == TimestampPrecision::Seconds) {
+        return TimestampCache::kLen;
+    }
+    char *p = buf + TimestampCache::kLen;
+    p[0] = '.';
+    p[1] = static_cast<char>('0' + rem / 100);
+    put2(p + 2, rem % 100);
+    return TimestampCache::kLen + 4;
 }
 
-void Logger::log(LogLevel level, const std::string &msg) {
+std::size_t Logger::formatPrefix(char *buf, LogLevel level, Clock::time_point when) {
+    buf[0] = '[';
+    std::size_t n = 1 + timeStamp(buf + 1, when);
+    const LevelTag tag = levelTag(level);
+    std::memcpy(buf + n, tag.text, tag.len);
+    return n + tag.len;
+}
+
+void Logger::appendLine(std::string &out, LogLevel level, Clock::time_point when, const std::string &msg) {
+    char prefix[64];
+    const std::size_t n = formatPrefix(prefix, level, when);
+    out.append(prefix, n);
+    out.append(msg);
+    out.push_back('\n');
+}
+
+std::uint64_t Logger::nowMicros() {
+    using namespace std::chrono;
+    return static_cast<std::uint64_t>(duration_cast<microseconds>(Clock::now().time_since_epoch()).count());
+}
+
+std::uint32_t Logger::formatId(LogSite &site, const char *fmt) {
+    std::uint32_t id = site.id.load(std::memory_order_acquire);
+    if (id != 0) return id;
+
     std::lock_guard<std::mutex> lk(mtx_);
-    if (level < level_) return;
-    std::string lvl;
-    switch (level) {
-        case LogLevel::Debug: lvl = "DEBUG"; break;
-        case LogLevel::Info: lvl = "INFO"; break;
-        case LogLevel::Warning: lvl = "WARN"; break;
-        case LogLevel::Error: lvl = "ERROR"; break;
-    }
-    std::ostringstream oss;
-    oss << "[" << timeStamp() << "] [" << lvl << "] " << msg << "\n";
-    const std::string outStr = oss.str();
+    id = site.id.load(std::memory_order_relaxed);
+    if (id != 0) return id;
+
+    // 定義要比任何用到這個 id 的 event 先進檔案：在公開 id 之前同步寫掉
+    id = nextFormatId_++;
+    g_formats.emplace_back(id, fmt);
+    if (out_.is_open()) {
+        std::string rec;
+        binlog::putFormat(rec, id, fmt);
+        out_ << rec;
+    }
+    site.id.store(id, std::memory_order_release);
+    return id;
+}
+
+std::string Logger::plainRecord(LogLevel level, const std::string &msg) {
+    std::string rec;
+    rec.reserve(msg.size() + 16);
+    binlog::beginEvent(rec, static_cast<std::uint8_t>(level), binlog::kPlainTextId, nowMicros(), 1);
+    binlog::encodeArg(rec, msg);
+    return rec;
+}
+
+void Logger::writeOut(const std::string &text) {
+    if (binary_.load(std::memory_order_relaxed)) {
+        if (out_.is_open()) {
+            out_ << text;
+            out_.flush();
+        }
+        return;
+    }
     // write to stdout
-    std::fwrite(outStr.data(), 1, outStr.size(), stdout);
+    std::fwrite(text.data(), 1, text.size(), stdout);
     // flush to file if open
     if (out_.is_open()) {
-        out_ << outStr;
+        out_ << text;
         out_.flush();
     }
 }
 
+bool Logger::admit(std::atomic<std::int64_t> &tat, std::atomic<std::uint32_t> &suppressed,
+                   LogLevel level, const char *what) {
+    const std::int64_t interval = g_warnInterval.load(std::memory_order_relaxed);
+    if (interval <= 0) return true;
+    const std::int64_t tolerance = g_warnTolerance.load(std::memory_order_relaxed);
+    const auto         now       = static_cast<std::int64_t>(nowMicros());
+
+    std::int64_t cur = tat.load(std::memory_order_relaxed);
+    for (;;) {
+        const std::int64_t base = cur > now ? cur : now;
+        if (base - now > tolerance) { // bucket 空了
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (tat.compare_exchange_weak(cur, base + interval, std::memory_order_relaxed)) break;
+    }
+
+    const std::uint32_t dropped = suppressed.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        std::string note = "suppressed " + std::to_string(dropped) + " similar messages: " + what;
+        emit(level, note, &note);
+    }
+    return true;
+}
+
+bool Logger::admitPlain(LogLevel level, std::string_view key) {
+    if (g_warnInterval.load(std::memory_order_relaxed) <= 0) return true;
+    const std::uint64_t hash = std::hash<std::string_view>{}(key);
+    const auto          now  = static_cast<std::int64_t>(nowMicros());
+
+    std::lock_guard<std::mutex> lk(g_plainMtx);
+    PlainSlot *slot  = nullptr;
+    PlainSlot *spare = nullptr; // 空的，或額度已經回滿（閒置）可以回收的
+    for (std::size_t i = 0; i < kPlainProbe; ++i) {
+        PlainSlot &s = g_plainSlots[(hash + i) % kPlainSlots];
+        if (s.used && s.hash == hash && s.key == key) {
+            slot        = &s;
+            slot->level = level;
+            break;
+        }
+        if (!spare && (!s.used || s.tat.load(std::memory_order_relaxed) <= now)) spare = &s;
+    }
+    if (!slot) {
+        if (!spare) return true;
+        // 回收的 slot 還有沒報的 suppressed：先補一行，免得算到新的 key 頭上
+        if (spare->used) {
+            if (const std::uint32_t dropped = spare->suppressed.exchange(0, std::memory_order_relaxed)) {
+                std::string note = "suppressed " + std::to_string(dropped) + " similar messages: " + spare->key;
+                emit(spare->level, note, &note);
+            }
+        }
+        spare->used  = true;
+        spare->hash  = hash;
+        spare->level = level;
+        spare->key.assign(key.data(), key.size());
+        spare->tat.store(0, std::memory_order_relaxed);
+        spare->suppressed.store(0, std::memory_order_relaxed);
+        slot = spare;
+    }
+    return admit(slot->tat, slot->suppressed, level, slot->key.c_str());
+}
+
+void Logger::log(LogLevel level, const std::string &msg) {
+    if (level >= LogLevel::Warning && enabled(level) && !admitPlain(level, msg)) return;
+    emit(level, msg, nullptr);
+}
+
+void Logger::log(LogLevel level, std::string &&msg) {
+    if (level >= LogLevel::Warning && enabled(level) && !admitPlain(level, msg)) return;
+    emit(level, msg, &msg);
+}
+
+// movable != nullptr：async 模式可以直接把字串 move 進 queue，不用再複製
+void Logger::emit(LogLevel level, const std::string &msg, std::string *movable) {
+    if (level < level_.load(std::memory_order_relaxed)) return;
+
+    if (binary_.load(std::memory_order_relaxed)) {
+        enqueue(level, plainRecord(level, msg));
+        return;
+    }
+    if (!g_async.load(std::memory_order_acquire)) {
+        std::string outStr;
+        outStr.reserve(msg.size() + 48);
+        appendLine(outStr, level, Clock::now(), msg);
+        std::lock_guard<std::mutex> lk(mtx_);
+        writeOut(outStr);
+        return;
+    }
+    enqueue(level, movable ? std::move(*movable) : std::string(msg));
+}
+
+void Logger::enqueue(LogLevel level, std::string &&payload) {
+    AsyncState *st = g_async.load(std::memory_order_acquire);
+    if (!st) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (binary_.load(std::memory_order_relaxed)) {
+            writeOut(payload);
+        } else {
+            std::string outStr;
+            appendLine(outStr, level, Clock::now(), payload);
+            writeOut(outStr);
+        }
+        return;
+    }
+
+    // 先登記再看 running（都是 seq_cst）：writer 看到 pushers == 0 之後，
+    // 還沒登記的 producer 一定會看到 running == false，算成 dropped，不會塞進沒人收的 queue
+    st->pushers.fetch_add(1);
+    if (!st->running.load()) {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        leave(*st);
+        return;
+    }
+
+    Entry e;
+    e.level = level;
+    e.time  = Clock::now();
+    e.msg   = std::move(payload);
+    while (!st->queue.tryPush(e)) {
+        if (st->opts.overflow == OverflowPolicy::Drop ||
+            !st->running.load(std::memory_order_acquire)) {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+            leave(*st);
+            return;
+        }
+        // Block：叫醒 writer，讓出 CPU 再試
+        wake(*st);
+        std::this_thread::yield();
+    }
+    leave(*st);
+}
+
+void Logger::writerLoop() {
+    AsyncState *st = nullptr;
+    {
+        std::lock_guard<std::mutex> lk(mtx_); // init() 拿著這個鎖建 thread，等它放掉才輪到這裡
+        st = g_asyncStates.back().get();
+    }
+    std::string batch;
+    batch.reserve(st->opts.batchSize * 128);
+    std::uint64_t reportedDrops = g_dropped.load(std::memory_order_relaxed);
+
+    for (;;) {
+        Entry e;
+        std::size_t n = 0;
+        const bool binary = binary_.load(std::memory_order_relaxed);
+        while (n < st->opts.batchSize && st->queue.tryPop(e)) {
+            if (binary) batch.append(e.msg);
+            else appendLine(batch, e.level, e.time, e.msg);
+            ++n;
+        }
+
+        const std::uint64_t drops = g_dropped.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            const std::string note =
+                "logger queue full, dropped " + std::to_string(drops - reportedDrops) + " messages";
+            if (binary) batch.append(plainRecord(LogLevel::Warning, note));
+            else appendLine(batch, LogLevel::Warning, Clock::now(), note);
+            reportedDrops = drops;
+        }
+
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> lk(mtx_);
+            writeOut(batch); // 一個 batch 只寫一次、flush 一次
+            batch.clear();
+            continue;
+        }
+
+        // 還在 push 的 producer 走完、queue 也 drain 完才結束；
+        // 不然等 producer 放東西進來或離開（見 wake()），不要空轉
+        const bool stopping = !st->running.load();
+        if (stopping && st->pushers.load() == 0 && st->queue.empty()) break;
+
+        std::unique_lock<std::mutex> lk(st->wakeMtx);
+        st->sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        st->wakeCv.wait_for(lk, std::chrono::milliseconds(20), [st, stopping] {
+            if (!st->queue.empty()) return true;
+            return stopping ? st->pushers.load() == 0 : !st->running.load();
+        });
+        st->sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
 void Logger::debug(const std::string &msg) { log(LogLevel::Debug, msg); }
 void Logger::info(const std::string &msg)  { log(LogLevel::Info, msg); }
 void Logger::warn(const std::string &msg)  { log(LogLevel::Warning, msg); }
@@ -1,16 +1,63 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <mutex>
 #include <fstream>
 
+#include "BinaryLog.hpp"
+#include "LogFormat.hpp"
+
+// Build-time floor for the HB_LOG_* macros: 0=Debug 1=Info 2=Warning 3=Error.
+// Calls below it compile to nothing (arguments are not evaluated).
+#ifndef HEALTH_LOG_MIN_LEVEL
+#define HEALTH_LOG_MIN_LEVEL 0
+#endif
+
 namespace util {
 
 enum class LogLevel { Debug, Info, Warning, Error };
 
+// What an async producer does when the queue is full.
+enum class OverflowPolicy { Drop, Block };
+
+// Seconds: "2025-01-01 12:00:00", Milliseconds: "2025-01-01 12:00:00.123"
+enum class TimestampPrecision { Seconds, Milliseconds };
+
+// Binary: compact records (format id + raw args) go to the log file only and
+// nothing is printed; read them with tools/log_decode. See BinaryLog.hpp.
+enum class LogEncoding { Text, Binary };
+
+struct LoggerOptions {
+    bool               async          = false; // false: format + write on the calling thread
+    std::size_t        queueCapacity  = 8192;  // rounded up to a power of two
+    OverflowPolicy     overflow       = OverflowPolicy::Drop;
+    std::size_t        batchSize      = 256;   // max lines per write/flush
+    TimestampPrecision precision      = TimestampPrecision::Seconds;
+    LogEncoding        encoding       = LogEncoding::Text;
+    // Token bucket per call site (per message for plain calls) for WARN/ERROR:
+    // `warnBurst` lines at once, then `warnRatePerSec` sustained. 0 disables.
+    double             warnRatePerSec = 1.0;
+    std::size_t        warnBurst      = 10;
+};
+
+// Per-call-site state for the HB_LOG_* macros: the binary format id (assigned
+// on first use) and the WARN/ERROR rate limiter.
+struct LogSite {
+    std::atomic<std::uint32_t> id{0};
+    std::atomic<std::int64_t>  tat{0};        // GCRA "theoretical arrival time", micros
+    std::atomic<std::uint32_t> suppressed{0}; // dropped since the last line that got through
+};
+
 class Logger {
 public:
     static void init(const std::string &filePath, LogLevel level = LogLevel::Info);
+    static void init(const std::string &filePath, LogLevel level, const LoggerOptions &opts);
+    // Async mode: drains the queue, stops the writer thread, then flushes.
     static void shutdown();
 
     static void debug(const std::string &msg);
@@ -18,13 +65,106 @@ public:
     static void warn(const std::string &msg);
     static void error(const std::string &msg);
 
+    // Messages discarded: the async queue was full (Drop policy), or they arrived
+    // while shutdown() was stopping the writer.
+    static std::uint64_t droppedCount();
+
+    static bool enabled(LogLevel level) {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    // Lazy formatting: "{}" placeholders are filled from args only here, after
+    // the level check. Prefer the HB_LOG_* macros, which skip the call entirely.
+    template <typename... Args>
+    static void logf(LogLevel level, const char *fmt, const Args &...args) {
+        if (!enabled(level)) return;
+        if (level >= LogLevel::Warning && !admitPlain(level, fmt)) return; // 限流照 format，不照填好的字串
+        std::string msg;
+        detail::formatTo(msg, fmt, args...);
+        emit(level, msg, &msg);
+    }
+
+    // Same, but binary mode writes the site's format id and the raw args
+    // instead of formatting text.
+    template <typename... Args>
+    static void logf(LogSite &site, LogLevel level, const char *fmt, const Args &...args) {
+        if (!enabled(level)) return;
+        if (level >= LogLevel::Warning && !admit(site.tat, site.suppressed, level, fmt)) return;
+        if (!binary_.load(std::memory_order_relaxed)) {
+            std::string msg;
+            detail::formatTo(msg, fmt, args...);
+            emit(level, msg, &msg);
+            return;
+        }
+        static_assert(sizeof...(Args) < 256, "too many log arguments");
+        std::string rec;
+        binlog::beginEvent(rec, static_cast<std::uint8_t>(level), formatId(site, fmt), nowMicros(),
+                           sizeof...(Args));
+        (binlog::encodeArg(rec, args), ...);
+        enqueue(level, std::move(rec));
+    }
+
 private:
-    static std::string timeStamp();
+    using Clock = std::chrono::system_clock;
+
+    // Prefix "[ts] [LEVEL] " into a fixed buffer; returns its length.
+    static std::size_t formatPrefix(char *buf, LogLevel level, Clock::time_point when);
+    static std::size_t timeStamp(char *buf, Clock::time_point when);
+    static void appendLine(std::string &out, LogLevel level, Clock::time_point when, const std::string &msg);
     static void log(LogLevel level, const std::string &msg);
+    static void log(LogLevel level, std::string &&msg);
+    static void emit(LogLevel level, const std::string &msg, std::string *movable);
+    static void enqueue(LogLevel level, std::string &&payload); // text line body or binary record
+    static std::uint32_t formatId(LogSite &site, const char *fmt);
+    static std::uint64_t nowMicros();
+    static std::string plainRecord(LogLevel level, const std::string &msg);
+    // Token bucket check; logs a "suppressed N" note when a limited key passes again.
+    static bool admit(std::atomic<std::int64_t> &tat, std::atomic<std::uint32_t> &suppressed,
+                      LogLevel level, const char *what);
+    // Same for callers without a LogSite: one bucket per distinct key text (bounded table).
+    static bool admitPlain(LogLevel level, std::string_view key);
+    static void writeOut(const std::string &text); // stdout + file, caller holds mtx_
+    static void writerLoop();
 
     static std::mutex mtx_;
     static std::ofstream out_;    // optional file
-    static LogLevel level_;
+    static std::atomic<LogLevel> level_;
+    static std::atomic<bool> binary_;
+    static std::uint32_t nextFormatId_; // guarded by mtx_
 };
 
 } // namespace util
+
+#define HB_LOG_AT(lvl, ...)                                  \
+    do {                                                     \
+        if (::util::Logger::enabled(lvl)) {                  \
+            static ::util::LogSite hbLogSite_;               \
+            ::util::Logger::logf(hbLogSite_, lvl, __VA_ARGS__); \
+        }                                                    \
+    } while (0)
+
+// 低於 HEALTH_LOG_MIN_LEVEL 的呼叫只做型別檢查，不會產生任何程式碼
+#define HB_LOG_DISABLED(lvl, ...)                            \
+    do {                                                     \
+        if (false) ::util::Logger::logf(lvl, __VA_ARGS__);   \
+    } while (0)
+
+#if HEALTH_LOG_MIN_LEVEL <= 0
+#define HB_LOG_DEBUG(...) HB_LOG_AT(::util::LogLevel::Debug, __VA_ARGS__)
+#else
+#define HB_LOG_DEBUG(...) HB_LOG_DISABLED(::util::LogLevel::Debug, __VA_ARGS__)
+#endif
+
+#if HEALTH_LOG_MIN_LEVEL <= 1
+#define HB_LOG_INFO(...) HB_LOG_AT(::util::LogLevel::Info, __VA_ARGS__)
+#else
+#define HB_LOG_INFO(...) HB_LOG_DISABLED(::util::LogLevel::Info, __VA_ARGS__)
+#endif
+
+#if HEALTH_LOG_MIN_LEVEL <= 2
+#define HB_LOG_WARN(...) HB_LOG_AT(::util::LogLevel::Warning, __VA_ARGS__)
+#else
+#define HB_LOG_WARN(...) HB_LOG_DISABLED(::util::LogLevel::Warning, __VA_ARGS__)
+#endif
+
+#define HB_LOG_ERROR(...) HB_LOG_AT(::util::LogLevel::Error, __VA_ARGS__)
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+
+namespace util {
+
+// 唯讀 mmap（RAII）。空檔案也算成功，data() 是 nullptr、size() 是 0。
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { reset(); }
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // false 時 errno 保留給呼叫端判斷（ENOENT = 檔案不存在）
+    bool open(const std::string &path) {
+        reset();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st {};
+        if (fstat(fd, &st) != 0) return closeWithErrno(fd);
+        const std::size_t size = static_cast<std::size_t>(st.st_size);
+        if (size > 0) {
+            void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) return closeWithErrno(fd);
+            data_ = static_cast<const char *>(p);
+        }
+        size_ = size;
+        ::close(fd); // mapping 不需要 fd 一直開著
+        return true;
+    }
+
+    void reset() {
+        if (data_) munmap(const_cast<char *>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char *data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+    // 讀完、暫時不會再用的範圍還給 kernel（不算在 RSS 裡）；之後再讀會從 page cache 重新對應，內容不變
+    void release(std::size_t offset, std::size_t length) const {
+        const std::size_t page  = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        const std::size_t begin = (offset + page - 1) / page * page; // 只放整頁，頭尾不完整的頁留著
+        const std::size_t end   = (offset + length) / page * page;
+        if (!data_ || end <= begin) return;
+        madvise(const_cast<char *>(data_) + begin, end - begin, MADV_DONTNEED);
+    }
+
+private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+
+    static bool closeWithErrno(int fd) {
+        const int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return false;
+    }
+};
+
+} // namespace util
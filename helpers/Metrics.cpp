@@ -0,0 +1,242 @@
+#include "Metrics.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+namespace util {
+
+// ----------------------
+// LatencyHistogram
+// ----------------------
+
+std::size_t LatencyHistogram::bucketOf(std::uint64_t micros) {
+    if (micros < kSubBuckets) return static_cast<std::size_t>(micros);
+    int exp = 63 - __builtin_clzll(micros);
+    if (exp > kMaxExp) {
+        return kBuckets - 1; // 太大就塞最後一格
+    }
+    const auto sub = static_cast<std::size_t>(micros >> (exp - kSubBits)) - kSubBuckets;
+    return static_cast<std::size_t>(exp - kSubBits + 1) * kSubBuckets + sub;
+}
+
+std::uint64_t LatencyHistogram::bucketUpper(std::size_t idx) {
+    if (idx < kSubBuckets) return idx;
+    const std::size_t block = idx / kSubBuckets;
+    const std::size_t sub   = idx % kSubBuckets;
+    const int         shift = static_cast<int>(block) - 1;
+    const std::uint64_t lower = static_cast<std::uint64_t>(kSubBuckets + sub) << shift;
+    return lower + (std::uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t micros) {
+    buckets_[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(micros, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        const std::uint64_t n = other.buckets_[i].load(std::memory_order_relaxed);
+        if (n) buckets_[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    count_.fetch_add(other.count(), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum(), std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::countAtOrBelow(std::uint64_t micros) const {
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < kBuckets && bucketUpper(i) <= micros; ++i) {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::uint64_t LatencyHistogram::quantile(double q) const {
+    std::uint64_t snapshot[kBuckets];
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        snapshot[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+    if (total == 0) return 0;
+
+    auto target = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(total)));
+    if (target == 0) target = 1;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += snapshot[i];
+        if (seen >= target) return bucketUpper(i);
+    }
+    return bucketUpper(kBuckets - 1);
+}
+
+// ----------------------
+// HttpMetrics
+// ----------------------
+
+namespace {
+
+void splitPath(std::string_view path, std::vector<std::string_view> &out) {
+    out.clear();
+    std::size_t pos = 0;
+    while (pos < path.size()) {
+        if (path[pos] == '/') {
+            ++pos;
+            continue;
+        }
+        std::size_t next = path.find('/', pos);
+        if (next == std::string_view::npos) next = path.size();
+        out.push_back(path.substr(pos, next - pos));
+        pos = next;
+    }
+}
+
+void appendSeconds(std::string &out, std::uint64_t micros) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.6f", static_cast<double>(micros) / 1e6);
+    out += buf;
+}
+
+} // namespace
+
+HttpMetrics::HttpMetrics() {
+    // 沒有對到任何 route 的 request 都算在這裡
+    auto other     = std::make_unique<Route>();
+    other->method  = "*";
+    other->pattern = "other";
+    routes_.push_back(std::move(other));
+    other_ = 0;
+}
+
+std::size_t HttpMetrics::addRoute(const std::string &method, const std::string &pattern) {
+    auto r     = std::make_unique<Route>();
+    r->method  = method;
+    r->pattern = pattern;
+    std::vector<std::string_view> segs;
+    splitPath(pattern, segs);
+    for (auto s : segs) r->segments.emplace_back(s);
+    routes_.push_back(std::move(r));
+    return routes_.size() - 1;
+}
+
+std::size_t HttpMetrics::match(std::string_view method, std::string_view path) const {
+    thread_local std::vector<std::string_view> segs;
+    splitPath(path, segs);
+
+    for (std::size_t i = 0; i < routes_.size(); ++i) {
+        if (i == other_) continue;
+        const Route &r = *routes_[i];
+        if (r.method != method || r.segments.size() != segs.size()) continue;
+        bool ok = true;
+        for (std::size_t k = 0; k < segs.size() && ok; ++k) {
+            const std::string &want = r.segments[k];
+            ok = (!want.empty() && want[0] == ':') || want == segs[k];
+        }
+        if (ok) return i;
+    }
+    return other_;
+}
+
+std::size_t HttpMetrics::statusSlot(int status) {
+    for (std::size_t i = 0; i + 1 < kStatusSlots; ++i) {
+        if (kStatusCodes[i] == status) return i;
+    }
+    return kStatusSlots - 1;
+}
+
+void HttpMetrics::record(std::size_t route, int status, std::uint64_t micros) {
+    if (route >= routes_.size()) route = other_;
+    Route &r = *routes_[route];
+    r.statusCounts[statusSlot(status)].fetch_add(1, std::memory_order_relaxed);
+    r.latency.record(micros);
+}
+
+void HttpMetrics::appendGauge(std::string &out, const char *name, const char *help, double value) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.17g", value);
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " gauge\n";
+    out += name;
+    out += ' ';
+    out += buf;
+    out += '\n';
+}
+
+void HttpMetrics::appendCounter(std::string &out, const char *name, const char *help, std::uint64_t value) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " counter\n";
+    out += name;
+    out += ' ';
+    out += std::to_string(value);
+    out += '\n';
+}
+
+void HttpMetrics::appendHistogram(std::string &out, const char *name, const std::string &labels,
+                                  const LatencyHistogram &h) {
+    const std::uint64_t count = h.count();
+    const std::string   base  = name;
+    // le 取 2 的次方 microseconds（32us ~ 67s），剛好對齊 histogram 的 bucket 邊界
+    for (int k = 5; k <= 26; ++k) {
+        const std::uint64_t bound = std::uint64_t{1} << k;
+        out += base + "_bucket{" + labels + ",le=\"";
+        appendSeconds(out, bound);
+        out += "\"} " + std::to_string(h.countAtOrBelow(bound - 1)) + "\n";
+    }
+    out += base + "_bucket{" + labels + ",le=\"+Inf\"} " + std::to_string(count) + "\n";
+    out += base + "_sum{" + labels + "} ";
+    appendSeconds(out, h.sum());
+    out += "\n";
+    out += base + "_count{" + labels + "} " + std::to_string(count) + "\n";
+}
+
+void HttpMetrics::renderPrometheus(std::string &out) const {
+    out += "# HELP health_http_requests_total HTTP requests by route and status.\n";
+    out += "# TYPE health_http_requests_total counter\n";
+    for (const auto &rp : routes_) {
+        const Route &r = *rp;
+        for (std::size_t s = 0; s < kStatusSlots; ++s) {
+            const std::uint64_t n = r.statusCounts[s].load(std::memory_order_relaxed);
+            if (n == 0) continue;
+            out += "health_http_requests_total{method=\"" + r.method + "\",route=\"" + r.pattern + "\",status=\"";
+            out += s + 1 < kStatusSlots ? std::to_string(kStatusCodes[s]) : std::string("other");
+            out += "\"} " + std::to_string(n) + "\n";
+        }
+    }
+
+    out += "# HELP health_http_request_duration_seconds HTTP request latency (microsecond resolution).\n";
+    out += "# TYPE health_http_request_duration_seconds histogram\n";
+    for (const auto &rp : routes_) {
+        const Route &r = *rp;
+        if (r.latency.count() == 0) continue;
+        appendHistogram(out, "health_http_request_duration_seconds",
+                        "method=\"" + r.method + "\",route=\"" + r.pattern + "\"", r.latency);
+    }
+
+    out += "# HELP health_http_request_duration_quantile_seconds Latency quantiles from the HDR histogram.\n";
+    out += "# TYPE health_http_request_duration_quantile_seconds gauge\n";
+    static const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+    for (const auto &rp : routes_) {
+        const Route &r = *rp;
+        if (r.latency.count() == 0) continue;
+        for (double q : kQuantiles) {
+            char qbuf[16];
+            std::snprintf(qbuf, sizeof(qbuf), "%g", q);
+            out += "health_http_request_duration_quantile_seconds{method=\"" + r.method + "\",route=\"" +
+                   r.pattern + "\",quantile=\"" + qbuf + "\"} ";
+            appendSeconds(out, r.latency.quantile(q));
+            out += "\n";
+        }
+    }
+}
+
+} // namespace util
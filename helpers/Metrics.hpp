@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace util {
+
+// HDR-style log-linear histogram of microsecond values.
+// Each power of two is split into 16 linear sub-buckets, so any recorded value
+// is off by at most 1/16 (6.25%). record() is a few atomic adds, no locks.
+class LatencyHistogram {
+public:
+    static constexpr int         kSubBits    = 4;
+    static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBits;
+    static constexpr int         kMaxExp     = 40; // ~12.7 days in micros; larger values clamp
+    static constexpr std::size_t kBuckets    = (kMaxExp - kSubBits + 2) * kSubBuckets;
+
+    void record(std::uint64_t micros);
+    // Adds another histogram's counts (e.g. per-op -> overall).
+    void merge(const LatencyHistogram &other);
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+    // Values at or below `micros` (exact when micros + 1 is a power of two, otherwise
+    // rounded down to the enclosing bucket).
+    std::uint64_t countAtOrBelow(std::uint64_t micros) const;
+    // Upper bound of the bucket holding the q-quantile (0 when empty).
+    std::uint64_t quantile(double q) const;
+
+    static std::size_t   bucketOf(std::uint64_t micros);
+    static std::uint64_t bucketUpper(std::size_t idx); // largest value in bucket idx
+
+private:
+    std::atomic<std::uint64_t> buckets_[kBuckets] = {};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+};
+
+// Per-route, per-status request counters and latency histograms for GET /metrics.
+// Routes are registered once at startup ("GET", "/waters/:id"); after that
+// match() and record() are lock-free and safe from any thread.
+class HttpMetrics {
+public:
+    HttpMetrics();
+
+    // Not thread-safe: call before the server starts. ':' segments are wildcards.
+    std::size_t addRoute(const std::string &method, const std::string &pattern);
+
+    // Index of the first registered route matching method + path ("other" if none).
+    std::size_t match(std::string_view method, std::string_view path) const;
+
+    void record(std::size_t route, int status, std::uint64_t micros);
+
+    // Prometheus text exposition format (version 0.0.4).
+    void renderPrometheus(std::string &out) const;
+
+    // "# HELP/# TYPE" + one sample; for gauges supplied by the caller.
+    static void appendGauge(std::string &out, const char *name, const char *help, double value);
+    static void appendCounter(std::string &out, const char *name, const char *help, std::uint64_t value);
+    // _bucket/_sum/_count lines of one histogram series (no HELP/TYPE); labels like `stage="parse"`.
+    static void appendHistogram(std::string &out, const char *name, const std::string &labels,
+                                const LatencyHistogram &h);
+
+private:
+    // 常見的 status code 各有一格，其他的算 "other"
+    static constexpr int         kStatusCodes[] = {200, 201, 204, 304, 400, 401, 403, 404,
+                                                   405, 409, 413, 429, 500, 503};
+    static constexpr std::size_t kStatusSlots   = sizeof(kStatusCodes) / sizeof(kStatusCodes[0]) + 1;
+
+    static std::size_t statusSlot(int status);
+
+    struct Route {
+        std::string                      method;
+        std::string                      pattern;
+        std::vector<std::string>         segments;
+        std::atomic<std::uint64_t>       statusCounts[kStatusSlots] = {};
+        LatencyHistogram                 latency;
+    };
+
+    std::vector<std::unique_ptr<Route>> routes_;
+    std::size_t                         other_ = 0;
+};
+
+} // namespace util
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// 會算名次的排序集合（order-statistic treap）：每個 node 記住 subtree 有幾個 key。
+//   insert / erase / rank（前面有幾個）都是 O(log n)，前 k 名是 O(log n + k)。
+// 排行榜這種「一直有人分數變動、要問第幾名」的情況，不用每次整個重排。
+//
+// key 不能重複（Less 要分得出任兩個 key，例如分數一樣再比名字）。
+// nodes 放在一個 vector 裡用 index 串起來，刪掉的 node 留給下一次 insert 用。
+template <typename Key, typename Less>
+class RankTree {
+public:
+    explicit RankTree(Less less = Less()) : less_(std::move(less)) {}
+
+    std::size_t size() const { return size(root_); }
+    bool        empty() const { return root_ == kNil; }
+
+    void clear() {
+        std::vector<Node>().swap(nodes_);
+        free_ = kNil;
+        root_ = kNil;
+    }
+
+    void insert(const Key &key) { root_ = insert(root_, newNode(key)); }
+
+    // false = 沒有這個 key
+    bool erase(const Key &key) {
+        bool found = false;
+        root_      = erase(root_, key, found);
+        return found;
+    }
+
+    // 排在 key 前面的有幾個（key 本身在不在都可以）；在的話它是第 rank + 1 名
+    std::size_t rank(const Key &key) const {
+        std::size_t before = 0;
+        for (std::uint32_t t = root_; t != kNil;) {
+            if (less_(nodes_[t].key, key)) {
+                before += size(nodes_[t].left) + 1;
+                t = nodes_[t].right;
+            } else {
+                t = nodes_[t].left;
+            }
+        }
+        return before;
+    }
+
+    // 排在最前面的 k 個，照順序
+    std::vector<Key> first(std::size_t k) const {
+        std::vector<Key> out;
+        out.reserve(k < size() ? k : size());
+        std::vector<std::uint32_t> path; // 還沒輸出的祖先（in-order 走訪）
+        for (std::uint32_t t = root_; out.size() < k && (t != kNil || !path.empty());) {
+            if (t != kNil) {
+                path.push_back(t);
+                t = nodes_[t].left;
+                continue;
+            }
+            t = path.back();
+            path.pop_back();
+            out.push_back(nodes_[t].key);
+            t = nodes_[t].right;
+        }
+        return out;
+    }
+
+private:
+    static constexpr std::uint32_t kNil = UINT32_MAX;
+
+    struct Node {
+        Key           key;
+        std::uint32_t left;
+        std::uint32_t right;
+        std::uint32_t size;     // subtree 的 node 數
+        std::uint32_t priority; // heap 順序（大的在上），隨機的所以期望深度 O(log n)
+    };
+
+    std::uint32_t size(std::uint32_t t) const { return t == kNil ? 0 : nodes_[t].size; }
+
+    void pull(std::uint32_t t) { nodes_[t].size = size(nodes_[t].left) + size(nodes_[t].right) + 1; }
+
+    std::uint32_t newNode(const Key &key) {
+        // xorshift32：只要分散，不用好的亂數
+        seed_ ^= seed_ << 13;
+        seed_ ^= seed_ >> 17;
+        seed_ ^= seed_ << 5;
+        const Node node{key, kNil, kNil, 1, seed_};
+        if (free_ != kNil) {
+            const std::uint32_t t = free_;
+            free_                 = nodes_[t].left;
+            nodes_[t]             = node;
+            return t;
+        }
+        nodes_.push_back(node);
+        return static_cast<std::uint32_t>(nodes_.size() - 1);
+    }
+
+    // t 拆成 (< key, >= key)
+    std::pair<std::uint32_t, std::uint32_t> split(std::uint32_t t, const Key &key) {
+        if (t == kNil) return {kNil, kNil};
+        if (less_(nodes_[t].key, key)) {
+            auto [l, r]     = split(nodes_[t].right, key);
+            nodes_[t].right = l;
+            pull(t);
+            return {t, r};
+        }
+        auto [l, r]    = split(nodes_[t].left, key);
+        nodes_[t].left = r;
+        pull(t);
+        return {l, t};
+    }
+
+    // a 的 key 全都排在 b 前面
+    std::uint32_t merge(std::uint32_t a, std::uint32_t b) {
+        if (a == kNil) return b;
+        if (b == kNil) return a;
+        if (nodes_[a].priority > nodes_[b].priority) {
+            nodes_[a].right = merge(nodes_[a].right, b);
+            pull(a);
+            return a;
+        }
+        nodes_[b].left = merge(a, nodes_[b].left);
+        pull(b);
+        return b;
+    }
+
+    std::uint32_t insert(std::uint32_t t, std::uint32_t node) {
+        if (t == kNil) return node;
+        if (nodes_[node].priority > nodes_[t].priority) {
+            auto [l, r]        = split(t, nodes_[node].key);
+            nodes_[node].left  = l;
+            nodes_[node].right = r;
+            pull(node);
+            return node;
+        }
+        if (less_(nodes_[node].key, nodes_[t].key)) {
+            nodes_[t].left = insert(nodes_[t].left, node);
+        } else {
+            nodes_[t].right = insert(nodes_[t].right, node);
+        }
+        pull(t);
+        return t;
+    }
+
+    std::uint32_t erase(std::uint32_t t, const Key &key, bool &found) {
+        if (t == kNil) return kNil;
+        if (less_(key, nodes_[t].key)) {
+            nodes_[t].left = erase(nodes_[t].left, key, found);
+        } else if (less_(nodes_[t].key, key)) {
+            nodes_[t].right = erase(nodes_[t].right, key, found);
+        } else {
+            found                 = true;
+            const std::uint32_t m = merge(nodes_[t].left, nodes_[t].right);
+            nodes_[t].left        = free_;
+            free_                 = t;
+            return m;
+        }
+        pull(t);
+        return t;
+    }
+
+    Less              less_;
+    std::vector<Node> nodes_;
+    std::uint32_t     root_ = kNil;
+    std::uint32_t     free_ = kNil; // 刪掉的 nodes 用 left 串起來
+    std::uint32_t     seed_ = 2463534242u;
+};
+
+} // namespace util
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SortedVector.hpp"
+
+namespace util {
+
+// 一串 records 的第二個順序：位置（index）照 key 由大到小排，key 一樣的照位置。
+// records 本身的順序（日期 / 加入的先後）不動，前 k 名直接是 entries() 的前 k 筆。
+//
+// key 改了、records 中間插入 / 刪除 / 搬動，都要告訴 index：位置在後面的 entries 跟著平移，
+// 是 O(n) 的整數運算（entries 只有 8 bytes），比每次整串重排便宜很多。
+class RankedIndex {
+public:
+    struct Entry {
+        std::int32_t  key;
+        std::uint32_t pos;
+    };
+
+    // 整串重建：keys[i] 是第 i 筆的 key
+    template <typename Keys>
+    void build(const Keys &keys) {
+        entries_.clear();
+        entries_.reserve(keys.size());
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            entries_.push_back(Entry{static_cast<std::int32_t>(keys[i]), static_cast<std::uint32_t>(i)});
+        }
+        std::sort(entries_.begin(), entries_.end(), before);
+    }
+
+    void clear() { std::vector<Entry>().swap(entries_); }
+
+    const std::vector<Entry> &entries() const { return entries_; }
+    std::size_t               size() const { return entries_.size(); }
+    std::size_t               capacity() const { return entries_.capacity(); }
+
+    // 在 pos 插入一筆（原本 pos 以後的往後移一格）；pos == size() 是接在最後，不用平移
+    void insert(std::size_t pos, std::int32_t key) {
+        if (pos < entries_.size()) shift(pos, entries_.size(), +1);
+        insertSorted(entries_, Entry{key, static_cast<std::uint32_t>(pos)}, before);
+    }
+
+    // 刪掉 pos 那一筆（key 是它的 key），後面的往前移一格
+    void erase(std::size_t pos, std::int32_t key) {
+        entries_.erase(find(pos, key));
+        shift(pos + 1, entries_.size() + 1, -1);
+    }
+
+    // pos 那一筆的 key 從 oldKey 改成 newKey
+    void update(std::size_t pos, std::int32_t oldKey, std::int32_t newKey) {
+        auto it = find(pos, oldKey);
+        it->key = newKey;
+        repositionSorted(entries_, static_cast<std::size_t>(it - entries_.begin()), before);
+    }
+
+    // records 裡 from 那一筆搬到 to（中間的跟著平移一格，像 std::rotate）
+    void move(std::size_t from, std::size_t to, std::int32_t key) {
+        if (from == to) return;
+        auto it = find(from, key);
+        if (from < to) {
+            shift(from + 1, to + 1, -1);
+        } else {
+            shift(to, from, +1);
+        }
+        it->pos = static_cast<std::uint32_t>(to);
+        repositionSorted(entries_, static_cast<std::size_t>(it - entries_.begin()), before);
+    }
+
+private:
+    static bool before(const Entry &a, const Entry &b) { return a.key != b.key ? a.key > b.key : a.pos < b.pos; }
+
+    std::vector<Entry>::iterator find(std::size_t pos, std::int32_t key) {
+        return std::lower_bound(entries_.begin(), entries_.end(), Entry{key, static_cast<std::uint32_t>(pos)},
+                                before);
+    }
+
+    // 位置在 [first, last) 的 entries 加 delta；key 的相對順序不變（同 key 的位置一起平移）
+    void shift(std::size_t first, std::size_t last, int delta) {
+        for (auto &e : entries_) {
+            if (e.pos >= first && e.pos < last) e.pos = static_cast<std::uint32_t>(static_cast<int>(e.pos) + delta);
+        }
+    }
+
+    std::vector<Entry> entries_;
+};
+
+} // namespace util
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace util {
+
+// Decides which finished requests get an access-log line.
+// Failing (status >= 400) and slow requests are always kept (tail-based);
+// the rest are sampled at the rate of the longest matching route prefix.
+class RequestSampler {
+public:
+    struct Config {
+        double                                      defaultRate = 1.0;  // 0.0 .. 1.0
+        std::vector<std::pair<std::string, double>> routes;             // path prefix -> rate
+        long                                        slowMs      = 1000; // always log at/above this
+    };
+
+    RequestSampler() = default;
+    explicit RequestSampler(Config cfg) : cfg_(std::move(cfg)) {}
+
+    // "/health=0,/waters=0.1" -> {{"/health",0}, {"/waters",0.1}}
+    static std::vector<std::pair<std::string, double>> parseRoutes(const std::string &spec) {
+        std::vector<std::pair<std::string, double>> out;
+        std::size_t pos = 0;
+        while (pos < spec.size()) {
+            std::size_t comma = spec.find(',', pos);
+            if (comma == std::string::npos) comma = spec.size();
+            const std::string item = spec.substr(pos, comma - pos);
+            const std::size_t eq = item.find('=');
+            if (eq != std::string::npos && eq > 0) {
+                out.emplace_back(item.substr(0, eq), clampRate(std::atof(item.c_str() + eq + 1)));
+            }
+            pos = comma + 1;
+        }
+        return out;
+    }
+
+    static double clampRate(double r) { return r < 0.0 ? 0.0 : (r > 1.0 ? 1.0 : r); }
+
+    const Config &config() const { return cfg_; }
+
+    double rateFor(const std::string &path) const {
+        double      rate    = cfg_.defaultRate;
+        std::size_t bestLen = 0;
+        for (const auto &[prefix, r] : cfg_.routes) {
+            if (prefix.size() >= bestLen && path.compare(0, prefix.size(), prefix) == 0) {
+                rate    = r;
+                bestLen = prefix.size();
+            }
+        }
+        return rate;
+    }
+
+    bool shouldLog(const std::string &path, int status, long durationMs) const {
+        if (status >= 400 || durationMs >= cfg_.slowMs) return true;
+        const double rate = rateFor(path);
+        if (rate >= 1.0) return true;
+        if (rate <= 0.0) return false;
+        return nextUnit() < rate;
+    }
+
+    // [0, 1) 亂數；每個 thread 一個 splitmix64，不用鎖（Trace 取樣也用這個）
+    static double nextUnit() {
+        thread_local std::uint64_t state =
+            static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+            reinterpret_cast<std::uintptr_t>(&state);
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        return static_cast<double>(z >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+private:
+    Config cfg_;
+};
+
+} // namespace util
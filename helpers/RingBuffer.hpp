@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace util {
+
+// Bounded multi-producer / single-consumer ring buffer.
+// Every slot carries a sequence number (Vyukov-style), so producers only
+// contend on one CAS of head_ and never take a lock. tryPush() returns false
+// when the buffer is full; the caller decides whether to drop or retry.
+template <typename T>
+class MpscRingBuffer {
+public:
+    explicit MpscRingBuffer(std::size_t capacity) {
+        std::size_t cap = 2;
+        while (cap < capacity) cap <<= 1;   // 一定要是 2 的次方，才能用 mask
+        mask_  = cap - 1;
+        slots_ = std::unique_ptr<Slot[]>(new Slot[cap]);
+        for (std::size_t i = 0; i < cap; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRingBuffer(const MpscRingBuffer&)            = delete;
+    MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // Producer side (any thread). `value` is only moved from on success.
+    bool tryPush(T& value) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            const std::size_t seq = slot.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side (single thread only).
+    bool tryPop(T& out) {
+        Slot& slot = slots_[tail_ & mask_];
+        const std::size_t seq = slot.seq.load(std::memory_order_acquire);
+        if (static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(tail_ + 1) < 0) {
+            return false; // empty (or producer still writing this slot)
+        }
+        out = std::move(slot.value);
+        slot.seq.store(tail_ + mask_ + 1, std::memory_order_release);
+        ++tail_;
+        return true;
+    }
+
+    // Consumer side only: true if the next slot has not been published yet.
+    bool empty() const {
+        const Slot& slot = slots_[tail_ & mask_];
+        return slot.seq.load(std::memory_order_acquire) != tail_ + 1;
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> seq{0};
+        T                        value{};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t             mask_ = 0;
+
+    alignas(64) std::atomic<std::size_t> head_{0}; // producers
+    alignas(64) std::size_t              tail_ = 0; // consumer
+};
+
+} // namespace util
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// 保持排序的 vector：加一筆 / 改一筆不用整個重排（每次 std::sort 是 O(n log n)）。
+// 一樣大的放在既有的後面，所以同一天的 records 維持加入的先後。
+namespace util {
+
+// 插入 value，回傳它的位置。不比最後一筆小就直接接在後面（照時間順序記錄的常見情況）
+template <typename T, typename Less>
+std::size_t insertSorted(std::vector<T> &vec, T value, Less less) {
+    if (vec.empty() || !less(value, vec.back())) {
+        vec.push_back(std::move(value));
+        return vec.size() - 1;
+    }
+    auto pos = std::upper_bound(vec.begin(), vec.end(), value, less);
+    pos      = vec.insert(pos, std::move(value));
+    return static_cast<std::size_t>(pos - vec.begin());
+}
+
+// vec[index] 改過之後把它移回該在的位置（只移動中間那一段），回傳新的位置；其他的本來就是排好的
+template <typename T, typename Less>
+std::size_t repositionSorted(std::vector<T> &vec, std::size_t index, Less less) {
+    const auto it = vec.begin() + static_cast<std::ptrdiff_t>(index);
+    if (it != vec.begin() && less(*it, *std::prev(it))) {
+        const auto to = std::upper_bound(vec.begin(), it, *it, less);
+        std::rotate(to, it, std::next(it));
+        return static_cast<std::size_t>(to - vec.begin());
+    }
+    if (std::next(it) != vec.end() && less(*std::next(it), *it)) {
+        const auto to = std::upper_bound(std::next(it), vec.end(), *it, less);
+        std::rotate(it, std::next(it), to);
+        return static_cast<std::size_t>(to - vec.begin()) - 1;
+    }
+    return index;
+}
+
+// 一次加一批：這批自己排一次（本來就排好的話不用排），再跟原本的合併，O(n + m log m)
+template <typename T, typename Less>
+void appendSorted(std::vector<T> &vec, std::vector<T> more, Less less) {
+    if (!std::is_sorted(more.begin(), more.end(), less)) std::stable_sort(more.begin(), more.end(), less);
+    const auto mid = static_cast<std::ptrdiff_t>(vec.size());
+    if (vec.empty()) {
+        vec = std::move(more);
+        return;
+    }
+    vec.insert(vec.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+    std::inplace_merge(vec.begin(), vec.begin() + mid, vec.end(), less);
+}
+
+} // namespace util
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+class Symbol;
+
+// Symbol 的 id 本身，不擁有字串（Symbol 之於 SymbolRef，就像 std::string 之於 std::string_view）。
+// trivially copyable，給大量複製、搬動的 records 放（ActivityRecord::intensity）：vector 變大、排序、erase 都是 memcpy。
+// str() 要在有人替這個 id 留著 reference 的時候才有效：permanent() 的一直有效，
+// 其他的由存它的地方另外留一個 Symbol（見 HealthBackend::UserData::intensities）
+class SymbolRef {
+public:
+    SymbolRef() = default;
+
+    // id 要是 id() 拿到的值（ColdTier、PackedDateTime 之類只在記憶體裡存 id 的地方用）；不會多留 reference
+    static SymbolRef fromId(std::uint32_t id) {
+        SymbolRef r;
+        r.id_ = id;
+        return r;
+    }
+
+    inline const std::string &str() const;
+    // 不是連續的編號（最低的 bit 是「有算 reference」），只拿來存 / 交給 fromId
+    std::uint32_t id() const { return id_; }
+    bool          empty() const { return index() == 0; }
+    // true = 不用替它留 reference（permanent() 拿到的字串，或空字串）
+    bool          permanent() const { return !(id_ & kCounted); }
+
+    // 比的是表裡的位置：同一個字串在 permanent() 之前、之後拿到的也相等。
+    // 照位置排不是字母順序（位置會重複使用，順序沒有意義）；要照名字排序的地方自己比 str()
+    friend bool operator==(SymbolRef a, SymbolRef b) { return a.index() == b.index(); }
+    friend bool operator!=(SymbolRef a, SymbolRef b) { return a.index() != b.index(); }
+    friend bool operator<(SymbolRef a, SymbolRef b) { return a.index() < b.index(); }
+
+private:
+    friend class Symbol;
+
+    // id_ = 表裡的位置 << 1 | kCounted。permanent 的字串沒有 kCounted：Symbol 複製 / 解構只多一個 branch，不用碰表
+    static constexpr std::uint32_t kCounted = 1;
+
+    std::uint32_t index() const { return id_ >> 1; }
+
+    std::uint32_t id_ = 0;
+};
+
+// 一直重複的字串（activity 的 intensity、category 名）整個行程只存一份，records 裡只放 4-byte 的 id。
+// 比較、當 map key、group by 都用 id；要輸出（JSON、snapshot）的時候才用 str() 拿字串。
+//
+// 有 reference count：Symbol 跟 shared_ptr 一樣，複製 +1、解構 -1，最後一個不見時字串就釋放，
+// id 之後給別的字串用。所以 client 送來的任意字串可以直接 intern，刪掉 record / category 就還回去。
+// 常用的值用 permanent() 固定住：永遠不釋放，複製 / 解構也不用動 counter（多個 thread 一起複製
+// 同一個 symbol 不會搶同一條 cache line）。位置 0 固定是空字串（也是 permanent），預設建構的 Symbol 就是它。
+class Symbol {
+public:
+    Symbol() = default;
+    // 表滿了（同時活著 16M 個字串）丟 std::length_error；不想丟的話用 tryIntern
+    explicit Symbol(std::string_view s) {
+        std::uint32_t index;
+        if (!table().intern(s, index)) throw std::length_error("util::Symbol table is full");
+        ref_.id_ = handle(index);
+    }
+
+    Symbol(const Symbol &o) noexcept : ref_(o.ref_) { acquire(ref_); }
+    Symbol(Symbol &&o) noexcept : ref_(o.ref_) { o.ref_ = SymbolRef(); }
+    Symbol &operator=(const Symbol &o) noexcept {
+        acquire(o.ref_); // 先 +1 再 -1，自己指定給自己也不會先被釋放
+        release(ref_);
+        ref_ = o.ref_;
+        return *this;
+    }
+    Symbol &operator=(Symbol &&o) noexcept {
+        std::swap(ref_, o.ref_);
+        return *this;
+    }
+    ~Symbol() { release(ref_); }
+
+    // 表滿了回傳 false（out 不變），讓呼叫的人當成一般的失敗處理
+    static bool tryIntern(std::string_view s, Symbol &out) {
+        std::uint32_t index;
+        if (!table().intern(s, index)) return false;
+        out.reset(index);
+        return true;
+    }
+
+    // 只查不加：沒 intern 過就回傳 false（查詢用的名字不存在的話，不必為它佔一個 id）
+    static bool find(std::string_view s, Symbol &out) {
+        std::uint32_t index;
+        if (!table().find(s, index)) return false;
+        out.reset(index);
+        return true;
+    }
+
+    // intern 並且永遠不釋放（常用的固定值；表滿了丟 std::length_error）
+    static Symbol permanent(std::string_view s) {
+        Symbol sym(s);
+        table().pin(sym.ref_.index());
+        sym.ref_.id_ &= ~SymbolRef::kCounted; // intern 加的那一個 reference 不用還了
+        return sym;
+    }
+
+    // 這個 Symbol 還在的時候 str() 都有效
+    operator SymbolRef() const { return ref_; }
+
+    const std::string &str() const { return ref_.str(); }
+    std::uint32_t      id() const { return ref_.id(); }
+    bool               empty() const { return ref_.empty(); }
+    bool               permanent() const { return ref_.permanent(); }
+
+    // 表裡現在有幾個字串（含空字串）
+    static std::size_t count() { return table().size(); }
+
+    // 跟 SymbolRef 一樣比表裡的位置；Symbol 跟 SymbolRef 混著比走 SymbolRef 的版本（map 用 std::less<> 查）
+    friend bool operator==(const Symbol &a, const Symbol &b) { return a.ref_ == b.ref_; }
+    friend bool operator!=(const Symbol &a, const Symbol &b) { return a.ref_ != b.ref_; }
+    friend bool operator<(const Symbol &a, const Symbol &b) { return a.ref_ < b.ref_; }
+
+private:
+    friend class SymbolRef;
+
+    static std::uint32_t handle(std::uint32_t index) {
+        return index << 1 | (table().pinned(index) ? 0 : SymbolRef::kCounted);
+    }
+    static void acquire(SymbolRef r) {
+        if (!r.permanent()) table().acquire(r.index());
+    }
+    static void release(SymbolRef r) {
+        if (!r.permanent()) table().release(r.index());
+    }
+
+    // 接手 table 已經替這個位置加過的那一個 reference
+    void reset(std::uint32_t index) {
+        release(ref_);
+        ref_.id_ = handle(index);
+    }
+
+    // 字串放在固定大小的 chunk 裡，位址不會變：at() 不用上鎖（拿著 Symbol 的人保證 count > 0，
+    // 字串不會在讀的時候被釋放）；intern / find / 釋放用 shared_mutex 保護 index 和空出來的位置。這裡的 id 都是位置
+    class Table {
+    public:
+        Table() {
+            std::uint32_t empty;
+            intern(std::string_view(), empty);
+            pin(empty);
+        }
+
+        // 成功的話 out 多一個 reference；false = 表滿了
+        bool intern(std::string_view s, std::uint32_t &out) {
+            if (find(s, out)) return true;
+
+            std::unique_lock lock(mutex_);
+            auto             it = index_.find(s);
+            if (it != index_.end()) {
+                out = it->second;
+                acquire(out);
+                return true;
+            }
+
+            std::uint32_t id;
+            if (!free_.empty()) {
+                id = free_.back();
+                free_.pop_back();
+            } else {
+                if (next_ >= kChunks * kChunkSize) return false;
+                id = next_++;
+            }
+            Slot *chunk = chunks_[id / kChunkSize].load(std::memory_order_relaxed);
+            if (!chunk) {
+                owned_[id / kChunkSize] = std::make_unique<Slot[]>(kChunkSize);
+                chunk                   = owned_[id / kChunkSize].get();
+                chunks_[id / kChunkSize].store(chunk, std::memory_order_release);
+            }
+            Slot &slot = chunk[id % kChunkSize];
+            slot.text.assign(s.data(), s.size());
+            slot.refs.store(1, std::memory_order_relaxed);
+            index_.emplace(std::string_view(slot.text), id);
+            out = id;
+            return true;
+        }
+
+        // 找到的話 id 多一個 reference。count 已經掉到 0、還沒釋放的也算（釋放的時候會再看一次 count）
+        bool find(std::string_view s, std::uint32_t &id) {
+            std::shared_lock lock(mutex_);
+            auto             it = index_.find(s);
+            if (it == index_.end()) return false;
+            id = it->second;
+            acquire(id);
+            return true;
+        }
+
+        void acquire(std::uint32_t id) {
+            std::atomic<std::uint32_t> &refs = slot(id).refs;
+            std::uint32_t               n    = refs.load(std::memory_order_relaxed);
+            while (n != kPinned && !refs.compare_exchange_weak(n, n + 1, std::memory_order_relaxed)) {
+            }
+        }
+
+        void release(std::uint32_t id) {
+            std::atomic<std::uint32_t> &refs = slot(id).refs;
+            std::uint32_t               n    = refs.load(std::memory_order_relaxed);
+            while (n != kPinned) {
+                if (refs.compare_exchange_weak(n, n - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    if (n == 1) reclaim(id);
+                    return;
+                }
+            }
+        }
+
+        // 呼叫的人要拿著一個 reference
+        void pin(std::uint32_t id) { slot(id).refs.store(kPinned, std::memory_order_relaxed); }
+        bool pinned(std::uint32_t id) const { return slot(id).refs.load(std::memory_order_relaxed) == kPinned; }
+
+        const std::string &at(std::uint32_t id) const { return slot(id).text; }
+
+        std::size_t size() const {
+            std::shared_lock lock(mutex_);
+            return index_.size();
+        }
+
+    private:
+        static constexpr std::uint32_t kChunkSize = 1024;
+        static constexpr std::uint32_t kChunks    = 16384;      // 同時最多 16M 個字串
+        static constexpr std::uint32_t kPinned    = UINT32_MAX; // refs 是這個值 = 永遠不釋放
+
+        struct Slot {
+            std::string                text;
+            std::atomic<std::uint32_t> refs{0};
+        };
+
+        Slot &slot(std::uint32_t id) const {
+            return chunks_[id / kChunkSize].load(std::memory_order_acquire)[id % kChunkSize];
+        }
+
+        // count 掉到 0 之後：在 unique lock 底下再確認一次（中間可能被 find 撿回去，
+        // 或已經被另一個 reclaim 釋放、給了別的字串），才把字串和 id 還回去
+        void reclaim(std::uint32_t id) {
+            std::unique_lock lock(mutex_);
+            Slot            &s = slot(id);
+            if (s.refs.load(std::memory_order_acquire) != 0) return;
+            auto it = index_.find(std::string_view(s.text));
+            if (it == index_.end() || it->second != id) return;
+            index_.erase(it);
+            std::string().swap(s.text);
+            free_.push_back(id);
+        }
+
+        mutable std::shared_mutex                           mutex_;
+        std::unordered_map<std::string_view, std::uint32_t> index_; // key 指向 chunk 裡的字串
+        std::vector<std::uint32_t>                          free_;  // 釋放掉、可以再用的 id
+        std::uint32_t                                       next_ = 0;
+        std::array<std::atomic<Slot *>, kChunks>            chunks_{};
+        std::array<std::unique_ptr<Slot[]>, kChunks>        owned_;
+    };
+
+    // 故意不 delete：static destructor 的順序管不到，行程結束前都還可能有人 str() 或解構 Symbol
+    static Table &table() {
+        static Table *t = new Table;
+        return *t;
+    }
+
+    SymbolRef ref_;
+};
+
+inline const std::string &SymbolRef::str() const { return Symbol::table().at(index()); }
+
+} // namespace util
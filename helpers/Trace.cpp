@@ -0,0 +1,169 @@
+#include "Trace.hpp"
+#include "RequestSampler.hpp"
+#include "../external/json.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace util {
+namespace trace {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+LatencyHistogram g_stages[kStageCount];
+
+const char *const kStageNames[kStageCount] = {"parse", "auth", "mutation", "persist", "serialize"};
+
+std::atomic<double> g_sampleRate{0.0};
+std::mutex          g_fileMtx;
+std::ofstream       g_file;
+bool                g_firstEvent = true;
+const Clock::time_point g_epoch = Clock::now();
+
+// 取樣到的 request 才會累積 event，在 endRequest 一次寫出
+struct Event {
+    Stage         stage;
+    std::uint64_t startMicros;
+    std::uint64_t durMicros;
+};
+
+thread_local Span              *t_current = nullptr;
+thread_local bool               t_sampled = false;
+thread_local Clock::time_point  t_requestStart{};
+thread_local std::vector<Event> t_events;
+
+std::uint64_t microsBetween(Clock::time_point from, Clock::time_point to) {
+    if (to <= from) return 0;
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+std::uint32_t threadId() {
+    static std::atomic<std::uint32_t> next{1};
+    thread_local const std::uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+nlohmann::json completeEvent(const std::string &name, const char *cat, std::uint64_t ts, std::uint64_t dur,
+                             std::uint32_t tid) {
+    nlohmann::json e;
+    e["name"] = name;
+    e["cat"]  = cat;
+    e["ph"]   = "X";
+    e["ts"]   = ts;
+    e["dur"]  = dur;
+    e["pid"]  = 1;
+    e["tid"]  = tid;
+    return e;
+}
+
+} // namespace
+
+const char *stageName(Stage stage) {
+    return kStageNames[static_cast<std::size_t>(stage)];
+}
+
+void init(const TraceOptions &opts) {
+    std::lock_guard<std::mutex> lk(g_fileMtx);
+    if (g_file.is_open()) g_file.close();
+    const double rate = RequestSampler::clampRate(opts.sampleRate);
+    g_sampleRate.store(rate, std::memory_order_relaxed);
+    if (rate <= 0.0) return;
+
+    try {
+        std::filesystem::path p(opts.filePath);
+        if (p.has_parent_path()) std::filesystem::create_directories(p.parent_path());
+    } catch (...) {
+        // 開檔失敗的話下面會處理
+    }
+    g_file.open(opts.filePath, std::ios::out | std::ios::trunc);
+    if (!g_file) {
+        g_sampleRate.store(0.0, std::memory_order_relaxed);
+        return;
+    }
+    // JSON array format；最後的 "]" 在 shutdown() 補上（chrome://tracing 沒有也能讀）
+    g_file << "[\n";
+    g_firstEvent = true;
+}
+
+void shutdown() {
+    std::lock_guard<std::mutex> lk(g_fileMtx);
+    g_sampleRate.store(0.0, std::memory_order_relaxed);
+    if (!g_file.is_open()) return;
+    g_file << "\n]\n";
+    g_file.close();
+}
+
+void beginRequest() {
+    t_events.clear();
+    t_requestStart = Clock::now();
+    const double rate = g_sampleRate.load(std::memory_order_relaxed);
+    t_sampled = rate > 0.0 && (rate >= 1.0 || RequestSampler::nextUnit() < rate);
+}
+
+void endRequest(const std::string &method, const std::string &path, int status) {
+    if (!t_sampled) return;
+    t_sampled = false;
+
+    const std::uint32_t tid = threadId();
+    const auto          now = Clock::now();
+
+    auto root = completeEvent(method + " " + path, "request", microsBetween(g_epoch, t_requestStart),
+                              microsBetween(t_requestStart, now), tid);
+    root["args"]["status"] = status;
+
+    std::string out = root.dump();
+    for (const auto &ev : t_events) {
+        out += ",\n";
+        out += completeEvent(stageName(ev.stage), "stage", ev.startMicros, ev.durMicros, tid).dump();
+    }
+    t_events.clear();
+
+    std::lock_guard<std::mutex> lk(g_fileMtx);
+    if (!g_file.is_open()) return;
+    if (!g_firstEvent) g_file << ",\n";
+    g_firstEvent = false;
+    g_file << out;
+    g_file.flush();
+}
+
+const LatencyHistogram &stageHistogram(Stage stage) {
+    return g_stages[static_cast<std::size_t>(stage)];
+}
+
+void renderPrometheus(std::string &out) {
+    out += "# HELP health_stage_duration_seconds Self time per request stage (nested spans excluded).\n";
+    out += "# TYPE health_stage_duration_seconds histogram\n";
+    for (std::size_t i = 0; i < kStageCount; ++i) {
+        HttpMetrics::appendHistogram(out, "health_stage_duration_seconds",
+                                     std::string("stage=\"") + kStageNames[i] + "\"", g_stages[i]);
+    }
+}
+
+// ----------------------
+// Span
+// ----------------------
+
+Span::Span(Stage stage) : stage_(stage), start_(Clock::now()), parent_(t_current) {
+    t_current = this;
+}
+
+Span::~Span() {
+    const std::uint64_t total = microsBetween(start_, Clock::now());
+    t_current = parent_;
+    if (parent_) parent_->childMicros_ += total;
+
+    const std::uint64_t self = total > childMicros_ ? total - childMicros_ : 0;
+    g_stages[static_cast<std::size_t>(stage_)].record(self);
+
+    if (t_sampled) {
+        t_events.push_back(Event{stage_, microsBetween(g_epoch, start_), total});
+    }
+}
+
+} // namespace trace
+} // namespace util
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Metrics.hpp"
+
+// Stage-level request tracing.
+//
+//   HB_TRACE_SPAN(Persist);   // 從這行到 scope 結束算一段 "persist"
+//
+// Every span adds its *self* time (children excluded) to a per-stage histogram,
+// exported by GET /metrics as health_stage_duration_seconds{stage=...}.
+// For sampled requests (TraceOptions::sampleRate) the spans are also written to
+// a Chrome trace-event file (chrome://tracing, ui.perfetto.dev).
+
+namespace util {
+namespace trace {
+
+enum class Stage : std::uint8_t { Parse, Auth, Mutation, Persist, Serialize };
+constexpr std::size_t kStageCount = 5;
+
+const char *stageName(Stage stage);
+
+struct TraceOptions {
+    double      sampleRate = 0.0;               // 0 = histograms only, no trace file
+    std::string filePath   = "logs/trace.json";
+};
+
+void init(const TraceOptions &opts);
+// Closes the JSON array so the file also loads in strict JSON parsers.
+void shutdown();
+
+// Called from the pre/post-routing hooks; both run on the request's worker thread.
+void beginRequest();
+void endRequest(const std::string &method, const std::string &path, int status);
+
+const LatencyHistogram &stageHistogram(Stage stage);
+void renderPrometheus(std::string &out);
+
+class Span {
+public:
+    explicit Span(Stage stage);
+    ~Span();
+
+    Span(const Span &)            = delete;
+    Span &operator=(const Span &) = delete;
+
+private:
+    Stage                                 stage_;
+    std::chrono::steady_clock::time_point start_;
+    std::uint64_t                         childMicros_ = 0;
+    Span                                 *parent_;
+};
+
+} // namespace trace
+} // namespace util
+
+#define HB_TRACE_CONCAT_(a, b) a##b
+#define HB_TRACE_CONCAT(a, b) HB_TRACE_CONCAT_(a, b)
+#define HB_TRACE_SPAN(stage) \
+    ::util::trace::Span HB_TRACE_CONCAT(hbTraceSpan_, __LINE__)(::util::trace::Stage::stage)
@@ -43,7 +43,7 @@ int main() {
     for (std::size_t i = 0; i < waters.size(); ++i) {
         const auto &w = waters[i];
         std::cout << "  [" << i << "] "
-                  << w.datetime << " -> " << w.amountMl << " ml\n";
+                  << w.datetime.str() << " -> " << w.amountMl << " ml\n";
     }
 
     // =========================
@@ -59,7 +59,7 @@ int main() {
     for (std::size_t i = 0; i < sleeps.size(); ++i) {
         const auto &s = sleeps[i];
         std::cout << "  [" << i << "] "
-                  << s.datetime << " -> " << s.hours << " hours\n";
+                  << s.datetime.str() << " -> " << s.hours << " hours\n";
     }
 
     // =========================
@@ -75,8 +75,8 @@ int main() {
     for (std::size_t i = 0; i < acts.size(); ++i) {
         const auto &a = acts[i];
         std::cout << "  [" << i << "] "
-                  << a.datetime << " -> "
-                  << a.minutes << " min, intensity = " << a.intensity << "\n";
+                  << a.datetime.str() << " -> "
+                  << a.minutes << " min, intensity = " << a.intensity.str() << "\n";
     }
 
     // =========================
@@ -103,7 +103,7 @@ int main() {
     for (std::size_t i = 0; i < eatingItems.size(); ++i) {
         const auto &item = eatingItems[i];
         std::cout << "  [" << i << "] "
-                  << item.datetime
+                  << item.datetime.str()
                   << " note = " << item.note
                   << " (value = " << item.value << ")\n";
     }
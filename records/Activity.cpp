@@ -1,11 +1,14 @@
 #include "Activity.hpp"
 #include "../external/json.hpp"
+#include "../helpers/SortedVector.hpp"
 
 #include <unordered_map>
 #include <algorithm>
 
 using json = nlohmann::ordered_json;
 
+namespace records {
+
 // 假設 ActivityRecord：
 // struct ActivityRecord {
 //     std::string date;
@@ -23,9 +26,21 @@ bool ActivityManager::addRecord(const std::string& userName,
                                 const std::string& date,
                                 int minutes,
                                 const std::string& intensity) {
+    auto&             vec = data[userName];
+    const std::size_t pos = util::insertSorted(vec, ActivityRecord{date, minutes, intensity}, compareByDate);
+    byDuration[userName].insert(pos, minutes);
+    return true;
+}
+
+bool ActivityManager::addRecords(const std::string& userName,
+                                 std::vector<ActivityRecord> records) {
     auto& vec = data[userName];
-    vec.push_back(ActivityRecord{date, minutes, intensity});
-    std::sort(vec.begin(), vec.end(), compareByDate);
+    util::appendSorted(vec, std::move(records), compareByDate);
+    // 整批進來的位置到處都是，index 整個重建一次
+    std::vector<int> minutes;
+    minutes.reserve(vec.size());
+    for (const auto& a : vec) minutes.push_back(a.minutes);
+    byDuration[userName].build(minutes);
     return true;
 }
 
@@ -39,10 +54,12 @@ bool ActivityManager::updateRecord(const std::string& userName,
     auto& vec = it->second;
     if (index >= vec.size()) return false;
 
+    auto& ranked = byDuration[userName];
+    ranked.update(index, vec[index].minutes, newMinutes);
     vec[index].date      = newDate;
     vec[index].minutes   = newMinutes;
     vec[index].intensity = newIntensity;
-    std::sort(vec.begin(), vec.end(), compareByDate);
+    ranked.move(index, util::repositionSorted(vec, index, compareByDate), newMinutes);
     return true;
 }
 
@@ -53,6 +70,7 @@ bool ActivityManager::deleteRecord(const std::string& userName,
     auto& vec = it->second;
     if (index >= vec.size()) return false;
 
+    byDuration[userName].erase(index, vec[index].minutes);
     vec.erase(vec.begin() + static_cast<long>(index));
     return true;
 }
@@ -63,15 +81,18 @@ std::vector<ActivityRecord> ActivityManager::getAll(const std::string& userName)
     return it->second;
 }
 
-void ActivityManager::sortByDuration(const std::string& userName) {
+std::vector<ActivityRecord> ActivityManager::topByDuration(const std::string& userName,
+                                                           std::size_t k) const {
     auto it = data.find(userName);
-    if (it == data.end()) return;
-    auto& vec = it->second;
+    if (it == data.end()) return {};
+    const auto& entries = byDuration.at(userName).entries();
 
-    std::sort(vec.begin(), vec.end(),
-              [](const ActivityRecord& a, const ActivityRecord& b) {
-                  return a.minutes > b.minutes; // 由大到小
-              });
+    std::vector<ActivityRecord> result;
+    result.reserve(std::min(k, entries.size()));
+    for (std::size_t i = 0; i < entries.size() && i < k; ++i) {
+        result.push_back(it->second[entries[i].pos]);
+    }
+    return result;
 }
 
 // ===== JSON =====
@@ -94,6 +115,7 @@ json ActivityManager::toJson() const {
 
 void ActivityManager::fromJson(const json& j) {
     data.clear();
+    byDuration.clear();
     if (!j.is_object()) return;
 
     for (auto it = j.begin(); it != j.end(); ++it) {
@@ -101,16 +123,19 @@ void ActivityManager::fromJson(const json& j) {
         const json& arr        = it.value();
         if (!arr.is_array()) continue;
 
-        auto& vec = data[user];
+        std::vector<ActivityRecord> vec;
+        vec.reserve(arr.size());
         for (const auto& ja : arr) {
             ActivityRecord a;
             a.date      = ja.value("date", "");
             a.minutes   = ja.value("minutes", 0);
             a.intensity = ja.value("intensity", "");
             if (!a.date.empty()) {
-                vec.push_back(a);
+                vec.push_back(std::move(a));
             }
         }
-        std::sort(vec.begin(), vec.end(), compareByDate);
+        addRecords(user, std::move(vec));
     }
-}
\ No newline at end of file
+}
+
+} // namespace records
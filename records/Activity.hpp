@@ -6,6 +6,9 @@
 #include <vector>
 
 #include "../external/json.hpp"   // 使用 nlohmann::json
+#include "../helpers/RankedIndex.hpp"
+
+namespace records {
 
 struct ActivityRecord {
     std::string date;      // "YYYY-MM-DD"
@@ -16,6 +19,8 @@ struct ActivityRecord {
 class ActivityManager {
 private:
     std::unordered_map<std::string, std::vector<ActivityRecord>> data;
+    // userName -> records 照 minutes 由大到小的 index（data 本身維持日期順序），每次修改跟著更新
+    std::unordered_map<std::string, util::RankedIndex> byDuration;
 
 public:
     bool addRecord(const std::string& userName,
@@ -23,6 +28,10 @@ public:
                    int minutes,
                    const std::string& intensity);
 
+    // 一次匯入一批（不用照日期排好）：整批只排一次序
+    bool addRecords(const std::string& userName,
+                    std::vector<ActivityRecord> records);
+
     bool updateRecord(const std::string& userName,
                       std::size_t index,
                       const std::string& newDate,
@@ -34,11 +43,15 @@ public:
 
     std::vector<ActivityRecord> getAll(const std::string& userName) const;
 
-    void sortByDuration(const std::string& userName);
+    // minutes 最長的前 k 筆（由大到小，一樣長的照日期），O(k)
+    std::vector<ActivityRecord> topByDuration(const std::string& userName,
+                                              std::size_t k) const;
 
     // JSON 匯出 / 匯入
     nlohmann::ordered_json toJson() const;
     void fromJson(const nlohmann::ordered_json& j);
 };
 
+} // namespace records
+
 #endif
\ No newline at end of file
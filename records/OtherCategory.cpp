@@ -1,11 +1,14 @@
 #include "OtherCategory.hpp"
 #include "../external/json.hpp"
+#include "../helpers/SortedVector.hpp"
 
 #include <unordered_map>
 #include <algorithm>
 
 using json = nlohmann::ordered_json;
 
+namespace records {
+
 // 假設 OtherRecord：
 // struct OtherRecord {
 //     std::string date;
@@ -24,10 +27,14 @@ bool OtherCategoryManager::addRecord(const std::string& userName,
                                      const std::string& date,
                                      double value,
                                      const std::string& note) {
-    auto& catMap = data[userName];
-    auto& vec    = catMap[categoryName];
-    vec.push_back(OtherRecord{date, value, note});
-    std::sort(vec.begin(), vec.end(), compareByDate);
+    util::insertSorted(data[userName][categoryName], OtherRecord{date, value, note}, compareByDate);
+    return true;
+}
+
+bool OtherCategoryManager::addRecords(const std::string& userName,
+                                      const std::string& categoryName,
+                                      std::vector<OtherRecord> records) {
+    util::appendSorted(data[userName][categoryName], std::move(records), compareByDate);
     return true;
 }
 
@@ -49,7 +56,7 @@ bool OtherCategoryManager::updateRecord(const std::string& userName,
     vec[index].date  = newDate;
     vec[index].value = newValue;
     vec[index].note  = newNote;
-    std::sort(vec.begin(), vec.end(), compareByDate);
+    util::repositionSorted(vec, index, compareByDate);
     return true;
 }
 
@@ -129,17 +136,20 @@ void OtherCategoryManager::fromJson(const json& j) {
             const json& arr       = itCat.value();
             if (!arr.is_array()) continue;
 
-            auto& vec = catMap[cat];
+            std::vector<OtherRecord> vec;
+            vec.reserve(arr.size());
             for (const auto& jr : arr) {
                 OtherRecord r;
                 r.date  = jr.value("date", "");
                 r.value = jr.value("value", 0.0);
                 r.note  = jr.value("note", "");
                 if (!r.date.empty()) {
-                    vec.push_back(r);
+                    vec.push_back(std::move(r));
                 }
             }
-            std::sort(vec.begin(), vec.end(), compareByDate);
+            util::appendSorted(catMap[cat], std::move(vec), compareByDate);
         }
     }
-}
\ No newline at end of file
+}
+
+} // namespace records
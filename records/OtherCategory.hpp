@@ -7,6 +7,8 @@
 
 #include "../external/json.hpp"   // 使用 nlohmann::json
 
+namespace records {
+
 struct OtherRecord {
     std::string date;   // "YYYY-MM-DD"
     double      value;  // 數值
@@ -28,6 +30,11 @@ public:
                    double value,
                    const std::string& note);
 
+    // 一次匯入一批（不用照日期排好）：整批只排一次序
+    bool addRecords(const std::string& userName,
+                    const std::string& categoryName,
+                    std::vector<OtherRecord> records);
+
     bool updateRecord(const std::string& userName,
                       const std::string& categoryName,
                       std::size_t index,
@@ -49,4 +56,6 @@ public:
     void fromJson(const nlohmann::ordered_json& j);
 };
 
+} // namespace records
+
 #endif
\ No newline at end of file
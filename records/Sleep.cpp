@@ -1,11 +1,14 @@
 #include "Sleep.hpp"
 #include "../external/json.hpp"
+#include "../helpers/SortedVector.hpp"
 
 #include <unordered_map>
 #include <algorithm>
 
 using json = nlohmann::ordered_json;
 
+namespace records {
+
 // 假設 SleepRecord：
 // struct SleepRecord {
 //     std::string date;
@@ -21,9 +24,13 @@ namespace {
 bool SleepManager::addRecord(const std::string& userName,
                              const std::string& date,
                              double hours) {
-    auto& vec = data[userName];
-    vec.push_back(SleepRecord{date, hours});
-    std::sort(vec.begin(), vec.end(), compareByDate);
+    util::insertSorted(data[userName], SleepRecord{date, hours}, compareByDate);
+    return true;
+}
+
+bool SleepManager::addRecords(const std::string& userName,
+                              std::vector<SleepRecord> records) {
+    util::appendSorted(data[userName], std::move(records), compareByDate);
     return true;
 }
 
@@ -38,7 +45,7 @@ bool SleepManager::updateRecord(const std::string& userName,
 
     vec[index].date  = newDate;
     vec[index].hours = newHours;
-    std::sort(vec.begin(), vec.end(), compareByDate);
+    util::repositionSorted(vec, index, compareByDate);
     return true;
 }
 
@@ -98,15 +105,18 @@ void SleepManager::fromJson(const json& j) {
         const json& arr        = it.value();
         if (!arr.is_array()) continue;
 
-        auto& vec = data[user];
+        std::vector<SleepRecord> vec;
+        vec.reserve(arr.size());
         for (const auto& jr : arr) {
             SleepRecord r;
             r.date  = jr.value("date", "");
             r.hours = jr.value("hours", 0.0);
             if (!r.date.empty()) {
-                vec.push_back(r);
+                vec.push_back(std::move(r));
             }
         }
-        std::sort(vec.begin(), vec.end(), compareByDate);
+        addRecords(user, std::move(vec));
     }
-}
\ No newline at end of file
+}
+
+} // namespace records
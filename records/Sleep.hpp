@@ -7,6 +7,8 @@
 
 #include "../external/json.hpp"   // 使用 nlohmann::json
 
+namespace records {
+
 struct SleepRecord {
     std::string date; // "YYYY-MM-DD"
     double hours;     // 睡眠小時數
@@ -21,6 +23,10 @@ public:
                    const std::string& date,
                    double hours);
 
+    // 一次匯入一批（不用照日期排好）：整批只排一次序
+    bool addRecords(const std::string& userName,
+                    std::vector<SleepRecord> records);
+
     bool updateRecord(const std::string& userName,
                       std::size_t index,
                       const std::string& newDate,
@@ -41,4 +47,6 @@ public:
     void fromJson(const nlohmann::ordered_json& j);
 };
 
+} // namespace records
+
 #endif
\ No newline at end of file
@@ -1,11 +1,14 @@
 #include "Water.hpp"
 #include "../external/json.hpp"
+#include "../helpers/SortedVector.hpp"
 
 #include <unordered_map>
 #include <algorithm>
 
 using json = nlohmann::ordered_json;
 
+namespace records {
+
 // 假設 WaterRecord 在 Water.hpp 是：
 // struct WaterRecord {
 //     std::string date;   // "YYYY-MM-DD"
@@ -22,9 +25,13 @@ namespace {
 bool WaterManager::addRecord(const std::string& userName,
                              const std::string& date,
                              double amountMl) {
-    auto& vec = data[userName];
-    vec.push_back(WaterRecord{date, amountMl});
-    std::sort(vec.begin(), vec.end(), compareByDate);
+    util::insertSorted(data[userName], WaterRecord{date, amountMl}, compareByDate);
+    return true;
+}
+
+bool WaterManager::addRecords(const std::string& userName,
+                              std::vector<WaterRecord> records) {
+    util::appendSorted(data[userName], std::move(records), compareByDate);
     return true;
 }
 
@@ -39,7 +46,7 @@ bool WaterManager::updateRecord(const std::string& userName,
 
     vec[index].date     = newDate;
     vec[index].amountMl = newAmountMl;
-    std::sort(vec.begin(), vec.end(), compareByDate);
+    util::repositionSorted(vec, index, compareByDate);
     return true;
 }
 
@@ -110,15 +117,18 @@ void WaterManager::fromJson(const json& j) {
         const json& arr        = it.value();
         if (!arr.is_array()) continue;
 
-        auto& vec = data[user];
+        std::vector<WaterRecord> vec;
+        vec.reserve(arr.size());
         for (const auto& jr : arr) {
             WaterRecord r;
             r.date     = jr.value("date", "");
             r.amountMl = jr.value("amountMl", 0.0);
             if (!r.date.empty()) {
-                vec.push_back(r);
+                vec.push_back(std::move(r));
             }
         }
-        std::sort(vec.begin(), vec.end(), compareByDate);
+        addRecords(user, std::move(vec));
     }
-}
\ No newline at end of file
+}
+
+} // namespace records
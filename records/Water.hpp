@@ -7,6 +7,10 @@
 
 #include "../external/json.hpp"   // 使用 nlohmann::json
 
+// backend/HealthBackend.hpp 也有 WaterRecord / SleepRecord / ActivityRecord（欄位不一樣），
+// 這裡的放在 records namespace，兩邊一起 link 才不會撞名（ODR）
+namespace records {
+
 struct WaterRecord {
     std::string date;   // "YYYY-MM-DD"
     double amountMl;    // 當天飲水量
@@ -21,6 +25,10 @@ public:
                    const std::string& date,
                    double amountMl);
 
+    // 一次匯入一批（不用照日期排好）：整批只排一次序
+    bool addRecords(const std::string& userName,
+                    std::vector<WaterRecord> records);
+
     bool updateRecord(const std::string& userName,
                       std::size_t index,
                       const std::string& newDate,
@@ -41,4 +49,6 @@ public:
     void fromJson(const nlohmann::ordered_json& j);
 };
 
+} // namespace records
+
 #endif
\ No newline at end of file
@@ -2,39 +2,112 @@
 // ===== CHANGED: 加上 CORS、修好 Category 建立/新增/刪除流程 =====
 
 #include <chrono>
+#include <csignal>
 #include <cstdlib>
 #include <iostream>
-#include <mutex>
+#include <limits>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "backend/HealthBackend.hpp"
 #include "external/json.hpp"
+#include "helpers/Arena.hpp"
+#include "helpers/DateTime.hpp"
 #include "helpers/Logger.hpp"
+#include "helpers/Metrics.hpp"
+#include "helpers/RequestSampler.hpp"
+#include "helpers/Trace.hpp"
 #include "httplib.h"
 
-using json = nlohmann::ordered_json;
-
-using json = nlohmann::ordered_json;
+// 跟 nlohmann::ordered_json 一樣（key 照插入順序），但 DOM 從 request 的 arena 配置（見 helpers/Arena.hpp）；
+// 字串內容超過 SSO 的還是走 heap
+using json = nlohmann::basic_json<nlohmann::ordered_map, std::vector, std::string, bool, std::int64_t,
+                                  std::uint64_t, double, util::ArenaAllocator>;
 
 // 從 Authorization header 取出 Bearer token
 // 規格：Authorization: Bearer <jwt>
-std::string getTokenFromAuthHeader(const httplib::Request& req) {
+// 回傳的是 req.headers 裡字串的一段（不複製），只能在這個 request 裡用
+std::string_view getTokenFromAuthHeader(const httplib::Request& req) {
   auto it = req.headers.find("Authorization");
   if (it == req.headers.end()) {
-    return "";
+    return {};
   }
-  const std::string& auth = it->second;
-  const std::string prefix = "Bearer ";
+  std::string_view auth = it->second;
+  constexpr std::string_view prefix = "Bearer ";
   if (auth.size() >= prefix.size() && auth.compare(0, prefix.size(), prefix) == 0) {
     return auth.substr(prefix.size());
   }
-  return "";
+  return {};
+}
+
+// Request body -> JSON（trace 的 "parse" 階段）
+static json parseBody(const httplib::Request& req) {
+  HB_TRACE_SPAN(Parse);
+  return json::parse(req.body);
+}
+
+// 成功回應的 JSON 序列化（trace 的 "serialize" 階段）
+static void setJsonContent(httplib::Response& res, const json& j) {
+  HB_TRACE_SPAN(Serialize);
+  res.set_content(j.dump(), "application/json");
+}
+
+// Origin header（沒有就是 "-"），只在 log 真的要輸出時才會呼叫
+static std::string originOf(const httplib::Request& req) {
+  return req.has_header("Origin") ? req.get_header_value("Origin") : "-";
+}
+
+// GET 列表的 ?from=…&to=…（datetime 寫法跟 records 一樣，見 util::parseDateTime），範圍是 [from, to)；
+// 只給一邊就是另一邊不限
+struct TimeRange {
+  bool active = false;
+  std::int64_t fromMs = std::numeric_limits<std::int64_t>::min();
+  std::int64_t toMs = std::numeric_limits<std::int64_t>::max();
+};
+
+// false = from / to 認不得
+static bool parseTimeRange(const httplib::Request& req, TimeRange& range) {
+  if (req.has_param("from")) {
+    range.active = true;
+    if (!util::parseDateTime(req.get_param_value("from"), range.fromMs)) return false;
+  }
+  if (req.has_param("to")) {
+    range.active = true;
+    if (!util::parseDateTime(req.get_param_value("to"), range.toMs)) return false;
+  }
+  return true;
+}
+
+// ?limit=k（沒給就是不限）；false = 不是非負整數
+static bool parseLimit(const httplib::Request& req, std::size_t& limit) {
+  limit = std::numeric_limits<std::size_t>::max();
+  if (!req.has_param("limit")) return true;
+  const std::string value = req.get_param_value("limit");
+  if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos) return false;
+  limit = static_cast<std::size_t>(std::stoul(value));
+  return true;
+}
+
+// 新的 datetime 要是 ISO 8601（見 util::parseDateTime），或認不得但不超過 22 bytes
+// （util::PackedDateTime::storable）；不行的話寫好 400，回傳 false
+static bool checkDateTime(const std::string& datetime, httplib::Response& res) {
+  if (util::PackedDateTime::storable(datetime)) return true;
+  json err;
+  err["errorMessage"] = "datetime must be ISO 8601, e.g. 2025-01-01T08:00:00Z or 2025-01-01T08:00:00+08:00";
+  res.status = 400;
+  res.set_content(err.dump(), "application/json");
+  return false;
+}
+
+// SIGINT / SIGTERM：讓 listen() 正常返回，才會跑到 Logger::shutdown() 把 log 寫完
+static httplib::Server* g_server = nullptr;
+static void handleStopSignal(int) {
+  if (g_server) g_server->stop();
 }
 
 int main() {
-  HealthBackend backend;
   httplib::Server svr;
 
   // Initialize logger -------------------------------
@@ -53,11 +126,86 @@ int main() {
     else
       level = util::LogLevel::Info;
   }
-  util::Logger::init(logFilePath, level);
+  // LOG_ASYNC=1：log 丟進 ring buffer，由背景 thread 批次寫出
+  util::LoggerOptions logOpts;
+  const char* logAsyncEnv = std::getenv("LOG_ASYNC");
+  logOpts.async = logAsyncEnv && std::string(logAsyncEnv) == "1";
+  if (const char* queueEnv = std::getenv("LOG_QUEUE_SIZE")) {
+    logOpts.queueCapacity = std::strtoul(queueEnv, nullptr, 10);
+    if (logOpts.queueCapacity == 0) logOpts.queueCapacity = 8192;
+  }
+  if (const char* overflowEnv = std::getenv("LOG_OVERFLOW")) {
+    logOpts.overflow =
+        std::string(overflowEnv) == "block" ? util::OverflowPolicy::Block : util::OverflowPolicy::Drop;
+  }
+  if (const char* tsEnv = std::getenv("LOG_TIMESTAMP")) {
+    logOpts.precision =
+        std::string(tsEnv) == "ms" ? util::TimestampPrecision::Milliseconds : util::TimestampPrecision::Seconds;
+  }
+  if (const char* formatEnv = std::getenv("LOG_FORMAT")) {
+    logOpts.encoding = std::string(formatEnv) == "binary" ? util::LogEncoding::Binary : util::LogEncoding::Text;
+  }
+  if (const char* warnRateEnv = std::getenv("LOG_WARN_RATE")) {
+    logOpts.warnRatePerSec = std::atof(warnRateEnv);
+  }
+  if (const char* warnBurstEnv = std::getenv("LOG_WARN_BURST")) {
+    logOpts.warnBurst = std::strtoul(warnBurstEnv, nullptr, 10);
+  }
+  util::Logger::init(logFilePath, level, logOpts);
+
+  // Access log 取樣：失敗或慢的 request 一定記，其他依 route 取樣
+  util::RequestSampler::Config sampleCfg;
+  if (const char* rateEnv = std::getenv("LOG_SAMPLE_RATE")) {
+    sampleCfg.defaultRate = util::RequestSampler::clampRate(std::atof(rateEnv));
+  }
+  if (const char* routesEnv = std::getenv("LOG_SAMPLE_ROUTES")) {
+    sampleCfg.routes = util::RequestSampler::parseRoutes(routesEnv);
+  }
+  if (const char* slowEnv = std::getenv("LOG_SLOW_MS")) {
+    sampleCfg.slowMs = std::atol(slowEnv);
+  }
+  const util::RequestSampler sampler(sampleCfg);
+
+  // Stage trace：histogram 一直都有；TRACE_SAMPLE_RATE > 0 才寫 Chrome trace 檔
+  util::trace::TraceOptions traceOpts;
+  if (const char* traceRateEnv = std::getenv("TRACE_SAMPLE_RATE")) {
+    traceOpts.sampleRate = std::atof(traceRateEnv);
+  }
+  if (const char* traceFileEnv = std::getenv("TRACE_FILE")) {
+    traceOpts.filePath = traceFileEnv;
+  }
+  util::trace::init(traceOpts);
   // --------------------------------------------------
 
+  // Backend：logger 設好之後才建，載入 storage.json 的時間 / 錯誤才會進 log
+  HealthBackend::Options backendOpts;
+  if (const char* loadThreadsEnv = std::getenv("STORAGE_LOAD_THREADS")) {
+    backendOpts.loadThreads = static_cast<unsigned>(std::strtoul(loadThreadsEnv, nullptr, 10));
+  }
+  if (const char* storageFormatEnv = std::getenv("STORAGE_FORMAT")) {
+    const std::string format = storageFormatEnv;
+    if (format == "binary") backendOpts.format = HealthBackend::StorageFormat::Binary;
+    if (format == "per-user") backendOpts.format = HealthBackend::StorageFormat::PerUser;
+  }
+  if (const char* backupsEnv = std::getenv("STORAGE_BACKUPS")) {
+    backendOpts.backups = static_cast<unsigned>(std::strtoul(backupsEnv, nullptr, 10));
+  }
+  if (const char* coldEnv = std::getenv("COLD_AFTER_DAYS")) {
+    backendOpts.coldAfterDays = static_cast<unsigned>(std::strtoul(coldEnv, nullptr, 10));
+  }
+  if (const char* budgetEnv = std::getenv("MEMORY_BUDGET_MB")) {
+    backendOpts.memoryBudget = static_cast<std::size_t>(std::strtoull(budgetEnv, nullptr, 10)) << 20;
+  }
+  if (const char* flushEnv = std::getenv("FLUSH_INTERVAL_MS")) {
+    backendOpts.flushIntervalMs = static_cast<unsigned>(std::strtoul(flushEnv, nullptr, 10));
+  }
+  HealthBackend backend(backendOpts);
+
+  // keep-alive 連線上 header 跟 body 是分開寫的，不關 Nagle 的話每個 response 會被 delayed ACK 卡 ~40ms
+  svr.set_tcp_nodelay(true);
+
   // ===== NEW: CORS 設定（前端在別的 Port/Domain 時也能用） =====
-  svr.Options(R"(.*)", [](const httplib::Request& req, httplib::Response& res) {
+  svr.Options(R"(.*)", [](const httplib::Request&, httplib::Response& res) {
     res.set_header("Access-Control-Allow-Origin", "*");
     res.set_header("Access-Control-Allow-Methods", "GET, POST, PATCH, DELETE, OPTIONS");
     res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
@@ -68,34 +216,59 @@ int main() {
   // Log exceptions
   svr.set_exception_handler([](const httplib::Request& req, httplib::Response& res, std::exception_ptr ep) {
     (void)res;  // we don't modify response here
-    std::string origin = req.has_header("Origin") ? req.get_header_value("Origin") : "-";
     try {
       if (ep) std::rethrow_exception(ep);
     } catch (const std::exception& e) {
-      util::Logger::error(std::string("Unhandled exception handling request: ") + req.method + " " + req.path +
-                          " Origin:" + origin + " error: " + e.what());
+      HB_LOG_ERROR("Unhandled exception handling request: {} {} Origin:{} error: {}", req.method, req.path,
+                   originOf(req), e.what());
     } catch (...) {
-      util::Logger::error(std::string("Unhandled exception handling request: ") + req.method + " " + req.path +
-                          " Origin:" + origin + " error: unknown");
+      HB_LOG_ERROR("Unhandled exception handling request: {} {} Origin:{} error: unknown", req.method, req.path,
+                   originOf(req));
     }
   });
 
-  // We'll track request start times so we can log durations.
-  static std::mutex _req_mtx;
-  static std::unordered_map<const httplib::Request*, std::chrono::steady_clock::time_point> _req_start;
-
-  // Pre-routing: record start time
+  // Per-route / per-status counters + latency histograms for GET /metrics.
+  // 順序有差：固定路徑要排在同長度的 ":id" pattern 前面
+  util::HttpMetrics metrics;
+  for (const char* base : {"/waters", "/sleeps", "/activities"}) {
+    const std::string b = base;
+    metrics.addRoute("POST", b);
+    metrics.addRoute("GET", b);
+    metrics.addRoute("PATCH", b + "/:id");
+    metrics.addRoute("DELETE", b + "/:id");
+  }
+  metrics.addRoute("GET", "/health");
+  metrics.addRoute("GET", "/metrics");
+  metrics.addRoute("POST", "/register");
+  metrics.addRoute("POST", "/login");
+  metrics.addRoute("GET", "/user/profile");
+  metrics.addRoute("GET", "/user/bmi");
+  metrics.addRoute("GET", "/leaderboard");
+  metrics.addRoute("GET", "/category/list");
+  metrics.addRoute("POST", "/category/create");
+  metrics.addRoute("DELETE", "/category/:id");
+  metrics.addRoute("GET", "/category/:id/list");
+  metrics.addRoute("POST", "/category/:id/add");
+  metrics.addRoute("PATCH", "/category/:id/:item");
+  metrics.addRoute("DELETE", "/category/:id/:item");
+
+  // pre-routing、handler、post-routing 都在同一個 worker thread 上跑完，
+  // 所以開始時間放 thread_local 就好，不用再鎖一個 map
+  static thread_local std::chrono::steady_clock::time_point t_reqStart{};
+
+  // Pre-routing: record start time（access log 等結束時再決定要不要寫）
   svr.set_pre_routing_handler(
       [&](const httplib::Request& req, httplib::Response& /*res*/) -> httplib::Server::HandlerResponse {
-        std::lock_guard<std::mutex> lk(_req_mtx);
-        _req_start[&req] = std::chrono::steady_clock::now();
-        auto origin = req.has_header("Origin") ? req.get_header_value("Origin") : "-";
-        util::Logger::info(req.method + std::string(" ") + req.path + " Origin:" + origin);
+        t_reqStart = std::chrono::steady_clock::now();
+        util::trace::beginRequest();
+        util::RequestArena::begin();
+        HB_LOG_DEBUG("{} {} Origin:{}", req.method, req.path, originOf(req));
         return httplib::Server::HandlerResponse::Unhandled;
       });
 
   // Inject CORS headers and log request info via a post-routing hook
   svr.set_post_routing_handler([&](const httplib::Request& req, httplib::Response& res) {
+    util::RequestArena::end();
     // Only add header if it's not already present
     if (res.get_header_value("Access-Control-Allow-Origin").empty()) {
       res.set_header("Access-Control-Allow-Origin", "*");
@@ -106,33 +279,28 @@ int main() {
     if (res.get_header_value("Access-Control-Allow-Methods").empty()) {
       res.set_header("Access-Control-Allow-Methods", "GET, POST, PATCH, DELETE, OPTIONS");
     }
-    // Log request duration
-    std::chrono::steady_clock::time_point start;
-    {
-      std::lock_guard<std::mutex> lk(_req_mtx);
-      auto it = _req_start.find(&req);
-      if (it != _req_start.end()) {
-        start = it->second;
-        _req_start.erase(it);
-      }
-    }
+    // Record latency + log request duration
+    const auto start = t_reqStart;
+    t_reqStart = {};
     if (start.time_since_epoch().count() > 0) {
-      auto dur =
-          std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
-      util::Logger::info(req.method + std::string(" ") + req.path + " -> " + std::to_string(res.status) + " (" +
-                         std::to_string(dur) + " ms)");
+      const auto micros =
+          std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+      metrics.record(metrics.match(req.method, req.path), res.status, static_cast<std::uint64_t>(micros));
+      util::trace::endRequest(req.method, req.path, res.status);
+      const long dur = static_cast<long>(micros / 1000);
+      if (sampler.shouldLog(req.path, res.status, dur)) {
+        HB_LOG_INFO("{} {} Origin:{} -> {} ({} ms)", req.method, req.path, originOf(req), res.status, dur);
+      }
     }
   });
 
   // Set httplib server-level logging to route through our Logger
   svr.set_logger([](const httplib::Request& req, const httplib::Response& res) {
     (void)res;
-    auto origin = req.has_header("Origin") ? req.get_header_value("Origin") : "-";
-    util::Logger::debug(std::string("httplib log: ") + req.method + " " + req.path + " Origin:" + origin);
+    HB_LOG_DEBUG("httplib log: {} {} Origin:{}", req.method, req.path, originOf(req));
   });
   svr.set_error_logger([](const httplib::Error& err, const httplib::Request* req) {
-    std::string path = req ? req->path : "-";
-    util::Logger::warn(std::string("httplib error: ") + std::to_string(static_cast<int>(err)) + " path:" + path);
+    HB_LOG_WARN("httplib error: {} path:{}", static_cast<int>(err), req ? req->path : std::string("-"));
   });
 
   // ======================
@@ -146,6 +314,56 @@ int main() {
     res.set_content(j.dump(), "application/json");
   });
 
+  // GET /metrics (Prometheus text format)
+  svr.Get("/metrics", [&backend, &metrics](const httplib::Request&, httplib::Response& res) {
+    std::string out;
+    out.reserve(16 * 1024);
+    metrics.renderPrometheus(out);
+    util::trace::renderPrometheus(out);
+
+    const HealthBackend::Stats st = backend.getStats();
+    util::HttpMetrics::appendGauge(out, "health_users", "Registered users.", static_cast<double>(st.users));
+    util::HttpMetrics::appendGauge(out, "health_live_tokens", "Issued login tokens.",
+                                   static_cast<double>(st.liveTokens));
+    util::HttpMetrics::appendGauge(out, "health_water_records", "Water records across all users.",
+                                   static_cast<double>(st.waters));
+    util::HttpMetrics::appendGauge(out, "health_sleep_records", "Sleep records across all users.",
+                                   static_cast<double>(st.sleeps));
+    util::HttpMetrics::appendGauge(out, "health_activity_records", "Activity records across all users.",
+                                   static_cast<double>(st.activities));
+    util::HttpMetrics::appendGauge(out, "health_categories", "Custom categories across all users.",
+                                   static_cast<double>(st.categories));
+    util::HttpMetrics::appendGauge(out, "health_category_items", "Custom category items across all users.",
+                                   static_cast<double>(st.categoryItems));
+    util::HttpMetrics::appendGauge(out, "health_storage_bytes", "Size of the storage file (-1 if missing).",
+                                   static_cast<double>(st.storageBytes));
+    util::HttpMetrics::appendGauge(out, "health_resident_users", "Users whose records are held in memory.",
+                                   static_cast<double>(st.residentUsers));
+    util::HttpMetrics::appendGauge(out, "health_resident_record_bytes",
+                                   "Estimated heap used by in-memory records (0 without a memory budget).",
+                                   static_cast<double>(st.residentBytes));
+    util::HttpMetrics::appendGauge(out, "health_memory_budget_bytes", "Record memory budget (0 = unlimited).",
+                                   static_cast<double>(st.memoryBudget));
+    util::HttpMetrics::appendGauge(out, "health_cold_records", "Records sealed into compressed cold blocks.",
+                                   static_cast<double>(st.coldRecords));
+    util::HttpMetrics::appendGauge(out, "health_cold_bytes", "Heap used by cold blocks.",
+                                   static_cast<double>(st.coldBytes));
+    util::HttpMetrics::appendCounter(out, "health_record_cache_hits_total",
+                                     "Record accesses served from memory.", st.recordHits);
+    util::HttpMetrics::appendCounter(out, "health_record_cache_misses_total",
+                                     "Record accesses that had to read the user back from storage.", st.recordMisses);
+    util::HttpMetrics::appendCounter(out, "health_record_evictions_total",
+                                     "Users whose records were dropped to stay under the memory budget.", st.evictions);
+    util::HttpMetrics::appendCounter(out, "health_request_arena_allocations_total",
+                                     "JSON allocations served from per-request arenas.",
+                                     util::RequestArena::allocations());
+    util::HttpMetrics::appendCounter(out, "health_log_dropped_total", "Log lines dropped by the async logger.",
+                                     util::Logger::droppedCount());
+
+    res.status = 200;
+    res.set_content(out, "text/plain; version=0.0.4");
+  });
+
   // =======================
   //   Authentication / User
   // =======================
@@ -155,7 +373,7 @@ int main() {
   // 回傳: 201 { "token": "..." }
   svr.Post("/register", [&backend](const httplib::Request& req, httplib::Response& res) {
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
 
       if (!j.contains("name") || !j.contains("password") || !j.contains("age") || !j.contains("weightKg") ||
           !j.contains("heightM") || !j.contains("gender")) {
@@ -194,8 +412,8 @@ int main() {
       json out;
       out["token"] = token;
       res.status = 201;
-      res.set_content(out.dump(), "application/json");
-      util::Logger::info(std::string("POST /register: user=") + name + " token=" + token);
+      setJsonContent(res, out);
+      HB_LOG_INFO("POST /register: user={} token={}", name, token);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -209,7 +427,7 @@ int main() {
   // 回傳: 200 { "token":"..." }
   svr.Post("/login", [&backend](const httplib::Request& req, httplib::Response& res) {
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
 
       if (!j.contains("name") || !j.contains("password")) {
         json err;
@@ -228,15 +446,15 @@ int main() {
         err["errorMessage"] = "Invalid name or password";
         res.status = 401;
         res.set_content(err.dump(), "application/json");
-        util::Logger::warn(std::string("POST /login failed: user=") + name);
+        HB_LOG_WARN("POST /login failed: user={}", name);
         return;
       }
 
       json out;
       out["token"] = token;
       res.status = 200;
-      res.set_content(out.dump(), "application/json");
-      util::Logger::info(std::string("POST /login: user=") + name + " token=" + token);
+      setJsonContent(res, out);
+      HB_LOG_INFO("POST /login: user={} token={}", name, token);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -247,7 +465,7 @@ int main() {
 
   // GET /user/profile
   svr.Get("/user/profile", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -274,12 +492,12 @@ int main() {
     out["age"] = profile.age;
 
     res.status = 200;
-    res.set_content(out.dump(), "application/json");
+    setJsonContent(res, out);
   });
 
   // GET /user/bmi
   svr.Get("/user/bmi", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -300,7 +518,7 @@ int main() {
     json out;
     out["bmi"] = bmi;
     res.status = 200;
-    res.set_content(out.dump(), "application/json");
+    setJsonContent(res, out);
   });
 
   // =======================
@@ -308,7 +526,7 @@ int main() {
   // =======================
 
   svr.Post("/waters", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -318,7 +536,7 @@ int main() {
     }
 
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
       if (!j.contains("datetime") || !j.contains("amountMl")) {
         json err;
         err["errorMessage"] = "Missing datetime or amountMl";
@@ -328,9 +546,11 @@ int main() {
       }
 
       std::string datetime = j["datetime"].get<std::string>();
+      if (!checkDateTime(datetime, res)) return;
       double amount = j["amountMl"].get<double>();
 
-      bool ok = backend.addWater(token, datetime, amount);
+      std::size_t idx = 0;
+      bool ok = backend.addWater(token, datetime, amount, &idx);
       if (!ok) {
         json err;
         err["errorMessage"] = "Failed to add water record";
@@ -339,24 +559,12 @@ int main() {
         return;
       }
 
-      auto records = backend.getAllWater(token);
-      if (records.empty()) {
-        json err;
-        err["errorMessage"] = "Internal error: no records after add";
-        res.status = 500;
-        res.set_content(err.dump(), "application/json");
-        return;
-      }
-
-      std::size_t idx = records.size() - 1;
-      const auto& r = records[idx];
-
       json out;
       out["id"] = std::to_string(idx);
-      out["datetime"] = r.datetime;
-      out["amountMl"] = r.amountMl;
+      out["datetime"] = datetime;
+      out["amountMl"] = amount;
       res.status = 201;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -366,7 +574,7 @@ int main() {
   });
 
   svr.Get("/waters", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -375,24 +583,36 @@ int main() {
       return;
     }
 
-    auto records = backend.getAllWater(token);
+    TimeRange range;
+    if (!parseTimeRange(req, range)) {
+      json err;
+      err["errorMessage"] = "Invalid from/to datetime";
+      res.status = 400;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
 
     json arr = json::array();
-    for (std::size_t i = 0; i < records.size(); ++i) {
-      const auto& r = records[i];
+    auto append = [&arr](std::size_t i, const WaterRecord& r) {
       json jr;
       jr["id"] = std::to_string(i);
-      jr["datetime"] = r.datetime;
+      jr["datetime"] = r.datetime.str();
       jr["amountMl"] = r.amountMl;
-      arr.push_back(jr);
+      arr.push_back(std::move(jr));
+    };
+    if (range.active) {
+      for (const auto& [i, r] : backend.getWaterBetween(token, range.fromMs, range.toMs)) append(i, r);
+    } else {
+      auto records = backend.getAllWater(token);
+      for (std::size_t i = 0; i < records.size(); ++i) append(i, records[i]);
     }
 
     res.status = 200;
-    res.set_content(arr.dump(), "application/json");
+    setJsonContent(res, arr);
   });
 
   svr.Patch(R"(/waters/(\d+))", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -414,10 +634,10 @@ int main() {
     }
 
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
 
-      auto records = backend.getAllWater(token);
-      if (index >= records.size()) {
+      WaterRecord current;
+      if (!backend.getWater(token, index, current)) {
         json err;
         err["errorMessage"] = "Record not found";
         res.status = 404;
@@ -425,11 +645,13 @@ int main() {
         return;
       }
 
-      std::string newDatetime = records[index].datetime;
-      double newAmount = records[index].amountMl;
+      std::string newDatetime = current.datetime.str();
+      double newAmount = current.amountMl;
 
       if (j.contains("datetime")) {
-        newDatetime = j["datetime"].get<std::string>();
+        std::string requested = j["datetime"].get<std::string>();
+        if (requested != newDatetime && !checkDateTime(requested, res)) return;  // 沒改的話舊資料照舊
+        newDatetime = std::move(requested);
       }
       if (j.contains("amountMl")) {
         newAmount = j["amountMl"].get<double>();
@@ -449,7 +671,7 @@ int main() {
       out["datetime"] = newDatetime;
       out["amountMl"] = newAmount;
       res.status = 200;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -459,7 +681,7 @@ int main() {
   });
 
   svr.Delete(R"(/waters/(\d+))", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -498,7 +720,7 @@ int main() {
   // =======================
 
   svr.Post("/sleeps", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -508,7 +730,7 @@ int main() {
     }
 
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
       if (!j.contains("datetime") || !j.contains("hours")) {
         json err;
         err["errorMessage"] = "Missing datetime or hours";
@@ -518,36 +740,26 @@ int main() {
       }
 
       std::string datetime = j["datetime"].get<std::string>();
+      if (!checkDateTime(datetime, res)) return;
       double hours = j["hours"].get<double>();
 
-      bool ok = backend.addSleep(token, datetime, hours);
+      std::size_t idx = 0;
+      bool ok = backend.addSleep(token, datetime, hours, &idx);
       if (!ok) {
         json err;
         err["errorMessage"] = "Failed to add sleep record";
         res.status = 400;
         res.set_content(err.dump(), "application/json");
-        util::Logger::warn(std::string("POST /sleeps failed: token=") + token + " hours=" + std::to_string(hours));
-        return;
-      }
-
-      auto records = backend.getAllSleep(token);
-      if (records.empty()) {
-        json err;
-        err["errorMessage"] = "Internal error: no sleep records after add";
-        res.status = 500;
-        res.set_content(err.dump(), "application/json");
+        HB_LOG_WARN("POST /sleeps failed: token={} hours={}", token, hours);
         return;
       }
 
-      std::size_t idx = records.size() - 1;
-      const auto& r = records[idx];
-
       json out;
       out["id"] = std::to_string(idx);
-      out["datetime"] = r.datetime;
-      out["hours"] = r.hours;
+      out["datetime"] = datetime;
+      out["hours"] = hours;
       res.status = 201;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -557,7 +769,7 @@ int main() {
   });
 
   svr.Get("/sleeps", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -566,24 +778,36 @@ int main() {
       return;
     }
 
-    auto records = backend.getAllSleep(token);
+    TimeRange range;
+    if (!parseTimeRange(req, range)) {
+      json err;
+      err["errorMessage"] = "Invalid from/to datetime";
+      res.status = 400;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
 
     json arr = json::array();
-    for (std::size_t i = 0; i < records.size(); ++i) {
-      const auto& r = records[i];
+    auto append = [&arr](std::size_t i, const SleepRecord& r) {
       json jr;
       jr["id"] = std::to_string(i);
-      jr["datetime"] = r.datetime;
+      jr["datetime"] = r.datetime.str();
       jr["hours"] = r.hours;
-      arr.push_back(jr);
+      arr.push_back(std::move(jr));
+    };
+    if (range.active) {
+      for (const auto& [i, r] : backend.getSleepBetween(token, range.fromMs, range.toMs)) append(i, r);
+    } else {
+      auto records = backend.getAllSleep(token);
+      for (std::size_t i = 0; i < records.size(); ++i) append(i, records[i]);
     }
 
     res.status = 200;
-    res.set_content(arr.dump(), "application/json");
+    setJsonContent(res, arr);
   });
 
   svr.Patch(R"(/sleeps/(\d+))", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -605,10 +829,10 @@ int main() {
     }
 
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
 
-      auto records = backend.getAllSleep(token);
-      if (index >= records.size()) {
+      SleepRecord current;
+      if (!backend.getSleep(token, index, current)) {
         json err;
         err["errorMessage"] = "Record not found";
         res.status = 404;
@@ -616,11 +840,13 @@ int main() {
         return;
       }
 
-      std::string newDatetime = records[index].datetime;
-      double newHours = records[index].hours;
+      std::string newDatetime = current.datetime.str();
+      double newHours = current.hours;
 
       if (j.contains("datetime")) {
-        newDatetime = j["datetime"].get<std::string>();
+        std::string requested = j["datetime"].get<std::string>();
+        if (requested != newDatetime && !checkDateTime(requested, res)) return;  // 沒改的話舊資料照舊
+        newDatetime = std::move(requested);
       }
       if (j.contains("hours")) {
         newHours = j["hours"].get<double>();
@@ -640,7 +866,7 @@ int main() {
       out["datetime"] = newDatetime;
       out["hours"] = newHours;
       res.status = 200;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -650,7 +876,7 @@ int main() {
   });
 
   svr.Delete(R"(/sleeps/(\d+))", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -689,7 +915,7 @@ int main() {
   // =======================
 
   svr.Post("/activities", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -699,7 +925,7 @@ int main() {
     }
 
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
       if (!j.contains("datetime") || !j.contains("minutes") || !j.contains("intensity")) {
         json err;
         err["errorMessage"] = "Missing fields";
@@ -709,10 +935,12 @@ int main() {
       }
 
       std::string datetime = j["datetime"].get<std::string>();
+      if (!checkDateTime(datetime, res)) return;
       int minutes = j["minutes"].get<int>();
       std::string intensity = j["intensity"].get<std::string>();
 
-      bool ok = backend.addActivity(token, datetime, minutes, intensity);
+      std::size_t idx = 0;
+      bool ok = backend.addActivity(token, datetime, minutes, intensity, &idx);
       if (!ok) {
         json err;
         err["errorMessage"] = "Failed to add activity record";
@@ -721,25 +949,13 @@ int main() {
         return;
       }
 
-      auto records = backend.getAllActivity(token);
-      if (records.empty()) {
-        json err;
-        err["errorMessage"] = "Internal error: no activity records after add";
-        res.status = 500;
-        res.set_content(err.dump(), "application/json");
-        return;
-      }
-
-      std::size_t idx = records.size() - 1;
-      const auto& a = records[idx];
-
       json out;
       out["id"] = std::to_string(idx);
-      out["datetime"] = a.datetime;
-      out["minutes"] = a.minutes;
-      out["intensity"] = a.intensity;
+      out["datetime"] = datetime;
+      out["minutes"] = minutes;
+      out["intensity"] = intensity;
       res.status = 201;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -749,7 +965,7 @@ int main() {
   });
 
   svr.Get("/activities", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -758,25 +974,57 @@ int main() {
       return;
     }
 
-    auto records = backend.getAllActivity(token);
+    TimeRange range;
+    if (!parseTimeRange(req, range)) {
+      json err;
+      err["errorMessage"] = "Invalid from/to datetime";
+      res.status = 400;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
+
+    // ?sort=duration[&limit=k]：minutes 最長的在前（backend 維護的 index，O(k)），不能跟 from / to 一起用
+    const bool byDuration = req.has_param("sort");
+    std::size_t limit = 0;
+    if (byDuration && (req.get_param_value("sort") != "duration" || range.active)) {
+      json err;
+      err["errorMessage"] = "Invalid sort (only sort=duration, without from/to)";
+      res.status = 400;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
+    if (byDuration && !parseLimit(req, limit)) {
+      json err;
+      err["errorMessage"] = "Invalid limit";
+      res.status = 400;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
 
     json arr = json::array();
-    for (std::size_t i = 0; i < records.size(); ++i) {
-      const auto& a = records[i];
+    auto append = [&arr](std::size_t i, const ActivityRecord& a) {
       json ja;
       ja["id"] = std::to_string(i);
-      ja["datetime"] = a.datetime;
+      ja["datetime"] = a.datetime.str();
       ja["minutes"] = a.minutes;
-      ja["intensity"] = a.intensity;
-      arr.push_back(ja);
+      ja["intensity"] = a.intensity.str();
+      arr.push_back(std::move(ja));
+    };
+    if (byDuration) {
+      for (const auto& [i, a] : backend.getActivitiesByDuration(token, limit)) append(i, a);
+    } else if (range.active) {
+      for (const auto& [i, a] : backend.getActivityBetween(token, range.fromMs, range.toMs)) append(i, a);
+    } else {
+      auto records = backend.getAllActivity(token);
+      for (std::size_t i = 0; i < records.size(); ++i) append(i, records[i]);
     }
 
     res.status = 200;
-    res.set_content(arr.dump(), "application/json");
+    setJsonContent(res, arr);
   });
 
   svr.Patch(R"(/activities/(\d+))", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -798,9 +1046,9 @@ int main() {
     }
 
     try {
-      json j = json::parse(req.body);
-      auto records = backend.getAllActivity(token);
-      if (index >= records.size()) {
+      json j = parseBody(req);
+      Pinned<ActivityRecord> current;
+      if (!backend.getActivity(token, index, current)) {
         json err;
         err["errorMessage"] = "Record not found";
         res.status = 404;
@@ -808,12 +1056,14 @@ int main() {
         return;
       }
 
-      std::string newDatetime = records[index].datetime;
-      int newMinutes = records[index].minutes;
-      std::string newIntensity = records[index].intensity;
+      std::string newDatetime = current.value.datetime.str();
+      int newMinutes = current.value.minutes;
+      std::string newIntensity = current.value.intensity.str();
 
       if (j.contains("datetime")) {
-        newDatetime = j["datetime"].get<std::string>();
+        std::string requested = j["datetime"].get<std::string>();
+        if (requested != newDatetime && !checkDateTime(requested, res)) return;  // 沒改的話舊資料照舊
+        newDatetime = std::move(requested);
       }
       if (j.contains("minutes")) {
         newMinutes = j["minutes"].get<int>();
@@ -837,7 +1087,7 @@ int main() {
       out["minutes"] = newMinutes;
       out["intensity"] = newIntensity;
       res.status = 200;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -847,7 +1097,7 @@ int main() {
   });
 
   svr.Delete(R"(/activities/(\d+))", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -881,13 +1131,95 @@ int main() {
     res.set_content("", "application/json");
   });
 
+  // =======================
+  //      Leaderboards
+  // =======================
+
+  // GET /leaderboard?board=activity|water[&week=<datetime>][&limit=k]
+  // week 可以是那一週的任何一天（預設這週），limit 預設 10
+  svr.Get("/leaderboard", [&backend](const httplib::Request& req, httplib::Response& res) {
+    std::string_view token = getTokenFromAuthHeader(req);
+    if (token.empty()) {
+      json err;
+      err["errorMessage"] = "Missing or invalid Authorization token";
+      res.status = 401;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
+
+    const std::string boardName = req.get_param_value("board");
+    if (boardName != "activity" && boardName != "water") {
+      json err;
+      err["errorMessage"] = "Invalid board (activity or water)";
+      res.status = 400;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
+    const auto board = boardName == "activity" ? HealthBackend::Board::ActivityMinutes
+                                               : HealthBackend::Board::WaterDays;
+
+    std::int64_t atMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    if (req.has_param("week") && !util::parseDateTime(req.get_param_value("week"), atMs)) {
+      json err;
+      err["errorMessage"] = "Invalid week datetime";
+      res.status = 400;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
+
+    std::size_t limit = 0;
+    if (!parseLimit(req, limit)) {
+      json err;
+      err["errorMessage"] = "Invalid limit";
+      res.status = 400;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
+    if (!req.has_param("limit")) limit = 10;
+
+    HealthBackend::Ranking ranking;
+    if (!backend.getLeaderboard(token, board, atMs, limit, ranking)) {
+      json err;
+      err["errorMessage"] = "Profile not found";
+      res.status = 404;
+      res.set_content(err.dump(), "application/json");
+      return;
+    }
+
+    json out;
+    out["board"] = boardName;
+    std::string week;
+    util::formatDateTime(static_cast<std::int64_t>(ranking.week) * 86400000, util::DateTimeFormat::Date, week);
+    out["week"] = week;
+    out["users"] = ranking.ranked;
+    json top = json::array();
+    for (std::size_t i = 0; i < ranking.top.size(); ++i) {
+      json entry;
+      entry["rank"] = i + 1;
+      entry["name"] = ranking.top[i].name;
+      entry["score"] = ranking.top[i].score;
+      top.push_back(std::move(entry));
+    }
+    out["top"] = std::move(top);
+    if (ranking.myRank > 0) {
+      out["me"]["rank"] = ranking.myRank;
+      out["me"]["score"] = ranking.myScore;
+    } else {
+      out["me"] = nullptr;
+    }
+
+    res.status = 200;
+    setJsonContent(res, out);
+  });
+
   // =======================
   //   Custom Categories
   // =======================
 
   // GET /category/list
   svr.Get("/category/list", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -903,17 +1235,17 @@ int main() {
       json jc;
       jc["id"] = name;
       jc["categoryName"] = name;
-      arr.push_back(jc);
+      arr.push_back(std::move(jc));
     }
 
     res.status = 200;
-    res.set_content(arr.dump(), "application/json");
+    setJsonContent(res, arr);
   });
 
   // ===== CHANGED: /category/create 會呼叫 backend.createCategory =====
   // POST /category/create
   svr.Post("/category/create", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -923,7 +1255,7 @@ int main() {
     }
 
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
       if (!j.contains("categoryName")) {
         json err;
         err["errorMessage"] = "Missing categoryName";
@@ -947,7 +1279,7 @@ int main() {
       out["id"] = name;
       out["categoryName"] = name;
       res.status = 201;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -959,7 +1291,7 @@ int main() {
   // ===== NEW: DELETE 整個 category =====
   // DELETE /category/{categoryId}
   svr.Delete(R"(/category/([^/]+)$)", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -985,7 +1317,7 @@ int main() {
 
   // GET /category/{categoryId}/list
   svr.Get(R"(/category/([^/]+)/list)", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -996,32 +1328,46 @@ int main() {
 
     std::string categoryId = req.matches[1];
 
-    auto records = backend.getOtherRecords(token, categoryId);
-    if (records.empty()) {
+    TimeRange range;
+    if (!parseTimeRange(req, range)) {
       json err;
-      err["errorMessage"] = "Category not found or no items";
-      res.status = 404;
+      err["errorMessage"] = "Invalid from/to datetime";
+      res.status = 400;
       res.set_content(err.dump(), "application/json");
       return;
     }
 
     json arr = json::array();
-    for (std::size_t i = 0; i < records.size(); ++i) {
-      const auto& r = records[i];
+    auto append = [&arr](std::size_t i, const CategoryItem& r) {
       json jr;
       jr["id"] = std::to_string(i);
-      jr["datetime"] = r.datetime;
+      jr["datetime"] = r.datetime.str();
       jr["note"] = r.note;
-      arr.push_back(jr);
+      arr.push_back(std::move(jr));
+    };
+    if (range.active) {
+      for (const auto& [i, r] : backend.getOtherRecordsBetween(token, categoryId, range.fromMs, range.toMs)) {
+        append(i, r);
+      }
+    } else {
+      auto records = backend.getOtherRecords(token, categoryId);
+      for (std::size_t i = 0; i < records.size(); ++i) append(i, records[i]);
+    }
+    if (arr.empty()) {
+      json err;
+      err["errorMessage"] = "Category not found or no items";
+      res.status = 404;
+      res.set_content(err.dump(), "application/json");
+      return;
     }
 
     res.status = 200;
-    res.set_content(arr.dump(), "application/json");
+    setJsonContent(res, arr);
   });
 
   // POST /category/{categoryId}/add
   svr.Post(R"(/category/([^/]+)/add)", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -1033,7 +1379,7 @@ int main() {
     std::string categoryId = req.matches[1];
 
     try {
-      json j = json::parse(req.body);
+      json j = parseBody(req);
       if (!j.contains("datetime") || !j.contains("note")) {
         json err;
         err["errorMessage"] = "Missing datetime or note";
@@ -1043,9 +1389,11 @@ int main() {
       }
 
       std::string datetime = j["datetime"].get<std::string>();
+      if (!checkDateTime(datetime, res)) return;
       std::string note = j["note"].get<std::string>();
 
-      bool ok = backend.addOtherRecord(token, categoryId, datetime, 0.0, note);
+      std::size_t idx = 0;
+      bool ok = backend.addOtherRecord(token, categoryId, datetime, 0.0, note, &idx);
       if (!ok) {
         json err;
         err["errorMessage"] = "Category not found or invalid data";
@@ -1054,17 +1402,13 @@ int main() {
         return;
       }
 
-      auto records = backend.getOtherRecords(token, categoryId);
-      std::size_t idx = records.size() - 1;
-      const auto& r = records[idx];
-
       json out;
       out["id"] = std::to_string(idx);
       out["categoryId"] = categoryId;
-      out["datetime"] = r.datetime;
-      out["note"] = r.note;
+      out["datetime"] = datetime;
+      out["note"] = note;
       res.status = 201;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -1075,7 +1419,7 @@ int main() {
 
   // PATCH /category/{categoryId}/{itemId}
   svr.Patch(R"(/category/([^/]+)/([^/]+))", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -1089,9 +1433,9 @@ int main() {
     std::size_t index = 0;
 
     try {
-      json j = json::parse(req.body);
-      auto records = backend.getOtherRecords(token, categoryId);
-      if (index >= records.size()) {
+      json j = parseBody(req);
+      CategoryItem current;
+      if (!backend.getOtherRecord(token, categoryId, index, current)) {
         json err;
         err["errorMessage"] = "Category or item not found";
         res.status = 404;
@@ -1099,12 +1443,14 @@ int main() {
         return;
       }
 
-      std::string newDatetime = records[index].datetime;
-      std::string newNote = records[index].note;
-      double value = records[index].value;
+      std::string newDatetime = current.datetime.str();
+      std::string newNote = current.note;
+      double value = current.value;
 
       if (j.contains("datetime")) {
-        newDatetime = j["datetime"].get<std::string>();
+        std::string requested = j["datetime"].get<std::string>();
+        if (requested != newDatetime && !checkDateTime(requested, res)) return;  // 沒改的話舊資料照舊
+        newDatetime = std::move(requested);
       }
       if (j.contains("note")) {
         newNote = j["note"].get<std::string>();
@@ -1125,7 +1471,7 @@ int main() {
       out["datetime"] = newDatetime;
       out["note"] = newNote;
       res.status = 200;
-      res.set_content(out.dump(), "application/json");
+      setJsonContent(res, out);
     } catch (const std::exception& e) {
       json err;
       err["errorMessage"] = std::string("Invalid JSON: ") + e.what();
@@ -1136,7 +1482,7 @@ int main() {
 
   // DELETE /category/{categoryId}/{itemId}
   svr.Delete(R"(/category/([^/]+)/([^/]+))", [&backend](const httplib::Request& req, httplib::Response& res) {
-    std::string token = getTokenFromAuthHeader(req);
+    std::string_view token = getTokenFromAuthHeader(req);
     if (token.empty()) {
       json err;
       err["errorMessage"] = "Missing or invalid Authorization token";
@@ -1162,9 +1508,17 @@ int main() {
     res.set_content("", "application/json");
   });
 
-  util::Logger::info("Server started at http://0.0.0.0:8080");
+  g_server = &svr;
+  std::signal(SIGINT, handleStopSignal);
+  std::signal(SIGTERM, handleStopSignal);
+
+  HB_LOG_INFO("Server started at http://0.0.0.0:8080");
   svr.listen("0.0.0.0", 8080);
 
+  // 背景存檔還沒寫的修改：關掉前整份存一次（也是最後一次備份輪替）
+  backend.saveToFile();
+
+  util::trace::shutdown();
   util::Logger::shutdown();
 
   return 0;
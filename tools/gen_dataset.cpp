@@ -0,0 +1,367 @@
+// tools/gen_dataset.cpp
+// 產生大量假資料的 storage.json（跟 HealthBackend::loadFromFile 讀的格式一樣），測啟動時間 / 存檔速度用
+//
+//   gen_dataset --users 10000 --records 100 -o data/storage.json
+//   gen_dataset --users 1000 --records 500 --skew 1.1 -o heavy.json   -> 前面幾個 user 佔大部分資料
+//   gen_dataset --users 10000 --format binary -o data/storage.snap    -> binary snapshot（見 backend/Snapshot.hpp）
+//
+// 一次只在記憶體放一個 user，邊產生邊寫出，所以可以產生比記憶體大的檔案。
+// 使用者是 <prefix>0, <prefix>1, ...，密碼 pw0, pw1, ...（login 測試可以直接用）。
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../backend/HealthBackend.hpp"
+#include "../backend/Snapshot.hpp"
+
+namespace {
+
+struct Options {
+  std::size_t users = 1000;
+  std::size_t recordsPerUser = 100;  // 平均值；skew > 0 時集中在前面的 user
+  double skew = 0.0;                 // Zipf 指數：第 i 個 user 的份量 ∝ 1 / (i+1)^skew
+  std::size_t categories = 2;        // 每個 user 的自訂 category 數
+  std::uint64_t seed = 42;
+  std::string prefix = "user";
+  std::string format = "json";
+  std::string outPath = "data/storage.json";
+};
+
+// 各類型佔的比例（剩下的給 category items）
+constexpr double kWaterShare = 0.40;
+constexpr double kSleepShare = 0.15;
+constexpr double kActivityShare = 0.25;
+
+const char* const kIntensities[] = {"low", "moderate", "high"};
+const char* const kNotes[] = {"ok", "good day", "tired", "headache", "great", "stressed", "calm"};
+const char* const kGenders[] = {"male", "female", "other"};
+
+// ===== 輸出格式 =====
+// 新的 storage 格式加一個 DatasetWriter 實作，再在 makeWriter() 登記即可
+
+class DatasetWriter {
+ public:
+  virtual ~DatasetWriter() = default;
+  virtual bool open(const std::string& path) = 0;
+  virtual void writeUser(const HealthBackend::UserData& user) = 0;
+  virtual bool close() = 0;  // false = 寫入失敗
+  virtual std::uint64_t bytesWritten() const = 0;
+};
+
+// 跟 saveToFile() 一樣的 JSON 結構與 key 順序（compact，不縮排）
+class JsonDatasetWriter : public DatasetWriter {
+ public:
+  bool open(const std::string& path) override {
+    file_ = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+    if (!file_) return false;
+    buf_.reserve(1 << 20);
+    buf_ += "{\"users\":[";
+    return true;
+  }
+
+  void writeUser(const HealthBackend::UserData& u) override {
+    if (!firstUser_) buf_ += ',';
+    firstUser_ = false;
+
+    buf_ += "{\"activities\":[";
+    for (std::size_t i = 0; i < u.activities.size(); ++i) {
+      const auto& a = u.activities[i];
+      if (i) buf_ += ',';
+      buf_ += "{\"datetime\":";
+      appendString(a.datetime);
+      buf_ += ",\"intensity\":";
+      appendString(a.intensity.str());
+      buf_ += ",\"minutes\":" + std::to_string(a.minutes) + "}";
+    }
+    buf_ += "],\"age\":" + std::to_string(u.profile.age) + ",\"categories\":{";
+    // saveToFile() 的 categories 照名字排；u.categories 是照 symbol id
+    std::map<std::string_view, const std::vector<CategoryItem>*> byName;
+    for (const auto& [name, items] : u.categories) byName.emplace(name.str(), &items);
+    bool firstCat = true;
+    for (const auto& [name, vec] : byName) {
+      const auto& items = *vec;
+      if (!firstCat) buf_ += ',';
+      firstCat = false;
+      appendString(name);
+      buf_ += ":[";
+      for (std::size_t i = 0; i < items.size(); ++i) {
+        if (i) buf_ += ',';
+        buf_ += "{\"datetime\":";
+        appendString(items[i].datetime);
+        buf_ += ",\"note\":";
+        appendString(items[i].note);
+        buf_ += ",\"value\":";
+        appendNumber(items[i].value);
+        buf_ += '}';
+      }
+      buf_ += ']';
+    }
+    buf_ += "},\"gender\":";
+    appendString(u.profile.gender);
+    buf_ += ",\"heightM\":";
+    appendNumber(u.profile.heightM);
+    buf_ += ",\"id\":";
+    appendString(u.profile.id);
+    buf_ += ",\"name\":";
+    appendString(u.profile.name);
+    buf_ += ",\"password\":";
+    appendString(u.password);
+    buf_ += ",\"sleeps\":[";
+    for (std::size_t i = 0; i < u.sleeps.size(); ++i) {
+      if (i) buf_ += ',';
+      buf_ += "{\"datetime\":";
+      appendString(u.sleeps[i].datetime);
+      buf_ += ",\"hours\":";
+      appendNumber(u.sleeps[i].hours);
+      buf_ += '}';
+    }
+    buf_ += "],\"waters\":[";
+    for (std::size_t i = 0; i < u.waters.size(); ++i) {
+      if (i) buf_ += ',';
+      buf_ += "{\"amountMl\":";
+      appendNumber(u.waters[i].amountMl);
+      buf_ += ",\"datetime\":";
+      appendString(u.waters[i].datetime);
+      buf_ += '}';
+    }
+    buf_ += "],\"weightKg\":";
+    appendNumber(u.profile.weightKg);
+    buf_ += '}';
+
+    if (buf_.size() >= (1 << 20)) flush();
+  }
+
+  bool close() override {
+    buf_ += "]}\n";
+    flush();
+    bool ok = !std::ferror(file_);
+    if (file_ != stdout) ok = std::fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    return ok;
+  }
+
+  std::uint64_t bytesWritten() const override { return bytes_; }
+
+ private:
+  void flush() {
+    bytes_ += std::fwrite(buf_.data(), 1, buf_.size(), file_);
+    buf_.clear();
+  }
+
+  void appendString(const util::PackedDateTime& d) {
+    util::PackedDateTime::Buffer buf;
+    appendString(d.view(buf));
+  }
+
+  void appendString(std::string_view s) {
+    buf_ += '"';
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        buf_ += '\\';
+        buf_ += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char esc[8];
+        std::snprintf(esc, sizeof(esc), "\\u%04x", static_cast<unsigned>(c));
+        buf_ += esc;
+      } else {
+        buf_ += c;
+      }
+    }
+    buf_ += '"';
+  }
+
+  void appendNumber(double v) {
+    char num[32];
+    std::snprintf(num, sizeof(num), "%.1f", v);
+    buf_ += num;
+  }
+
+  std::FILE* file_ = nullptr;
+  std::string buf_;
+  bool firstUser_ = true;
+  std::uint64_t bytes_ = 0;
+};
+
+// binary snapshot（HealthBackend 的 .snap 格式），要能回頭補 header，所以不能輸出到 stdout
+class SnapshotDatasetWriter : public DatasetWriter {
+ public:
+  bool open(const std::string& path) override { return path != "-" && writer_.open(path); }
+  void writeUser(const HealthBackend::UserData& user) override { writer_.writeUser(user); }
+  bool close() override {
+    if (writer_.close()) return true;
+    std::cerr << writer_.error() << "\n";
+    return false;
+  }
+  std::uint64_t bytesWritten() const override { return writer_.bytesWritten(); }
+
+ private:
+  SnapshotWriter writer_;
+};
+
+std::unique_ptr<DatasetWriter> makeWriter(const std::string& format) {
+  if (format == "json") return std::make_unique<JsonDatasetWriter>();
+  if (format == "binary") return std::make_unique<SnapshotDatasetWriter>();
+  return nullptr;
+}
+
+// ===== 產生資料 =====
+
+// 每個 user 的筆數：總數 users * recordsPerUser 依 Zipf 權重分配
+std::vector<std::size_t> recordCounts(const Options& opt) {
+  std::vector<double> weights(opt.users);
+  double sum = 0.0;
+  for (std::size_t i = 0; i < opt.users; ++i) sum += weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), opt.skew);
+
+  const std::size_t total = opt.users * opt.recordsPerUser;
+  std::vector<std::size_t> counts(opt.users);
+  std::size_t assigned = 0;
+  for (std::size_t i = 0; i < opt.users; ++i) {
+    counts[i] = static_cast<std::size_t>(static_cast<double>(total) * weights[i] / sum);
+    assigned += counts[i];
+  }
+  for (std::size_t i = 0; assigned < total; i = (i + 1) % opt.users, ++assigned) ++counts[i];
+  return counts;
+}
+
+std::string isoTime(std::time_t t) {
+  std::tm tm{};
+  gmtime_r(&t, &tm);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+  return buf;
+}
+
+// n 個依時間排序的時間點，平均散在 2024 年一整年（加一點 jitter）
+std::vector<std::string> timeline(std::size_t n, std::mt19937_64& rng) {
+  constexpr std::time_t kStart = 1704067200;  // 2024-01-01T00:00:00Z
+  constexpr std::time_t kSpan = 366 * 24 * 3600;
+  std::vector<std::string> out;
+  out.reserve(n);
+  if (n == 0) return out;
+  const std::time_t step = std::max<std::time_t>(1, kSpan / static_cast<std::time_t>(n));
+  for (std::size_t k = 0; k < n; ++k) {
+    const std::time_t jitter = static_cast<std::time_t>(rng() % static_cast<std::uint64_t>(step));
+    out.push_back(isoTime(kStart + static_cast<std::time_t>(k) * step + jitter));
+  }
+  return out;
+}
+
+void makeUser(const Options& opt, std::size_t index, std::size_t records, std::mt19937_64& rng,
+              HealthBackend::UserData& u) {
+  u = HealthBackend::UserData{};
+  u.profile.name = opt.prefix + std::to_string(index);
+  u.profile.id = u.profile.name;
+  u.profile.age = 18 + static_cast<int>(rng() % 60);
+  u.profile.heightM = 1.50 + static_cast<double>(rng() % 45) / 100.0;
+  u.profile.weightKg = 45.0 + static_cast<double>(rng() % 600) / 10.0;
+  u.profile.gender = kGenders[rng() % 3];
+  u.password = "pw" + std::to_string(index);
+
+  const util::Symbol intensities[] = {util::Symbol(kIntensities[0]), util::Symbol(kIntensities[1]),
+                                      util::Symbol(kIntensities[2])};
+  const auto waters = static_cast<std::size_t>(static_cast<double>(records) * kWaterShare);
+  const auto sleeps = static_cast<std::size_t>(static_cast<double>(records) * kSleepShare);
+  const auto activities = static_cast<std::size_t>(static_cast<double>(records) * kActivityShare);
+  std::size_t items = records - waters - sleeps - activities;
+  std::size_t extraWaters = 0;
+  if (opt.categories == 0) std::swap(items, extraWaters);  // 沒有 category 就全部算 water
+
+  for (const auto& dt : timeline(waters + extraWaters, rng)) {
+    u.waters.push_back(WaterRecord{util::PackedDateTime(dt), 100.0 + static_cast<double>(rng() % 50) * 10.0});
+  }
+  for (const auto& dt : timeline(sleeps, rng)) {
+    u.sleeps.push_back(SleepRecord{util::PackedDateTime(dt), 4.0 + static_cast<double>(rng() % 60) / 10.0});
+  }
+  for (const auto& dt : timeline(activities, rng)) {
+    u.activities.push_back(
+        ActivityRecord{util::PackedDateTime(dt), 10 + static_cast<int>(rng() % 110), intensities[rng() % 3]});
+  }
+  for (std::size_t c = 0; c < opt.categories; ++c) {
+    const std::size_t n = items / opt.categories + (c < items % opt.categories ? 1 : 0);
+    auto& vec = u.categories[util::Symbol("category" + std::to_string(c))];
+    for (const auto& dt : timeline(n, rng)) {
+      vec.push_back(CategoryItem{util::PackedDateTime(dt), kNotes[rng() % (sizeof(kNotes) / sizeof(kNotes[0]))],
+                                 static_cast<double>(rng() % 10)});
+    }
+  }
+}
+
+void usage() {
+  std::cerr << "usage: gen_dataset [--users N] [--records avg-per-user] [--skew S] [--categories C]\n"
+               "                   [--seed N] [--prefix name] [--format json|binary] [-o path|-]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--users" && hasValue) {
+      opt.users = std::strtoull(argv[++i], nullptr, 10);
+    } else if (a == "--records" && hasValue) {
+      opt.recordsPerUser = std::strtoull(argv[++i], nullptr, 10);
+    } else if (a == "--skew" && hasValue) {
+      opt.skew = std::max(0.0, std::atof(argv[++i]));
+    } else if (a == "--categories" && hasValue) {
+      opt.categories = std::strtoull(argv[++i], nullptr, 10);
+    } else if (a == "--seed" && hasValue) {
+      opt.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (a == "--prefix" && hasValue) {
+      opt.prefix = argv[++i];
+    } else if (a == "--format" && hasValue) {
+      opt.format = argv[++i];
+    } else if ((a == "-o" || a == "--out") && hasValue) {
+      opt.outPath = argv[++i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (opt.users == 0) {
+    usage();
+    return 2;
+  }
+
+  auto writer = makeWriter(opt.format);
+  if (!writer) {
+    std::cerr << "unknown format: " << opt.format << "\n";
+    return 2;
+  }
+  if (!writer->open(opt.outPath)) {
+    std::cerr << "cannot open " << opt.outPath << " for writing\n";
+    return 1;
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  const std::vector<std::size_t> counts = recordCounts(opt);
+  std::mt19937_64 rng(opt.seed);
+  HealthBackend::UserData user;
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < opt.users; ++i) {
+    makeUser(opt, i, counts[i], rng, user);
+    writer->writeUser(user);
+    total += counts[i];
+  }
+  if (!writer->close()) {
+    std::cerr << "write to " << opt.outPath << " failed\n";
+    return 1;
+  }
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  std::cerr << opt.users << " users, " << total << " records (heaviest user " << counts.front() << "), "
+            << writer->bytesWritten() << " bytes, " << opt.format << ", " << secs << " s\n";
+  return 0;
+}
@@ -0,0 +1,362 @@
+// tools/loadgen.cpp
+// server_app 的 HTTP 壓測工具（取代 test/test.js 做效能測試）
+//
+//   loadgen -c 16 -d 30                         -> closed loop：16 條連線，各自一個接一個送
+//   loadgen -c 16 -d 30 --rate 2000             -> open loop：總共每秒 2000 個 request，依排程送出
+//   loadgen --mix register=0,login=1,add=5,list=10 --json
+//
+// Open loop 的 latency 從「排定的送出時間」開始算，server 變慢時排隊的時間也會算進去
+// （避免 coordinated omission）。
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../external/json.hpp"
+#include "../helpers/Metrics.hpp"
+#include "../httplib.h"
+
+using json = nlohmann::ordered_json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum class Op { Register, Login, Profile, Add, List, Category };
+constexpr std::size_t kOpCount = 6;
+const char* const kOpNames[kOpCount] = {"register", "login", "profile", "add", "list", "category"};
+
+struct Options {
+  std::string host = "localhost";
+  int port = 8080;
+  int connections = 8;
+  double durationSec = 10.0;
+  std::uint64_t totalRequests = 0;  // > 0: 送完這麼多就停（不看 duration）
+  double rate = 0.0;                // 0 = closed loop；> 0 = 每秒總 request 數
+  int poolUsers = 50;               // 事先註冊好、拿來 login / add / list 的使用者
+  double weights[kOpCount] = {1, 2, 2, 10, 10, 2};
+  int timeoutSec = 5;
+  bool asJson = false;
+};
+
+struct OpStats {
+  util::LatencyHistogram latency;
+  std::atomic<std::uint64_t> errors{0};
+  std::atomic<std::uint64_t> maxMicros{0};
+
+  void record(std::uint64_t micros, bool ok) {
+    latency.record(micros);
+    if (!ok) errors.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t prev = maxMicros.load(std::memory_order_relaxed);
+    while (micros > prev && !maxMicros.compare_exchange_weak(prev, micros, std::memory_order_relaxed)) {
+    }
+  }
+};
+
+struct PoolUser {
+  std::string name;
+  std::string token;
+};
+
+// 每個 record type 對應的 POST body / GET path
+const char* const kAddPaths[] = {"/waters", "/sleeps", "/activities", "/category/lg/add"};
+const char* const kAddBodies[] = {
+    R"({"datetime":"2025-01-01T08:00:00Z","amountMl":250})",
+    R"({"datetime":"2025-01-01T23:00:00Z","hours":7.5})",
+    R"({"datetime":"2025-01-01T18:00:00Z","minutes":30,"intensity":"moderate"})",
+    R"({"datetime":"2025-01-01T12:00:00Z","note":"loadgen"})",
+};
+const char* const kListPaths[] = {"/waters", "/sleeps", "/activities", "/category/lg/list"};
+
+bool parseMix(const std::string& spec, double (&weights)[kOpCount]) {
+  for (double& w : weights) w = 0.0;
+  std::size_t pos = 0;
+  while (pos < spec.size()) {
+    std::size_t comma = spec.find(',', pos);
+    if (comma == std::string::npos) comma = spec.size();
+    const std::string item = spec.substr(pos, comma - pos);
+    const std::size_t eq = item.find('=');
+    bool known = false;
+    for (std::size_t i = 0; i < kOpCount && eq != std::string::npos; ++i) {
+      if (item.compare(0, eq, kOpNames[i]) == 0 && std::strlen(kOpNames[i]) == eq) {
+        weights[i] = std::max(0.0, std::atof(item.c_str() + eq + 1));
+        known = true;
+      }
+    }
+    if (!known) {
+      std::cerr << "unknown mix entry: " << item << "\n";
+      return false;
+    }
+    pos = comma + 1;
+  }
+  double total = 0.0;
+  for (double w : weights) total += w;
+  return total > 0.0;
+}
+
+bool statusOk(const httplib::Result& res) { return res && res->status >= 200 && res->status < 300; }
+
+httplib::Headers authHeaders(const std::string& token) { return {{"Authorization", "Bearer " + token}}; }
+
+// 先註冊一批使用者並建好 "lg" category
+bool setupPool(const Options& opt, const std::string& runId, std::vector<PoolUser>& pool) {
+  httplib::Client cli(opt.host, opt.port);
+  cli.set_connection_timeout(opt.timeoutSec);
+  cli.set_read_timeout(opt.timeoutSec);
+  cli.set_keep_alive(true);
+  cli.set_tcp_nodelay(true);
+
+  for (int i = 0; i < opt.poolUsers; ++i) {
+    PoolUser u;
+    u.name = "lg" + runId + "_u" + std::to_string(i);
+    json body = {{"name", u.name}, {"password", "pw"}, {"age", 30},
+                 {"weightKg", 70.0}, {"heightM", 1.75}, {"gender", "other"}};
+    auto res = cli.Post("/register", body.dump(), "application/json");
+    if (!res) {
+      std::cerr << "cannot reach " << opt.host << ":" << opt.port << " (" << httplib::to_string(res.error())
+                << ")\n";
+      return false;
+    }
+    if (res->status != 201) {
+      std::cerr << "register " << u.name << " failed: " << res->status << " " << res->body << "\n";
+      return false;
+    }
+    u.token = json::parse(res->body).value("token", std::string());
+    // 空的 category list 會回 404，先放一筆
+    cli.Post("/category/create", authHeaders(u.token), R"({"categoryName":"lg"})", "application/json");
+    cli.Post("/category/lg/add", authHeaders(u.token), kAddBodies[3], "application/json");
+    pool.push_back(std::move(u));
+  }
+  return true;
+}
+
+struct Shared {
+  const Options& opt;
+  const std::vector<PoolUser>& pool;
+  std::string runId;
+  double cumulative[kOpCount];
+  OpStats stats[kOpCount];
+  std::atomic<std::uint64_t> issued{0};
+  std::atomic<std::uint64_t> transportErrors{0};
+  Clock::time_point start;
+  Clock::time_point deadline;
+
+  Shared(const Options& o, const std::vector<PoolUser>& p) : opt(o), pool(p) {}
+};
+
+Op pickOp(const Shared& sh, std::mt19937_64& rng) {
+  const double x = std::uniform_real_distribution<double>(0.0, sh.cumulative[kOpCount - 1])(rng);
+  for (std::size_t i = 0; i < kOpCount; ++i) {
+    if (x < sh.cumulative[i]) return static_cast<Op>(i);
+  }
+  return Op::List;
+}
+
+httplib::Result runOp(Op op, httplib::Client& cli, Shared& sh, std::mt19937_64& rng, int worker,
+                      std::uint64_t& seq) {
+  const PoolUser& u = sh.pool[rng() % sh.pool.size()];
+  switch (op) {
+    case Op::Register: {
+      json body = {{"name", "lg" + sh.runId + "_w" + std::to_string(worker) + "_" + std::to_string(seq++)},
+                   {"password", "pw"}, {"age", 30}, {"weightKg", 70.0}, {"heightM", 1.75}, {"gender", "other"}};
+      return cli.Post("/register", body.dump(), "application/json");
+    }
+    case Op::Login: {
+      json body = {{"name", u.name}, {"password", "pw"}};
+      return cli.Post("/login", body.dump(), "application/json");
+    }
+    case Op::Profile:
+      return cli.Get("/user/profile", authHeaders(u.token));
+    case Op::Add: {
+      const std::size_t k = rng() % 4;
+      return cli.Post(kAddPaths[k], authHeaders(u.token), kAddBodies[k], "application/json");
+    }
+    case Op::List:
+      return cli.Get(kListPaths[rng() % 4], authHeaders(u.token));
+    case Op::Category:
+      return cli.Get("/category/list", authHeaders(u.token));
+  }
+  return cli.Get("/health");
+}
+
+void worker(Shared& sh, int id) {
+  const Options& opt = sh.opt;
+  httplib::Client cli(opt.host, opt.port);
+  cli.set_connection_timeout(opt.timeoutSec);
+  cli.set_read_timeout(opt.timeoutSec);
+  cli.set_keep_alive(true);
+  cli.set_tcp_nodelay(true);
+
+  std::mt19937_64 rng(0x9E3779B97F4A7C15ull * static_cast<std::uint64_t>(id + 1));
+  std::uint64_t seq = 0;
+
+  // open loop：每條連線分到 rate / connections，起點錯開
+  const bool openLoop = opt.rate > 0.0;
+  const auto interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(openLoop ? opt.connections / opt.rate : 0.0));
+  Clock::time_point next = sh.start + interval * id / std::max(1, opt.connections);
+
+  for (;;) {
+    if (opt.totalRequests > 0) {
+      if (sh.issued.fetch_add(1, std::memory_order_relaxed) >= opt.totalRequests) break;
+    } else if (Clock::now() >= sh.deadline) {
+      break;
+    }
+
+    Clock::time_point intended;
+    if (openLoop) {
+      if (opt.totalRequests == 0 && next >= sh.deadline) break;
+      std::this_thread::sleep_until(next);
+      intended = next;
+      next += interval;
+    } else {
+      intended = Clock::now();
+    }
+
+    const Op op = pickOp(sh, rng);
+    auto res = runOp(op, cli, sh, rng, id, seq);
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - intended).count();
+    if (!res) sh.transportErrors.fetch_add(1, std::memory_order_relaxed);
+    sh.stats[static_cast<std::size_t>(op)].record(static_cast<std::uint64_t>(micros), statusOk(res));
+  }
+}
+
+json latencyJson(const util::LatencyHistogram& h, std::uint64_t maxMicros) {
+  // quantile 回的是 bucket 上界，不要超過實際的 max
+  auto q = [&](double p) { return std::min(h.quantile(p), maxMicros); };
+  json j;
+  j["mean_us"] = h.count() ? static_cast<double>(h.sum()) / static_cast<double>(h.count()) : 0.0;
+  j["p50_us"] = q(0.50);
+  j["p90_us"] = q(0.90);
+  j["p99_us"] = q(0.99);
+  j["p999_us"] = q(0.999);
+  j["max_us"] = maxMicros;
+  return j;
+}
+
+void usage() {
+  std::cerr << "usage: loadgen [--host H] [--port P] [-c connections] [-d seconds] [-n requests]\n"
+               "               [--rate req/s] [--users N] [--mix register=1,login=2,profile=2,add=10,list=10,"
+               "category=2]\n"
+               "               [--timeout seconds] [--json]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--json") {
+      opt.asJson = true;
+    } else if (a == "--host" && hasValue) {
+      opt.host = argv[++i];
+    } else if (a == "--port" && hasValue) {
+      opt.port = std::atoi(argv[++i]);
+    } else if ((a == "-c" || a == "--connections") && hasValue) {
+      opt.connections = std::max(1, std::atoi(argv[++i]));
+    } else if ((a == "-d" || a == "--duration") && hasValue) {
+      opt.durationSec = std::atof(argv[++i]);
+    } else if ((a == "-n" || a == "--requests") && hasValue) {
+      opt.totalRequests = std::strtoull(argv[++i], nullptr, 10);
+    } else if (a == "--rate" && hasValue) {
+      opt.rate = std::atof(argv[++i]);
+    } else if (a == "--users" && hasValue) {
+      opt.poolUsers = std::max(1, std::atoi(argv[++i]));
+    } else if (a == "--timeout" && hasValue) {
+      opt.timeoutSec = std::max(1, std::atoi(argv[++i]));
+    } else if (a == "--mix" && hasValue) {
+      if (!parseMix(argv[++i], opt.weights)) {
+        usage();
+        return 2;
+      }
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  // 每次跑都用新的使用者名稱，不會跟之前留在 storage.json 的撞名
+  const std::string runId = std::to_string(
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+          .count());
+
+  std::vector<PoolUser> pool;
+  if (!setupPool(opt, runId, pool)) return 1;
+
+  Shared sh(opt, pool);
+  sh.runId = runId;
+  double acc = 0.0;
+  for (std::size_t i = 0; i < kOpCount; ++i) sh.cumulative[i] = (acc += opt.weights[i]);
+
+  sh.start = Clock::now();
+  sh.deadline = sh.start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.durationSec));
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < opt.connections; ++i) threads.emplace_back(worker, std::ref(sh), i);
+  for (auto& t : threads) t.join();
+  const double elapsed = std::chrono::duration<double>(Clock::now() - sh.start).count();
+
+  util::LatencyHistogram all;
+  std::uint64_t total = 0, errors = 0, maxMicros = 0;
+  json ops = json::object();
+  for (std::size_t i = 0; i < kOpCount; ++i) {
+    const OpStats& st = sh.stats[i];
+    const std::uint64_t n = st.latency.count();
+    if (n == 0) continue;
+    total += n;
+    errors += st.errors.load();
+    maxMicros = std::max(maxMicros, st.maxMicros.load());
+    all.merge(st.latency);
+    json j;
+    j["requests"] = n;
+    j["errors"] = st.errors.load();
+    j["throughput_rps"] = static_cast<double>(n) / elapsed;
+    j["latency"] = latencyJson(st.latency, st.maxMicros.load());
+    ops[kOpNames[i]] = std::move(j);
+  }
+
+  json out;
+  out["config"] = {{"host", opt.host},       {"port", opt.port},  {"connections", opt.connections},
+                   {"duration_s", opt.durationSec}, {"requests", opt.totalRequests},
+                   {"rate", opt.rate},       {"users", opt.poolUsers}};
+  out["elapsed_s"] = elapsed;
+  out["requests"] = total;
+  out["errors"] = errors;
+  out["transport_errors"] = sh.transportErrors.load();
+  out["throughput_rps"] = static_cast<double>(total) / elapsed;
+  out["latency"] = latencyJson(all, maxMicros);
+  out["ops"] = std::move(ops);
+
+  if (opt.asJson) {
+    std::cout << out.dump(2) << "\n";
+    return 0;
+  }
+
+  std::printf("%s loop, %d connections, %.1f s, %llu requests, %llu errors (%llu transport)\n",
+              opt.rate > 0.0 ? "open" : "closed", opt.connections, elapsed, static_cast<unsigned long long>(total),
+              static_cast<unsigned long long>(errors),
+              static_cast<unsigned long long>(sh.transportErrors.load()));
+  std::printf("throughput: %.1f req/s\n\n", static_cast<double>(total) / elapsed);
+  std::printf("%-10s %10s %8s %10s %10s %10s %10s %10s %10s\n", "op", "requests", "errors", "req/s", "mean ms",
+              "p50 ms", "p90 ms", "p99 ms", "max ms");
+  auto row = [&](const char* name, const json& j) {
+    const json& l = j["latency"];
+    std::printf("%-10s %10llu %8llu %10.1f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name,
+                static_cast<unsigned long long>(j["requests"].get<std::uint64_t>()),
+                static_cast<unsigned long long>(j["errors"].get<std::uint64_t>()), j["throughput_rps"].get<double>(),
+                l["mean_us"].get<double>() / 1000.0, l["p50_us"].get<double>() / 1000.0,
+                l["p90_us"].get<double>() / 1000.0, l["p99_us"].get<double>() / 1000.0,
+                l["max_us"].get<double>() / 1000.0);
+  };
+  for (const auto& [name, j] : out["ops"].items()) row(name.c_str(), j);
+  row("all", out);
+  return 0;
+}
@@ -0,0 +1,194 @@
+// tools/log_decode.cpp
+// 把 binary log（LOG_FORMAT=binary）轉回文字或 JSON lines
+//
+//   log_decode logs/server.blog            -> "[2025-01-01 12:00:00.123] [INFO] GET /waters -> 200 (0 ms)"
+//   log_decode --json logs/server.blog     -> {"ts":..., "level":"INFO", "fmt":..., "args":[...], "msg":...}
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../external/json.hpp"
+#include "../helpers/BinaryLog.hpp"
+#include "../helpers/LogFormat.hpp"
+
+using json = nlohmann::ordered_json;
+namespace binlog = util::binlog;
+
+namespace {
+
+const char* levelName(std::uint8_t level) {
+  switch (level) {
+    case 0: return "DEBUG";
+    case 1: return "INFO";
+    case 2: return "WARN";
+    case 3: return "ERROR";
+  }
+  return "?";
+}
+
+std::string formatTime(std::uint64_t micros) {
+  const auto sec = static_cast<std::time_t>(micros / 1000000);
+  std::tm tm{};
+  localtime_r(&sec, &tm);
+  char buf[40];
+  std::size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+  std::snprintf(buf + n, sizeof(buf) - n, ".%03u", static_cast<unsigned>((micros / 1000) % 1000));
+  return buf;
+}
+
+// 解出一個參數：text 給格式化用，value 給 JSON 用
+bool decodeArg(const char*& p, const char* end, std::string& text, json& value) {
+  if (p >= end) return false;
+  const char tag = *p++;
+  std::uint64_t v = 0;
+  switch (tag) {
+    case binlog::kArgInt: {
+      if (!binlog::getVarint(p, end, v)) return false;
+      const auto s = static_cast<std::int64_t>((v >> 1) ^ (~(v & 1) + 1));
+      text = std::to_string(s);
+      value = s;
+      return true;
+    }
+    case binlog::kArgUInt:
+      if (!binlog::getVarint(p, end, v)) return false;
+      text = std::to_string(v);
+      value = v;
+      return true;
+    case binlog::kArgDouble: {
+      if (!binlog::getFixed64(p, end, v)) return false;
+      double d;
+      std::memcpy(&d, &v, sizeof(d));
+      text.clear();
+      util::detail::appendArg(text, d);
+      value = d;
+      return true;
+    }
+    case binlog::kArgBool:
+      if (p >= end) return false;
+      value = (*p++ != 0);
+      text = value.get<bool>() ? "true" : "false";
+      return true;
+    case binlog::kArgString:
+      if (!binlog::getVarint(p, end, v) || static_cast<std::uint64_t>(end - p) < v) return false;
+      text.assign(p, static_cast<std::size_t>(v));
+      value = text;
+      p += v;
+      return true;
+  }
+  return false;
+}
+
+std::string substitute(const std::string& fmt, const std::vector<std::string>& args) {
+  std::string out;
+  std::size_t pos = 0, next = 0;
+  for (const auto& a : args) {
+    next = fmt.find("{}", pos);
+    if (next == std::string::npos) break;
+    out.append(fmt, pos, next - pos);
+    out += a;
+    pos = next + 2;
+  }
+  out.append(fmt, pos, std::string::npos);
+  return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool asJson = false;
+  std::string path;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0)
+      asJson = true;
+    else
+      path = argv[i];
+  }
+  if (path.empty()) {
+    std::cerr << "usage: log_decode [--json] <binary log file>\n";
+    return 2;
+  }
+
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::cerr << "cannot open " << path << "\n";
+    return 1;
+  }
+  const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  std::unordered_map<std::uint64_t, std::string> formats;
+  const char* p = data.data();
+  const char* end = p + data.size();
+  std::vector<std::string> texts;
+
+  while (p < end) {
+    const char* recStart = p;
+    const char tag = *p++;
+
+    if (tag == binlog::kSessionTag) {
+      const std::size_t magicLen = sizeof(binlog::kMagic) - 1;
+      if (static_cast<std::size_t>(end - p) < magicLen + 1 || std::memcmp(p, binlog::kMagic, magicLen) != 0) break;
+      p += magicLen + 1;  // magic + version
+      formats.clear();
+      formats[binlog::kPlainTextId] = "{}";
+      continue;
+    }
+
+    if (tag == binlog::kFormatTag) {
+      std::uint64_t id = 0, len = 0;
+      if (!binlog::getVarint(p, end, id) || !binlog::getVarint(p, end, len) ||
+          static_cast<std::uint64_t>(end - p) < len)
+        break;
+      formats[id].assign(p, static_cast<std::size_t>(len));
+      p += len;
+      continue;
+    }
+
+    if (tag != binlog::kEventTag || end - p < 2) {
+      std::cerr << "corrupt record at offset " << (recStart - data.data()) << "\n";
+      return 1;
+    }
+
+    const auto level = static_cast<std::uint8_t>(*p++);
+    std::uint64_t id = 0, micros = 0;
+    if (!binlog::getVarint(p, end, id) || !binlog::getFixed64(p, end, micros) || p >= end) break;
+    const auto nargs = static_cast<std::uint8_t>(*p++);
+
+    texts.assign(nargs, std::string());
+    json args = json::array();
+    bool ok = true;
+    for (std::uint8_t i = 0; i < nargs && ok; ++i) {
+      json v;
+      ok = decodeArg(p, end, texts[i], v);
+      args.push_back(std::move(v));
+    }
+    if (!ok) break;
+
+    auto itFmt = formats.find(id);
+    const std::string fmt = itFmt != formats.end() ? itFmt->second : "<unknown format " + std::to_string(id) + ">";
+    const std::string msg = substitute(fmt, texts);
+
+    if (asJson) {
+      json j;
+      j["ts"] = formatTime(micros);
+      j["level"] = levelName(level);
+      j["fmt"] = fmt;
+      j["args"] = std::move(args);
+      j["msg"] = msg;
+      std::cout << j.dump() << "\n";
+    } else {
+      std::cout << "[" << formatTime(micros) << "] [" << levelName(level) << "] " << msg << "\n";
+    }
+  }
+
+  if (p < end) {
+    std::cerr << "truncated record at offset " << (p - data.data()) << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,249 @@
+// tools/perf_compare.cpp
+// 把 backend_bench / loadgen 的 --json 結果跟 checked-in baseline 比，退步超過門檻就回傳 1
+//
+//   perf_compare --baseline bench/baseline.json --backend out/backend.json --http out/http.json
+//   perf_compare --baseline bench/baseline.json --backend out/backend.json --http out/http.json --write-baseline
+//   perf_compare --baseline bench/baseline.json --backend run1.json --backend run2.json --backend run3.json
+//
+// 規則（門檻寫在 baseline 的 "thresholds"，命令列可以覆蓋）：
+//   backend : ns/op 換算的 throughput 掉超過 backend_throughput_drop，或 allocs/op 多超過 allocs_rise → 失敗
+//   http    : 整體與各 op 的 throughput 掉超過 throughput_drop，或 p99 升超過 p99_rise → 失敗
+// 差距小於 min_ns_delta / min_p99_delta_us 的視為雜訊。
+// --backend 可以給多次（同一份 build 重跑幾次），每個 (op, records) 取最快的一次，壓掉排程抖動。
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../external/json.hpp"
+
+using json = nlohmann::ordered_json;
+
+namespace {
+
+struct Thresholds {
+  double throughputDrop = 0.15;         // 15%，HTTP
+  double backendThroughputDrop = 0.35;  // microbenchmark 單次 op 不到 1us，抖動比較大
+  double p99Rise = 0.25;         // 25%
+  double allocsRise = 0.5;       // allocations per op（絕對值）
+  double minNsDelta = 20.0;
+  double minP99DeltaUs = 500.0;
+  std::uint64_t minRequests = 1000;  // 樣本太少的 op 不比 p99
+};
+
+struct Report {
+  int regressions = 0;
+  int compared = 0;
+
+  void line(const std::string& name, const char* metric, double base, double cur, bool regressed) {
+    ++compared;
+    if (regressed) ++regressions;
+    const double change = base != 0.0 ? (cur - base) / base * 100.0 : 0.0;
+    std::printf("%-34s %-14s %14.1f %14.1f %+8.1f%%  %s\n", name.c_str(), metric, base, cur, change,
+                regressed ? "REGRESSION" : "ok");
+  }
+};
+
+bool readJson(const std::string& path, json& out) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "cannot open " << path << "\n";
+    return false;
+  }
+  try {
+    in >> out;
+  } catch (const std::exception& e) {
+    std::cerr << "cannot parse " << path << ": " << e.what() << "\n";
+    return false;
+  }
+  return true;
+}
+
+// 多次 backend_bench 的結果合併成一份：同一個 (op, records) 取 ns/op、allocs/op 的最小值
+json mergeBackendRuns(const std::vector<json>& runs) {
+  json merged = json::array();
+  for (const auto& run : runs) {
+    for (const auto& c : run["benchmarks"]) {
+      const std::string op = c.value("op", std::string());
+      const std::uint64_t records = c.value("records", std::uint64_t{0});
+      json* existing = nullptr;
+      for (auto& m : merged) {
+        if (m.value("op", std::string()) == op && m.value("records", std::uint64_t{0}) == records) existing = &m;
+      }
+      if (!existing) {
+        merged.push_back(c);
+        continue;
+      }
+      (*existing)["ns_per_op"] = std::min(existing->value("ns_per_op", 0.0), c.value("ns_per_op", 0.0));
+      (*existing)["allocs_per_op"] = std::min(existing->value("allocs_per_op", 0.0), c.value("allocs_per_op", 0.0));
+    }
+  }
+  return merged;
+}
+
+void loadThresholds(const json& baseline, Thresholds& t) {
+  if (!baseline.contains("thresholds")) return;
+  const json& j = baseline["thresholds"];
+  t.throughputDrop = j.value("throughput_drop", t.throughputDrop);
+  t.backendThroughputDrop = j.value("backend_throughput_drop", t.backendThroughputDrop);
+  t.p99Rise = j.value("p99_rise", t.p99Rise);
+  t.allocsRise = j.value("allocs_rise", t.allocsRise);
+  t.minNsDelta = j.value("min_ns_delta", t.minNsDelta);
+  t.minP99DeltaUs = j.value("min_p99_delta_us", t.minP99DeltaUs);
+  t.minRequests = j.value("min_requests", t.minRequests);
+}
+
+json thresholdsJson(const Thresholds& t) {
+  return {{"throughput_drop", t.throughputDrop},
+          {"backend_throughput_drop", t.backendThroughputDrop},
+          {"p99_rise", t.p99Rise},
+          {"allocs_rise", t.allocsRise},
+          {"min_ns_delta", t.minNsDelta},
+          {"min_p99_delta_us", t.minP99DeltaUs},
+          {"min_requests", t.minRequests}};
+}
+
+void compareBackend(const json& base, const json& cur, const Thresholds& t, Report& r) {
+  for (const auto& b : base) {
+    const std::string op = b.value("op", std::string());
+    const std::uint64_t records = b.value("records", std::uint64_t{0});
+    const json* match = nullptr;
+    for (const auto& c : cur) {
+      if (c.value("op", std::string()) == op && c.value("records", std::uint64_t{0}) == records) match = &c;
+    }
+    const std::string name = "backend " + op + " @" + std::to_string(records);
+    if (!match) {
+      std::printf("%-34s missing from current results\n", name.c_str());
+      continue;
+    }
+
+    // throughput 掉 d ⇔ ns/op 變成 1/(1-d) 倍
+    const double baseNs = b.value("ns_per_op", 0.0);
+    const double curNs = match->value("ns_per_op", 0.0);
+    const bool slower = curNs > baseNs / (1.0 - t.backendThroughputDrop) && curNs - baseNs > t.minNsDelta;
+    r.line(name, "ns/op", baseNs, curNs, slower);
+
+    const double baseAllocs = b.value("allocs_per_op", 0.0);
+    const double curAllocs = match->value("allocs_per_op", 0.0);
+    r.line(name, "allocs/op", baseAllocs, curAllocs, curAllocs > baseAllocs + t.allocsRise);
+  }
+}
+
+void compareHttpEntry(const std::string& name, const json& b, const json& c, const Thresholds& t, Report& r) {
+  const double baseRps = b.value("throughput_rps", 0.0);
+  const double curRps = c.value("throughput_rps", 0.0);
+  r.line(name, "req/s", baseRps, curRps, curRps < baseRps * (1.0 - t.throughputDrop));
+
+  if (c.value("requests", std::uint64_t{0}) < t.minRequests) return;
+  const double baseP99 = b["latency"].value("p99_us", 0.0);
+  const double curP99 = c["latency"].value("p99_us", 0.0);
+  r.line(name, "p99 us", baseP99, curP99,
+         curP99 > baseP99 * (1.0 + t.p99Rise) && curP99 - baseP99 > t.minP99DeltaUs);
+}
+
+void compareHttp(const json& base, const json& cur, const Thresholds& t, Report& r) {
+  compareHttpEntry("http all", base, cur, t, r);
+  if (!base.contains("ops") || !cur.contains("ops")) return;
+  for (const auto& [op, b] : base["ops"].items()) {
+    if (!cur["ops"].contains(op)) continue;
+    compareHttpEntry("http " + op, b, cur["ops"][op], t, r);
+  }
+  const std::uint64_t errors = cur.value("errors", std::uint64_t{0});
+  if (errors > 0) std::printf("note: current HTTP run had %llu errors\n", static_cast<unsigned long long>(errors));
+}
+
+void usage() {
+  std::cerr << "usage: perf_compare --baseline file [--backend file]... [--http file]\n"
+               "                    [--throughput-drop 0.15] [--p99-rise 0.25] [--write-baseline]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string baselinePath, httpPath;
+  std::vector<std::string> backendPaths;
+  bool writeBaseline = false;
+  double overrideDrop = -1.0, overrideRise = -1.0;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--baseline" && hasValue) {
+      baselinePath = argv[++i];
+    } else if (a == "--backend" && hasValue) {
+      backendPaths.push_back(argv[++i]);
+    } else if (a == "--http" && hasValue) {
+      httpPath = argv[++i];
+    } else if (a == "--throughput-drop" && hasValue) {
+      overrideDrop = std::atof(argv[++i]);
+    } else if (a == "--p99-rise" && hasValue) {
+      overrideRise = std::atof(argv[++i]);
+    } else if (a == "--write-baseline") {
+      writeBaseline = true;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (baselinePath.empty() || (backendPaths.empty() && httpPath.empty())) {
+    usage();
+    return 2;
+  }
+
+  std::vector<json> backendRuns(backendPaths.size());
+  for (std::size_t i = 0; i < backendPaths.size(); ++i) {
+    if (!readJson(backendPaths[i], backendRuns[i])) return 2;
+  }
+  const json backend = mergeBackendRuns(backendRuns);
+  json http;
+  if (!httpPath.empty() && !readJson(httpPath, http)) return 2;
+
+  json baseline;
+  Thresholds t;
+  const bool haveBaseline = std::ifstream(baselinePath).good();
+  if (haveBaseline) {
+    if (!readJson(baselinePath, baseline)) return 2;
+    loadThresholds(baseline, t);
+  }
+  if (overrideDrop >= 0.0) t.throughputDrop = overrideDrop;
+  if (overrideRise >= 0.0) t.p99Rise = overrideRise;
+
+  if (writeBaseline) {
+    json out;
+    out["thresholds"] = thresholdsJson(t);
+    out["backend"] = backendPaths.empty() ? baseline.value("backend", json::array()) : backend;
+    out["http"] = httpPath.empty() ? baseline.value("http", json::object()) : http;
+    std::ofstream o(baselinePath);
+    o << out.dump(2) << "\n";
+    if (!o) {
+      std::cerr << "cannot write " << baselinePath << "\n";
+      return 2;
+    }
+    std::cout << "baseline written to " << baselinePath << "\n";
+    return 0;
+  }
+  if (!haveBaseline) {
+    std::cerr << "no baseline at " << baselinePath << " (run with --write-baseline first)\n";
+    return 2;
+  }
+
+  std::printf("thresholds: http throughput -%.0f%%, backend throughput -%.0f%%, p99 +%.0f%%, allocs/op +%.1f\n\n",
+              t.throughputDrop * 100.0, t.backendThroughputDrop * 100.0, t.p99Rise * 100.0, t.allocsRise);
+  std::printf("%-34s %-14s %14s %14s %9s\n", "benchmark", "metric", "baseline", "current", "change");
+
+  Report r;
+  if (!backendPaths.empty() && baseline.contains("backend")) {
+    compareBackend(baseline["backend"], backend, t, r);
+  }
+  if (!httpPath.empty() && baseline.contains("http") && !baseline["http"].empty()) {
+    compareHttp(baseline["http"], http, t, r);
+  }
+
+  std::printf("\n%d metrics compared, %d regressions\n", r.compared, r.regressions);
+  return r.regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+// tools/snapshot_convert.cpp
+// storage.json ⇄ binary snapshot（storage.snap）⇄ per-user 目錄（data/users/）互轉
+//
+//   snapshot_convert data/storage.json data/storage.snap      -> 輸入格式自動判斷，輸出看副檔名（.snap = binary）
+//   snapshot_convert --to json data/storage.snap dump.json
+//   snapshot_convert data/storage.json data/users/            -> 結尾是 / 或已經是目錄 = per-user
+//
+// 直接用 HealthBackend 載入再另存，所以兩邊的欄位 / 預設值規則跟 server 一模一樣。
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "../backend/HealthBackend.hpp"
+#include "../backend/Snapshot.hpp"
+#include "../helpers/Logger.hpp"
+
+namespace {
+
+void usage() {
+  std::cerr << "usage: snapshot_convert [--to json|binary|per-user] <input> <output>\n"
+               "  input format is detected from the file; output defaults to binary for *.snap,\n"
+               "  per-user for a directory (or a path ending in /), else JSON\n";
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// 目錄就加總底下所有檔案
+std::uintmax_t pathBytes(const std::filesystem::path& p) {
+  if (!std::filesystem::is_directory(p)) return std::filesystem::file_size(p);
+  std::uintmax_t total = 0;
+  for (const auto& f : std::filesystem::recursive_directory_iterator(p)) {
+    if (f.is_regular_file()) total += f.file_size();
+  }
+  return total;
+}
+
+const char* formatName(HealthBackend::StorageFormat f) {
+  switch (f) {
+    case HealthBackend::StorageFormat::Binary: return "binary";
+    case HealthBackend::StorageFormat::PerUser: return "per-user";
+    case HealthBackend::StorageFormat::Json: break;
+  }
+  return "json";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string to, input, output;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a == "--to" && i + 1 < argc) {
+      to = argv[++i];
+    } else if (input.empty()) {
+      input = a;
+    } else if (output.empty()) {
+      output = a;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (input.empty() || output.empty() || (!to.empty() && to != "json" && to != "binary" && to != "per-user")) {
+    usage();
+    return 2;
+  }
+  if (!std::filesystem::exists(input)) {
+    std::cerr << "no such file: " << input << "\n";
+    return 1;
+  }
+  HealthBackend::StorageFormat format = HealthBackend::StorageFormat::Json;
+  if (to == "binary" || (to.empty() && endsWith(output, ".snap"))) {
+    format = HealthBackend::StorageFormat::Binary;
+  } else if (to == "per-user" || (to.empty() && (endsWith(output, "/") || std::filesystem::is_directory(output)))) {
+    format = HealthBackend::StorageFormat::PerUser;
+  }
+  while (output.size() > 1 && endsWith(output, "/")) output.pop_back();
+  const char* inputFormat = std::filesystem::is_directory(input) ? "per-user"
+                            : SnapshotFile::isSnapshot(input)    ? "binary"
+                                                                 : "json";
+
+  util::Logger::init("", util::LogLevel::Error);
+  const auto t0 = std::chrono::steady_clock::now();
+
+  HealthBackend::Options opts;
+  opts.storagePath = input;
+  opts.autoSave = false;
+  HealthBackend backend(opts);
+  const auto stats = backend.getStats();
+  if (stats.users == 0 && pathBytes(input) > 0) {
+    // 載入失敗時 backend 是空的（錯誤已經印在 log）；空檔轉出空檔沒關係，其他情況不要覆蓋輸出
+    std::cerr << "nothing loaded from " << input << "\n";
+    util::Logger::shutdown();
+    return 1;
+  }
+
+  const bool ok = backend.exportTo(output, format);
+  util::Logger::shutdown();
+  if (!ok) {
+    std::cerr << "write to " << output << " failed\n";
+    return 1;
+  }
+
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  const std::size_t records = stats.waters + stats.sleeps + stats.activities + stats.categoryItems;
+  std::cerr << inputFormat << " -> " << formatName(format) << ": " << stats.users << " users, " << records
+            << " records, " << pathBytes(input) << " -> " << pathBytes(output) << " bytes, " << secs << " s\n";
+  return 0;
+}